@@ -0,0 +1,123 @@
+// Throughput of the batched small-matrix factorizations: for each matrix
+// order, factors and solves a batch of matrices with BatchLUDecomp and
+// BatchCholesky, and compares matrices per second against a loop
+// constructing an LUDecomp / Cholesky for each matrix. The batch and the
+// right-hand sides are moved into the batched classes, as a caller filling
+// BatchArrays in place would.
+//
+// Usage: bench_batch [-c count] [sizes...]
+
+#include "../src/array.hpp"
+#include "../src/batch.hpp"
+#include "../src/decomp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Best-of-reps wall time of f(), in seconds, calling setup() untimed before
+// each rep
+template <typename S, typename F> double time_best(int reps, S setup, F f) {
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<int> sizes;
+  int count = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-c" && i + 1 < argc) {
+      count = std::atoi(argv[++i]);
+    } else {
+      sizes.push_back(std::atoi(arg.c_str()));
+    }
+  }
+  if (sizes.empty()) {
+    sizes = {3, 4, 8, 16, 32};
+  }
+
+  std::printf("%6s %8s %10s %14s %14s %8s\n", "n", "count", "method",
+              "loop (mat/s)", "batch (mat/s)", "speedup");
+  for (int n : sizes) {
+    // About 32 MB of matrices by default
+    int c = (count > 0) ? count : std::max(1024, (4 << 20) / (n * n));
+
+    // Symmetric positive definite, so both factorizations apply
+    std::vector<Array> mats;
+    BatchArray A(c, n, n);
+    BatchArray B(c, n, 1);
+    for (int b = 0; b < c; ++b) {
+      Array M(n, n);
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j <= i; ++j) {
+          M[i][j] = M[j][i] = std::sin(0.37 * i * n + 1.3 * j + 0.71 * b);
+        }
+        M[i][i] += n;
+      }
+      A.set(b, M);
+      mats.push_back(M);
+      for (int i = 0; i < n; ++i) {
+        B(b, i, 0) = 1.0;
+      }
+    }
+    Array rhs(n, 1);
+    rhs.set_ones();
+    BatchArray batch(0, n, n);
+    BatchArray batch_rhs(0, n, 1);
+    auto none = []() {};
+    auto copy_batch = [&]() {
+      batch = A;
+      batch_rhs = B;
+    };
+
+    double loop_lu = time_best(3, none, [&]() {
+      for (Array &M : mats) {
+        LUDecomp LU(M.view());
+        LU.decompose();
+        Array x = LU.solve(rhs);
+      }
+    });
+    double batch_lu = time_best(3, copy_batch, [&]() {
+      BatchLUDecomp LU(std::move(batch));
+      LU.decompose();
+      BatchArray X = LU.solve(std::move(batch_rhs));
+    });
+    std::printf("%6d %8d %10s %14.3e %14.3e %8.1f\n", n, c, "LU", c / loop_lu,
+                c / batch_lu, loop_lu / batch_lu);
+
+    double loop_chol = time_best(3, none, [&]() {
+      for (Array &M : mats) {
+        Cholesky chol(M.view());
+        chol.decompose();
+        Array x = chol.solve(rhs);
+      }
+    });
+    double batch_chol = time_best(3, copy_batch, [&]() {
+      BatchCholesky chol(std::move(batch));
+      chol.decompose();
+      BatchArray X = chol.solve(std::move(batch_rhs));
+    });
+    std::printf("%6d %8d %10s %14.3e %14.3e %8.1f\n", n, c, "Cholesky",
+                c / loop_chol, c / batch_chol, loop_chol / batch_chol);
+  }
+
+  return 0;
+}
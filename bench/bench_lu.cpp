@@ -0,0 +1,96 @@
+// Scaling of the tiled, task-parallel LU (LUDecomp::decompose_tiled) against
+// the serial blocked LU (LUDecomp::decompose on one thread). For each size,
+// prints the serial time, then the tiled time and speedup over serial for 1,
+// 2, 4, ... threads (or the thread counts given with -t).
+//
+// Usage: bench_lu [-t threads,...] [-b tile_size] [sizes...]
+
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Best-of-reps wall time of factoring A, in seconds
+template <typename F> double time_lu(const Array &A, int reps, F factor) {
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    LUDecomp LU(A.view());
+    auto start = std::chrono::steady_clock::now();
+    factor(LU);
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<int> sizes;
+  std::vector<int> threads;
+  int tile_size = 128;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc) {
+      std::stringstream list(argv[++i]);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        threads.push_back(std::atoi(item.c_str()));
+      }
+    } else if (arg == "-b" && i + 1 < argc) {
+      tile_size = std::atoi(argv[++i]);
+    } else {
+      sizes.push_back(std::atoi(arg.c_str()));
+    }
+  }
+  if (sizes.empty()) {
+    sizes = {512, 1024, 2048};
+  }
+  if (threads.empty()) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 1; t < max_threads; t *= 2) {
+      threads.push_back(t);
+    }
+    threads.push_back(max_threads);
+  }
+
+  std::printf("%8s %10s %8s %12s %10s %8s\n", "n", "variant", "threads",
+              "time (s)", "GFLOP/s", "speedup");
+  for (int n : sizes) {
+    Array A(n, n);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        A[i][j] = std::sin(0.37 * i * n + 1.3 * j) + (i == j ? 1.0 : 0.0);
+      }
+    }
+    int reps = (n <= 1024) ? 3 : 1;
+    double flops = 2.0 / 3.0 * n * n * n;
+
+    parallel::set_num_threads(1);
+    double serial = time_lu(A, reps, [](LUDecomp &LU) { LU.decompose(); });
+    std::printf("%8d %10s %8d %12.4f %10.2f %8.2f\n", n, "serial", 1, serial,
+                flops / serial * 1e-9, 1.0);
+
+    for (int t : threads) {
+      double secs = time_lu(A, reps, [&](LUDecomp &LU) {
+        LU.decompose_tiled(tile_size, t);
+      });
+      std::printf("%8d %10s %8d %12.4f %10.2f %8.2f\n", n, "tiled", t, secs,
+                  flops / secs * 1e-9, serial / secs);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Speedup curve for Array::mult: times square products of each size on 1, 2,
+// 4, ... threads (up to the hardware concurrency, or the thread counts given
+// with -t) and reports GFLOP/s and the speedup over the first thread count.
+//
+// Usage: bench_mult [-t threads,...] [sizes...]
+
+#include "../src/array.hpp"
+#include "../src/parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Best-of-reps wall time of A.mult(B), in seconds
+double time_mult(Array &A, Array &B, int reps) {
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    Array C = A.mult(B);
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<int> sizes;
+  std::vector<int> threads;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc) {
+      std::stringstream list(argv[++i]);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        threads.push_back(std::atoi(item.c_str()));
+      }
+    } else {
+      sizes.push_back(std::atoi(arg.c_str()));
+    }
+  }
+  if (sizes.empty()) {
+    sizes = {256, 512, 1024, 2048};
+  }
+  if (threads.empty()) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 1; t < max_threads; t *= 2) {
+      threads.push_back(t);
+    }
+    threads.push_back(max_threads);
+  }
+
+  std::printf("%8s %8s %12s %10s %8s\n", "n", "threads", "time (s)",
+              "GFLOP/s", "speedup");
+  for (int n : sizes) {
+    Array A(n, n);
+    Array B(n, n);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        A[i][j] = 1.0 / (1 + i + j);
+        B[i][j] = 1.0 / (1 + std::abs(i - j));
+      }
+    }
+    int reps = (n <= 512) ? 5 : 2;
+    double flops = 2.0 * n * n * n;
+
+    double t_base = 0;
+    for (int t : threads) {
+      parallel::set_num_threads(t);
+      double secs = time_mult(A, B, reps);
+      if (t_base == 0) {
+        t_base = secs;
+      }
+      std::printf("%8d %8d %12.4f %10.2f %8.2f\n", n, t, secs,
+                  flops / secs * 1e-9, t_base / secs);
+    }
+  }
+
+  return 0;
+}
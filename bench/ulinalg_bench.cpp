@@ -0,0 +1,369 @@
+// Benchmark suite: sweeps sizes for Array::mult, the elementwise operators
+// over each broadcast shape, the LU and Cholesky decompositions and solves
+// (in double, single and mixed precision), and sparse (CSR) products. Each
+// case reports the time per call, GFLOP/s (for the dense linear algebra) or
+// GB/s (for the elementwise operators, counting each operand read and the
+// result written once), and the Array allocations made per call.
+//
+// Times are the best of -r repetitions of the mean over enough calls to run
+// for at least 20 ms. Decompositions are timed without the copy of A into the
+// factorization, and solves with a single right-hand side.
+//
+// Usage: ulinalg_bench [--json] [--quick] [-r reps] [-f filter]
+//
+//   --json   print the results as JSON (for comparing releases)
+//   --quick  smaller sweeps, e.g. for a smoke test
+//   -f       only run cases whose name contains filter
+
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/memory.hpp"
+#include "../src/parallel.hpp"
+#include "../src/simd.hpp"
+#include "../src/sparse.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef ULINALG_VERSION
+#define ULINALG_VERSION "unknown"
+#endif
+
+namespace {
+
+struct Result {
+  std::string name;
+  std::string shape;
+  double seconds; // per call
+  double rate;    // in units
+  const char *units;
+  double allocations; // per call
+};
+
+struct Options {
+  bool json = false;
+  bool quick = false;
+  int reps = 3;
+  std::string filter;
+};
+
+constexpr double MIN_SECONDS = 0.02;
+
+// Time f() (per call), excluding setup() which runs before each call. Returns
+// the best over reps of the mean time, and the Array allocations per call.
+template <typename S, typename F>
+std::pair<double, double> measure(int reps, S setup, F f) {
+  // One untimed call, which also sizes the batches
+  setup();
+  auto start = std::chrono::steady_clock::now();
+  f();
+  double once = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  long calls = std::max(1L, static_cast<long>(MIN_SECONDS / (once + 1e-9)));
+
+  double best = 1e300;
+  double allocations = 0;
+  for (int r = 0; r < reps; ++r) {
+    double total = 0;
+    std::size_t allocs = 0;
+    for (long c = 0; c < calls; ++c) {
+      setup();
+      std::size_t before = memory::get_counters().allocations;
+      auto t0 = std::chrono::steady_clock::now();
+      f();
+      auto t1 = std::chrono::steady_clock::now();
+      allocs += memory::get_counters().allocations - before;
+      total += std::chrono::duration<double>(t1 - t0).count();
+    }
+    best = std::min(best, total / calls);
+    allocations = static_cast<double>(allocs) / calls;
+  }
+  return {best, allocations};
+}
+
+std::string shape_str(int m, int n) {
+  return std::to_string(m) + "x" + std::to_string(n);
+}
+
+Array make_array(int m, int n, double shift) {
+  Array A(m, n);
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = 1.0 + std::sin(0.37 * i + 1.3 * j + shift) * 0.5;
+    }
+  }
+  return A;
+}
+
+// Symmetric positive definite, hence also safe for LU without pivot trouble
+Array make_spd(int n) {
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      A[i][j] = A[j][i] = std::sin(0.37 * i * n + 1.3 * j);
+    }
+    A[i][i] += n;
+  }
+  return A;
+}
+
+class Suite {
+private:
+  Options opts;
+  std::vector<Result> results;
+
+  bool selected(const std::string &name) const {
+    return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+  }
+
+  template <typename S, typename F>
+  void run(const std::string &name, const std::string &shape, double work,
+           const char *units, S setup, F f) {
+    std::pair<double, double> m = measure(opts.reps, setup, f);
+    results.push_back({name, shape, m.first, work / m.first * 1e-9, units,
+                       m.second});
+    if (!opts.json) {
+      const Result &r = results.back();
+      std::printf("%-20s %-12s %12.3e %10.3f %-8s %8.2f\n", r.name.c_str(),
+                  r.shape.c_str(), r.seconds, r.rate, r.units,
+                  r.allocations);
+      std::fflush(stdout);
+    }
+  }
+
+public:
+  explicit Suite(const Options &o) : opts(o) {}
+
+  void mult() {
+    if (!selected("mult")) {
+      return;
+    }
+    std::vector<int> sizes = opts.quick ? std::vector<int>{64, 256}
+                                        : std::vector<int>{64, 128, 256, 512,
+                                                           1024};
+    for (int n : sizes) {
+      Array A = make_array(n, n, 0.0);
+      Array B = make_array(n, n, 1.0);
+      run("mult", shape_str(n, n), 2.0 * n * n * n, "GFLOP/s", [] {},
+          [&] { Array C = A.mult(B); });
+    }
+  }
+
+  // One operator over the same-shape, scalar, row and column broadcasts, on
+  // Arrays of T
+  template <typename T = double, typename Op>
+  void elementwise(const std::string &op_name, Op op) {
+    std::vector<int> sizes = opts.quick ? std::vector<int>{256}
+                                        : std::vector<int>{64, 256, 1024, 2048};
+    const char *shapes[] = {"same", "scalar", "row", "col"};
+    for (int s = 0; s < 4; ++s) {
+      std::string name = op_name + "_" + shapes[s];
+      if (!selected(name)) {
+        continue;
+      }
+      for (int n : sizes) {
+        BasicArray<T> a(make_array(n, n, 0.0));
+        BasicArray<T> b(make_array(s == 2 ? 1 : n, s == 3 ? 1 : n, 1.0));
+        double bytes = 1.0 * sizeof(T) * n * n * (s == 0 ? 3 : 2);
+        if (s == 1) {
+          run(name, shape_str(n, n), bytes, "GB/s", [] {},
+              [&] { BasicArray<T> c = op(a, 2.0); });
+        } else {
+          run(name, shape_str(n, n), bytes, "GB/s", [] {},
+              [&] { BasicArray<T> c = op(a, b); });
+        }
+      }
+    }
+  }
+
+  void decompositions() {
+    std::vector<int> sizes = opts.quick ? std::vector<int>{64, 256}
+                                        : std::vector<int>{64, 256, 512, 1024};
+    for (int n : sizes) {
+      Array A = make_spd(n);
+      Array b = make_array(n, 1, 2.0);
+      double n3 = static_cast<double>(n) * n * n;
+      double solve_flops = 2.0 * n * n;
+
+      if (selected("lu_decompose")) {
+        std::unique_ptr<LUDecomp> LU;
+        run("lu_decompose", shape_str(n, n), 2.0 / 3.0 * n3, "GFLOP/s",
+            [&] { LU = std::make_unique<LUDecomp>(A.view()); },
+            [&] { LU->decompose(); });
+      }
+      if (selected("lu_solve")) {
+        LUDecomp LU(A.view());
+        LU.decompose();
+        run("lu_solve", shape_str(n, n), solve_flops, "GFLOP/s", [] {},
+            [&] { Array x = LU.solve(b); });
+      }
+      if (selected("chol_decompose")) {
+        std::unique_ptr<Cholesky> chol;
+        run("chol_decompose", shape_str(n, n), n3 / 3.0, "GFLOP/s",
+            [&] { chol = std::make_unique<Cholesky>(A.view()); },
+            [&] { chol->decompose(); });
+      }
+      if (selected("chol_solve")) {
+        Cholesky chol(A.view());
+        chol.decompose();
+        run("chol_solve", shape_str(n, n), solve_flops, "GFLOP/s", [] {},
+            [&] { Array x = chol.solve(b); });
+      }
+      if (selected("float_lu_decompose")) {
+        BasicArray<float> Af(A);
+        std::unique_ptr<BasicLUDecomp<float>> LU;
+        run("float_lu_decompose", shape_str(n, n), 2.0 / 3.0 * n3, "GFLOP/s",
+            [&] { LU = std::make_unique<BasicLUDecomp<float>>(Af.view()); },
+            [&] { LU->decompose(); });
+      }
+      if (selected("float_chol_decompose")) {
+        BasicArray<float> Af(A);
+        std::unique_ptr<BasicCholesky<float>> chol;
+        run("float_chol_decompose", shape_str(n, n), n3 / 3.0, "GFLOP/s",
+            [&] { chol = std::make_unique<BasicCholesky<float>>(Af.view()); },
+            [&] { chol->decompose(); });
+      }
+      if (selected("mixed_lu_decompose")) {
+        std::unique_ptr<MixedLUDecomp> LU;
+        run("mixed_lu_decompose", shape_str(n, n), 2.0 / 3.0 * n3, "GFLOP/s",
+            [&] { LU = std::make_unique<MixedLUDecomp>(A.view()); },
+            [&] { LU->decompose(); });
+      }
+      if (selected("mixed_lu_solve")) {
+        MixedLUDecomp LU(A.view());
+        LU.decompose();
+        run("mixed_lu_solve", shape_str(n, n), solve_flops, "GFLOP/s", [] {},
+            [&] { Array x = LU.solve(b); });
+      }
+      if (selected("mixed_chol_decompose")) {
+        std::unique_ptr<MixedCholesky> chol;
+        run("mixed_chol_decompose", shape_str(n, n), n3 / 3.0, "GFLOP/s",
+            [&] { chol = std::make_unique<MixedCholesky>(A.view()); },
+            [&] { chol->decompose(); });
+      }
+      if (selected("mixed_chol_solve")) {
+        MixedCholesky chol(A.view());
+        chol.decompose();
+        run("mixed_chol_solve", shape_str(n, n), solve_flops, "GFLOP/s",
+            [] {}, [&] { Array x = chol.solve(b); });
+      }
+    }
+  }
+
+  // 5-point Laplacian on a g x g grid, times a vector (spmv) or 8 (spmm)
+  void sparse() {
+    std::vector<int> grids = opts.quick ? std::vector<int>{100}
+                                        : std::vector<int>{100, 300, 1000};
+    for (int g : grids) {
+      int n = g * g;
+      std::vector<Triplet> entries;
+      for (int i = 0; i < n; ++i) {
+        entries.push_back({i, i, 4.0});
+        for (int d : {-g, -1, 1, g}) {
+          if (i + d >= 0 && i + d < n) {
+            entries.push_back({i, i + d, -1.0});
+          }
+        }
+      }
+      SparseArray A(n, n, entries);
+      double nnz = static_cast<double>(A.get_nnz());
+      for (int k : {1, 8}) {
+        std::string name = k == 1 ? "spmv" : "spmm";
+        if (!selected(name)) {
+          continue;
+        }
+        Array x = make_array(n, k, 0.0);
+        Array y(n, k);
+        double bytes = 12.0 * nnz + 8.0 * n * (2 * k + 1);
+        run(name, shape_str(n, k), bytes, "GB/s", [] {},
+            [&] { ::mult(y, A, x); });
+      }
+    }
+  }
+
+  void print_json() const {
+    const char *isa_names[] = {"scalar", "sse2", "avx2", "avx512"};
+    std::printf("{\n  \"library\": \"ulinalg\",\n");
+    std::printf("  \"version\": \"%s\",\n", ULINALG_VERSION);
+    std::printf("  \"threads\": %d,\n", parallel::get_num_threads());
+    std::printf("  \"isa\": \"%s\",\n",
+                isa_names[static_cast<int>(simd::get_isa())]);
+    std::printf("  \"results\": [\n");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const Result &r = results[i];
+      std::printf("    {\"name\": \"%s\", \"shape\": \"%s\", \"seconds\": "
+                  "%.6e, \"rate\": %.6g, \"units\": \"%s\", "
+                  "\"allocations\": %.3f}%s\n",
+                  r.name.c_str(), r.shape.c_str(), r.seconds, r.rate, r.units,
+                  r.allocations, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+  }
+
+  void print_header() const {
+    std::printf("ulinalg %s, %d threads\n", ULINALG_VERSION,
+                parallel::get_num_threads());
+    std::printf("%-20s %-12s %12s %10s %-8s %8s\n", "case", "shape",
+                "time (s)", "rate", "units", "allocs");
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      opts.json = true;
+    } else if (arg == "--quick") {
+      opts.quick = true;
+    } else if (arg == "-r" && i + 1 < argc) {
+      opts.reps = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-f" && i + 1 < argc) {
+      opts.filter = argv[++i];
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--json] [--quick] [-r reps] [-f filter]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  Suite suite(opts);
+  if (!opts.json) {
+    suite.print_header();
+  }
+  suite.mult();
+  suite.elementwise("add", [](const Array &l, const auto &r) {
+    return Array(l + r);
+  });
+  suite.elementwise("sub", [](const Array &l, const auto &r) {
+    return Array(l - r);
+  });
+  suite.elementwise("mul", [](const Array &l, const auto &r) {
+    return Array(l * r);
+  });
+  suite.elementwise("div", [](const Array &l, const auto &r) {
+    return Array(l / r);
+  });
+  suite.elementwise<float>("float_add",
+                           [](const BasicArray<float> &l, const auto &r) {
+                             return BasicArray<float>(l + r);
+                           });
+  suite.decompositions();
+  suite.sparse();
+  if (opts.json) {
+    suite.print_json();
+  }
+
+  return 0;
+}
@@ -1,49 +1,169 @@
 #include "array.hpp"
+#include "kernels.hpp"
+#include "simd.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 // Array class initialization
-Array::Array(int nrows, int ncols)
-    : nrow(nrows), ncol(ncols), vals(nrow * ncol) {}
+template <typename T>
+BasicArray<T>::BasicArray(int nrows, int ncols)
+    : nrow(nrows), ncol(ncols), vals(static_cast<size_t>(nrow) * ncol) {}
 
 // Array class initialization: if values isn't the right length, recycle it so
 // that it is
-Array::Array(const std::vector<double> &values, int nrows, int ncols)
-    : nrow(nrows), ncol(ncols), vals(nrow * ncol) {
-  int n = values.size();
-  int n_out = nrow * ncol;
-  for (int i = 0; i < n_out; ++i) {
+template <typename T>
+BasicArray<T>::BasicArray(const std::vector<T> &values, int nrows, int ncols)
+    : nrow(nrows), ncol(ncols), vals(static_cast<size_t>(nrow) * ncol) {
+  size_t n = values.size();
+  size_t n_out = vals.size();
+  for (size_t i = 0; i < n_out; ++i) {
     vals[i] = values[i % n];
   }
 }
 
+// Array class initialization from a view: copies the viewed values, row by
+// row, into contiguous storage
+template <typename T>
+BasicArray<T>::BasicArray(const BasicArrayView<const T> &v)
+    : nrow(v.get_nrow()), ncol(v.get_ncol()),
+      vals(static_cast<size_t>(nrow) * ncol) {
+  for (int i = 0; i < nrow; ++i) {
+    T *row = (*this)[i];
+    for (int j = 0; j < ncol; ++j) {
+      row[j] = v(i, j);
+    }
+  }
+}
+
+template <typename T>
+template <typename U, typename>
+BasicArray<T>::BasicArray(const BasicArray<U> &other)
+    : nrow(other.get_nrow()), ncol(other.get_ncol()),
+      vals(static_cast<size_t>(nrow) * ncol) {
+  Span<const U> in = other.span();
+  for (size_t i = 0; i < vals.size(); ++i) {
+    vals[i] = static_cast<T>(in[i]);
+  }
+}
+
+template <typename T>
+BasicArray<T>::BasicArray(BasicArray &&other) noexcept
+    : nrow(other.nrow), ncol(other.ncol), vals(std::move(other.vals)) {
+  other.nrow = 0;
+  other.ncol = 0;
+}
+
+template <typename T>
+BasicArray<T> &BasicArray<T>::operator=(BasicArray &&other) {
+  if (&other != this) {
+    nrow = other.nrow;
+    ncol = other.ncol;
+    vals = std::move(other.vals);
+    other.nrow = 0;
+    other.ncol = 0;
+    other.vals.clear();
+  }
+  return *this;
+}
+
 // Get the number of rows in the array object
-int Array::get_nrow() const { return nrow; }
+template <typename T> int BasicArray<T>::get_nrow() const { return nrow; }
 
 // Get the number of cols in the array object
-int Array::get_ncol() const { return ncol; }
+template <typename T> int BasicArray<T>::get_ncol() const { return ncol; }
 
 // Get the values from the object
-std::vector<double> Array::get_vals() const { return vals; }
+template <typename T> std::vector<T> BasicArray<T>::get_vals() const {
+  return std::vector<T>(vals.begin(), vals.end());
+}
+
+// Access the values without copying them
+template <typename T> Span<T> BasicArray<T>::span() {
+  return Span<T>(vals.data(), vals.size());
+}
+
+template <typename T> Span<const T> BasicArray<T>::span() const {
+  return Span<const T>(vals.data(), vals.size());
+}
+
+// Views of the whole array, and of parts of it
+template <typename T> BasicArrayView<T> BasicArray<T>::view() {
+  return BasicArrayView<T>(vals.data(), nrow, ncol, ncol, 1);
+}
+
+template <typename T> BasicArrayView<const T> BasicArray<T>::view() const {
+  return BasicArrayView<const T>(vals.data(), nrow, ncol, ncol, 1);
+}
+
+template <typename T>
+BasicArray<T>::operator BasicArrayView<const T>() const {
+  return view();
+}
+
+template <typename T> BasicArrayView<T> BasicArray<T>::row(int i) {
+  return view().row(i);
+}
+
+template <typename T> BasicArrayView<const T> BasicArray<T>::row(int i) const {
+  return view().row(i);
+}
+
+template <typename T> BasicArrayView<T> BasicArray<T>::col(int j) {
+  return view().col(j);
+}
+
+template <typename T> BasicArrayView<const T> BasicArray<T>::col(int j) const {
+  return view().col(j);
+}
+
+template <typename T>
+BasicArrayView<T> BasicArray<T>::block(int r0, int c0, int nrows, int ncols) {
+  return view().block(r0, c0, nrows, ncols);
+}
+
+template <typename T>
+BasicArrayView<const T> BasicArray<T>::block(int r0, int c0, int nrows,
+                                             int ncols) const {
+  return view().block(r0, c0, nrows, ncols);
+}
+
+template <typename T> BasicArrayView<T> BasicArray<T>::t() {
+  return view().t();
+}
+
+template <typename T> BasicArrayView<const T> BasicArray<T>::t() const {
+  return view().t();
+}
+
+namespace {
+
+// vals[i] = value, on the vectorized kernel for double values
+void fill(std::size_t n, double value, double *out) {
+  simd::fill(n, value, out);
+}
+
+void fill(std::size_t n, float value, float *out) {
+  std::fill(out, out + n, value);
+}
+
+} // namespace
 
 // Set the elements to zeros
-void Array::set_zeros() {
-  for (auto it = vals.begin(); it != vals.end(); ++it) {
-    *it = 0;
-  }
+template <typename T> void BasicArray<T>::set_zeros() {
+  fill(vals.size(), T(0), vals.data());
 }
 
 // Set the elements to ones
-void Array::set_ones() {
-  for (auto it = vals.begin(); it != vals.end(); ++it) {
-    *it = 1;
-  }
+template <typename T> void BasicArray<T>::set_ones() {
+  fill(vals.size(), T(1), vals.data());
 }
 
 // Set the elements to have ones along the main diagonal
-void Array::eye() {
+template <typename T> void BasicArray<T>::eye() {
   set_zeros();
   if (ncol == 1) {
     vals[0] = 1;
@@ -56,7 +176,7 @@ void Array::eye() {
 
 // Set the values of an array from a vector:
 // The values array has to be of the exact same size as expected
-void Array::set_vals(std::vector<double> &values) {
+template <typename T> void BasicArray<T>::set_vals(std::vector<T> &values) {
   int size_in = values.size();
   int size_out = vals.size();
 
@@ -70,7 +190,7 @@ void Array::set_vals(std::vector<double> &values) {
 }
 
 // Copy input into 'this' Array
-void Array::copy(Array &input) {
+template <typename T> void BasicArray<T>::copy(BasicArray &input) {
   int nrow_in = input.get_nrow();
   int ncol_in = input.get_ncol();
 
@@ -86,7 +206,7 @@ void Array::copy(Array &input) {
 }
 
 // Pretty print the output array
-void Array::pprint() {
+template <typename T> void BasicArray<T>::pprint() {
   for (size_t i = 0; i < vals.size(); ++i) {
     std::cout << vals[i];
 
@@ -99,119 +219,105 @@ void Array::pprint() {
 }
 
 // Matrix multiplication
-Array Array::mult(Array &m) {
-  // compute A = this @ m (= this.mult(m))
-  int nrow_l = nrow;
-  int ncol_l = ncol;
-
-  // right-hand dimensions
-  int nrow_r = m.nrow;
-  int ncol_r = m.ncol;
-
-  if (ncol_l != nrow_r) {
-    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
-  }
-
-  Array res = Array(nrow_l, ncol_r);
-  res.set_zeros();
-
-  for (int i = 0; i < nrow_l; ++i) {
-    for (int j = 0; j < ncol_r; ++j) {
-      for (int k = 0; k < ncol_l; ++k) {
-        res[i][j] += vals[ncol_l * i + k] * m[k][j];
-      }
-    }
-  }
+template <typename T> BasicArray<T> BasicArray<T>::mult(BasicArray &m) {
+  return ::mult(view(), m.view());
+}
 
-  return res;
+template <typename T>
+BasicArray<T> BasicArray<T>::mult(const BasicArrayView<const T> &m) const {
+  return ::mult(view(), m);
 }
 
-// Add two arrays together
-Array operator+(const Array &a1, const Array &a2) {
-  // Go from right to left as in numpy --- doesn't really matter in terms of
-  // function calls but it is easier to maintain consistency
-  int ncol_out = array_detail::get_op_ncol_out(a1, a2);
-  int nrow_out = array_detail::get_op_nrow_out(a1, a2);
+namespace {
 
-  std::vector<int> left_idx =
-      array_detail::get_bcast_idx(a1, nrow_out, ncol_out);
+// Matrix multiplication of views: strided operands (e.g. transposes or
+// blocks) are read in place by the packed kernel
+template <typename T>
+BasicArray<T> mult_views(const BasicArrayView<const T> &a,
+                         const BasicArrayView<const T> &b) {
+  // compute A = a @ b
+  int nrow_l = a.get_nrow();
+  int ncol_l = a.get_ncol();
 
-  std::vector<int> right_idx =
-      array_detail::get_bcast_idx(a2, nrow_out, ncol_out);
+  // right-hand dimensions
+  int nrow_r = b.get_nrow();
+  int ncol_r = b.get_ncol();
 
-  // Set the return Array
-  Array res(nrow_out, ncol_out);
-  for (size_t i = 0; i < nrow_out * ncol_out; ++i) {
-    res.vals[i] = a1.vals[left_idx[i]] + a2.vals[right_idx[i]];
+  if (ncol_l != nrow_r) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
   }
+  ULINALG_PROFILE_SCOPE(profile::Op::mult, nrow_l, ncol_r,
+                        2.0 * nrow_l * ncol_r * ncol_l,
+                        1.0 * sizeof(T) * nrow_l * ncol_l +
+                            1.0 * sizeof(T) * nrow_r * ncol_r +
+                            1.0 * sizeof(T) * nrow_l * ncol_r);
+
+  // Packed, cache-blocked kernel: see kernels::gemm
+  BasicArray<T> res(nrow_l, ncol_r);
+  kernels::gemm(nrow_l, ncol_r, ncol_l, T(1), a.data(), a.row_stride(),
+                a.col_stride(), b.data(), b.row_stride(), b.col_stride(), T(0),
+                res[0], ncol_r);
 
   return res;
 }
 
-// Subtract two arrays
-Array operator-(const Array &a1, const Array &a2) {
-  // Go from right to left as in numpy --- doesn't really matter in terms of
-  // function calls but it is easier to maintain consistency
-  int ncol_out = array_detail::get_op_ncol_out(a1, a2);
-  int nrow_out = array_detail::get_op_nrow_out(a1, a2);
-
-  std::vector<int> left_idx =
-      array_detail::get_bcast_idx(a1, nrow_out, ncol_out);
-
-  std::vector<int> right_idx =
-      array_detail::get_bcast_idx(a2, nrow_out, ncol_out);
-
-  // Set the return Array
-  Array res(nrow_out, ncol_out);
-  for (size_t i = 0; i < nrow_out * ncol_out; ++i) {
-    res.vals[i] = a1.vals[left_idx[i]] - a2.vals[right_idx[i]];
+// Whether the memory spanned by a view overlaps [begin, end)
+template <typename T>
+bool overlaps(const BasicArrayView<const T> &v, const T *begin, const T *end) {
+  if (v.get_nrow() == 0 || v.get_ncol() == 0) {
+    return false;
   }
-
-  return res;
+  const T *first = v.data();
+  const T *last = first + (v.get_nrow() - 1) * v.row_stride() +
+                  (v.get_ncol() - 1) * v.col_stride();
+  return std::min(first, last) < end && std::max(first, last) >= begin;
 }
 
-// Multiply two arrays
-Array operator*(const Array &a1, const Array &a2) {
-  // Go from right to left as in numpy --- doesn't really matter in terms of
-  // function calls but it is easier to maintain consistency
-  int ncol_out = array_detail::get_op_ncol_out(a1, a2);
-  int nrow_out = array_detail::get_op_nrow_out(a1, a2);
-
-  std::vector<int> left_idx =
-      array_detail::get_bcast_idx(a1, nrow_out, ncol_out);
-
-  std::vector<int> right_idx =
-      array_detail::get_bcast_idx(a2, nrow_out, ncol_out);
-
-  // Set the return Array
-  Array res(nrow_out, ncol_out);
-  for (size_t i = 0; i < nrow_out * ncol_out; ++i) {
-    res.vals[i] = a1.vals[left_idx[i]] * a2.vals[right_idx[i]];
+// Matrix multiplication into an existing Array: the kernel writes the product
+// straight into out's storage, so nothing is allocated
+template <typename T>
+void mult_into(BasicArray<T> &out, const BasicArrayView<const T> &a,
+               const BasicArrayView<const T> &b) {
+  if (a.get_ncol() != b.get_nrow()) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
   }
-
-  return res;
+  if (out.get_nrow() != a.get_nrow() || out.get_ncol() != b.get_ncol()) {
+    throw std::invalid_argument("Output dimensions incompatible");
+  }
+  Span<T> vals = out.span();
+  if (overlaps(a, vals.begin(), vals.end()) ||
+      overlaps(b, vals.begin(), vals.end())) {
+    throw std::invalid_argument("Output overlaps an input of mult");
+  }
+  ULINALG_PROFILE_SCOPE(profile::Op::mult, a.get_nrow(), b.get_ncol(),
+                        2.0 * a.get_nrow() * b.get_ncol() * a.get_ncol(),
+                        1.0 * sizeof(T) * a.get_nrow() * a.get_ncol() +
+                            1.0 * sizeof(T) * b.get_nrow() * b.get_ncol() +
+                            1.0 * sizeof(T) * out.get_nrow() * out.get_ncol());
+
+  kernels::gemm(a.get_nrow(), b.get_ncol(), a.get_ncol(), T(1), a.data(),
+                a.row_stride(), a.col_stride(), b.data(), b.row_stride(),
+                b.col_stride(), T(0), vals.data(), b.get_ncol());
 }
 
-// Divide two arrays elementwise
-Array operator/(const Array &a1, const Array &a2) {
-  // Go from right to left as in numpy --- doesn't really matter in terms of
-  // function calls but it is easier to maintain consistency
-  int ncol_out = array_detail::get_op_ncol_out(a1, a2);
-  int nrow_out = array_detail::get_op_nrow_out(a1, a2);
+} // namespace
 
-  std::vector<int> left_idx =
-      array_detail::get_bcast_idx(a1, nrow_out, ncol_out);
+Array mult(const ConstArrayView &a, const ConstArrayView &b) {
+  return mult_views(a, b);
+}
 
-  std::vector<int> right_idx =
-      array_detail::get_bcast_idx(a2, nrow_out, ncol_out);
+BasicArray<float> mult(const BasicArrayView<const float> &a,
+                       const BasicArrayView<const float> &b) {
+  return mult_views(a, b);
+}
 
-  // Set the return Array
-  Array res(nrow_out, ncol_out);
-  for (size_t i = 0; i < nrow_out * ncol_out; ++i) {
-    res.vals[i] = a1.vals[left_idx[i]] / a2.vals[right_idx[i]];
-  }
+void mult(Array &out, const ConstArrayView &a, const ConstArrayView &b) {
+  mult_into(out, a, b);
+}
 
-  return res;
+void mult(BasicArray<float> &out, const BasicArrayView<const float> &a,
+          const BasicArrayView<const float> &b) {
+  mult_into(out, a, b);
 }
 
 // Allow for indexing operations e.g. a[1][2]
@@ -222,61 +328,42 @@ Array operator/(const Array &a1, const Array &a2) {
 //
 // This works because of the way pointer arithmetic works in C++:
 // x[10] === *(x + 10) ==== *(10 + x) === 10[x] (!)
-double *Array::operator[](int r) { return &vals[r * ncol]; }
-
-// Take an array and broadcast it into a new Array
-Array array_detail::bcast(Array &input, int nrow, int ncol) {
-  std::vector<double> input_vals = input.get_vals();
-  std::vector<double> input_val_vector(nrow * ncol);
-  std::vector<int> idx_bcast = get_bcast_idx(input, nrow, ncol);
+template <typename T> T *BasicArray<T>::operator[](int r) {
+  return vals.data() + static_cast<std::ptrdiff_t>(r) * ncol;
+}
 
-  for (auto i = 0; i < input_val_vector.size(); ++i) {
-    input_val_vector[i] = input_vals[idx_bcast[i]];
+// Take an array and broadcast it into a new Array, writing each output row
+// straight from the input (a row of the input, or a single repeated value)
+Array array_detail::bcast(const Array &input, int nrow, int ncol) {
+  int nrow_in = input.get_nrow();
+  int ncol_in = input.get_ncol();
+  if ((nrow_in != nrow && nrow_in != 1) || (ncol_in != ncol && ncol_in != 1)) {
+    throw std::invalid_argument("Dimensions prohibit broadcasting");
   }
+  ULINALG_PROFILE_SCOPE(profile::Op::bcast, nrow, ncol, 0.0,
+                        8.0 * nrow_in * ncol_in + 8.0 * nrow * ncol);
 
-  // Initialize the output object
-  Array res(input_val_vector, nrow, ncol);
+  Array res(nrow, ncol);
+  ArrayLeaf<double> leaf(input);
+  for (int i = 0; i < nrow; ++i) {
+    leaf.eval_into(i, 0, ncol, res[i], nullptr);
+  }
 
   return res;
 }
 
-std::vector<int> array_detail::get_bcast_idx(const Array &a, int nrow_out,
-                                             int ncol_out) {
-  int nrow_in = a.get_nrow();
-  int ncol_in = a.get_ncol();
-  int n_elements = nrow_out * ncol_out;
-  std::vector<int> idx(n_elements);
-  if (nrow_in == nrow_out && ncol_in == ncol_out) {
-    for (int i = 0; i < n_elements; ++i) {
-      idx[i] = i;
-    }
-  } else if (nrow_in == 1 && ncol_in == 1) {
-    for (int i = 0; i < n_elements; ++i) {
-      idx[i] = 0;
-    }
-  } else if (nrow_in == nrow_out && ncol_in == 1) {
-    for (int i = 0; i < n_elements; ++i) {
-      idx[i] = i / ncol_out;
-    }
-  } else if (nrow_in == 1 && ncol_in == ncol_out) {
-    for (int i = 0; i < n_elements; ++i) {
-      idx[i] = i % ncol_out;
-    }
-  } else {
-    throw std::invalid_argument("Dimensions prohibit broadcasting");
-  }
+int array_detail::get_op_ncol_out(const Array &a1, const Array &a2) {
+  return get_op_ncol_out(a1.get_ncol(), a2.get_ncol());
+}
 
-  return idx;
+int array_detail::get_op_nrow_out(const Array &a1, const Array &a2) {
+  return get_op_nrow_out(a1.get_nrow(), a2.get_nrow());
 }
 
-int array_detail::get_op_ncol_out(const Array &a1, const Array &a2) {
+int array_detail::get_op_ncol_out(int ncol_left, int ncol_right) {
   // Initialize return value
   int ncol_out(1);
 
-  // Get the output columns
-  int ncol_right = a2.get_ncol();
-  int ncol_left = a1.get_ncol();
-
   if (ncol_right == ncol_left) {
     ncol_out = ncol_right;
   } else if (ncol_left == 1) {
@@ -290,14 +377,10 @@ int array_detail::get_op_ncol_out(const Array &a1, const Array &a2) {
   return ncol_out;
 }
 
-int array_detail::get_op_nrow_out(const Array &a1, const Array &a2) {
+int array_detail::get_op_nrow_out(int nrow_left, int nrow_right) {
   // Initialize return value
   int nrow_out(1);
 
-  // Get the output rows
-  int nrow_right = a2.get_nrow();
-  int nrow_left = a1.get_nrow();
-
   if (nrow_right == nrow_left) {
     nrow_out = nrow_right;
   } else if (nrow_left == 1) {
@@ -310,3 +393,8 @@ int array_detail::get_op_nrow_out(const Array &a1, const Array &a2) {
 
   return nrow_out;
 }
+
+template class BasicArray<double>;
+template class BasicArray<float>;
+template BasicArray<double>::BasicArray(const BasicArray<float> &);
+template BasicArray<float>::BasicArray(const BasicArray<double> &);
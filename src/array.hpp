@@ -1,53 +1,686 @@
 #ifndef ARRAY_HPP
 #define ARRAY_HPP
 
+#include "array_view.hpp"
+#include "memory.hpp"
+#include "profile.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-// Generic row-major 2D arrays (vectors/matrices)
-class Array {
+namespace array_detail {
+template <typename E> class ArrayExpr;
+template <typename T> class ArrayLeaf;
+} // namespace array_detail
+
+// Generic row-major 2D arrays (vectors/matrices) of double or float values.
+// Storage comes from the calling thread's memory::get_allocator() when an
+// Array is constructed or copied, and is aligned to memory::ALIGNMENT.
+//
+// Array is BasicArray<double>. BasicArray<float> stores half the bytes, and
+// its elementwise operations, products and decompositions
+// (BasicLUDecomp<float>, BasicCholesky<float>) run on float kernels fitting
+// twice the values in each vector register. The two scalar types don't mix
+// within an expression.
+template <typename T> class BasicArray {
+  static_assert(std::is_same<T, double>::value ||
+                    std::is_same<T, float>::value,
+                "BasicArray holds double or float values");
+
 private:
   int nrow, ncol;
-  std::vector<double> vals;
+  std::vector<T, memory::StlAllocator<T>> vals;
+
+  // Evaluate an elementwise expression of this Array's shape into vals
+  template <typename E> void assign(const E &);
 
 public:
-  Array(int, int);
-  Array(const std::vector<double> &, int, int);
+  using value_type = T;
+
+  BasicArray(int, int);
+  BasicArray(const std::vector<T> &, int, int);
+
+  // Copy the values seen through a view into a new (contiguous) Array
+  explicit BasicArray(const BasicArrayView<const T> &);
+
+  // Convert the values of an Array of the other scalar type (rounding them
+  // to float, or widening them to double)
+  template <typename U, typename = std::enable_if_t<!std::is_same<U, T>::value>>
+  explicit BasicArray(const BasicArray<U> &);
+
+  // Moving leaves the source empty (0 x 0), so a moved-from Array never
+  // claims a shape without storage
+  BasicArray(const BasicArray &) = default;
+  BasicArray(BasicArray &&) noexcept;
+  BasicArray &operator=(const BasicArray &) = default;
+  BasicArray &operator=(BasicArray &&);
+
+  // Elementwise expressions (e.g. a * b + c) are evaluated in a single pass
+  // when they are converted to, or assigned into, an Array. A temporary
+  // expression holding a temporary Array of the result's shape (e.g.
+  // a.mult(b) + c) is evaluated into that Array's storage instead of a new
+  // allocation.
+  template <typename E> BasicArray(const array_detail::ArrayExpr<E> &);
+  template <typename E> BasicArray(array_detail::ArrayExpr<E> &&);
+  template <typename E>
+  BasicArray &operator=(const array_detail::ArrayExpr<E> &);
+  template <typename E> BasicArray &operator=(array_detail::ArrayExpr<E> &&);
 
   // Basic array attributes
   int get_nrow() const;
   int get_ncol() const;
-  std::vector<double> get_vals() const;
+  std::vector<T> get_vals() const;
+
+  // Zero-copy access to the values (row-major), as an alternative to get_vals
+  Span<T> span();
+  Span<const T> span() const;
+
+  // Non-owning views of the whole Array, a row, a column, a block or the
+  // transpose. Views point into this Array's storage, so they must not
+  // outlive it.
+  BasicArrayView<T> view();
+  BasicArrayView<const T> view() const;
+  operator BasicArrayView<const T>() const;
+  BasicArrayView<T> row(int);
+  BasicArrayView<const T> row(int) const;
+  BasicArrayView<T> col(int);
+  BasicArrayView<const T> col(int) const;
+  BasicArrayView<T> block(int r0, int c0, int nrows, int ncols);
+  BasicArrayView<const T> block(int r0, int c0, int nrows, int ncols) const;
+  BasicArrayView<T> t();
+  BasicArrayView<const T> t() const;
 
   // Standard setters/initializations
   void set_zeros();
   void set_ones();
   void eye();
-  void copy(Array &);
-  void set_vals(std::vector<double> &);
+  void copy(BasicArray &);
+  void set_vals(std::vector<T> &);
 
-  // Matrix multiplication
-  Array mult(Array &);
+  // Matrix multiplication (see also the free mult for views)
+  BasicArray mult(BasicArray &);
+  BasicArray mult(const BasicArrayView<const T> &) const;
 
   // Pretty print the array
   void pprint();
 
-  // Binary operations via friend functions
-  // TODO: Refactor to use member functions where possible
-  // TODO: Also implement with different signatures (e.g. double, Array)
-  double *operator[](int r);
-  friend Array operator+(const Array &, const Array &);
-  friend Array operator*(const Array &, const Array &);
-  friend Array operator-(const Array &, const Array &);
-  friend Array operator/(const Array &, const Array &);
+  // Binary operations (+, -, *, /) are lazy: see the expression templates
+  // below. Compound assignment evaluates in place; the right-hand side (an
+  // Array, view, expression or scalar) must broadcast to this Array's shape.
+  template <typename R> BasicArray &operator+=(const R &);
+  template <typename R> BasicArray &operator-=(const R &);
+  template <typename R> BasicArray &operator*=(const R &);
+  template <typename R> BasicArray &operator/=(const R &);
+
+  T *operator[](int r);
+  friend class array_detail::ArrayLeaf<T>;
 };
 
+using Array = BasicArray<double>;
+
+// Defined in array.cpp, for both scalar types
+extern template class BasicArray<double>;
+extern template class BasicArray<float>;
+
+// Matrix multiplication of (possibly strided or transposed) views
+Array mult(const ConstArrayView &, const ConstArrayView &);
+BasicArray<float> mult(const BasicArrayView<const float> &,
+                       const BasicArrayView<const float> &);
+
+// Matrix multiplication into out, which must already have the product's shape
+// and must not overlap either operand
+void mult(Array &out, const ConstArrayView &, const ConstArrayView &);
+void mult(BasicArray<float> &out, const BasicArrayView<const float> &,
+          const BasicArrayView<const float> &);
+
 // Internally used broadcasting rules: not put inside class defn to avoid
 // namespace pollution
 namespace array_detail {
-Array bcast(Array &input, int nrow, int ncol);
-std::vector<int> get_bcast_idx(const Array &, int nrow_out, int ncol_out);
+Array bcast(const Array &input, int nrow, int ncol);
 int get_op_nrow_out(const Array &, const Array &);
 int get_op_ncol_out(const Array &, const Array &);
+int get_op_nrow_out(int nrow_left, int nrow_right);
+int get_op_ncol_out(int ncol_left, int ncol_right);
+
+// Elementwise expression templates: each binary operator returns a lightweight
+// node that records its operands, so that a chain such as a * b + c / d - e
+// allocates nothing until it is converted to an Array, and is then evaluated
+// in a single pass. Nodes hold references to the Arrays they read, so an
+// expression must not outlive its operands (avoid storing one in an `auto`
+// variable).
+//
+// Evaluation is stride based: it walks the output a row at a time, in chunks
+// of BLOCK columns. Within a row every operand is either a contiguous run of
+// values (stride 1) or a single broadcast value (stride 0), so the four
+// broadcasting cases (same shape, scalar, column vector, row vector) all
+// reduce to tight loops over contiguous memory with no index arrays, which run
+// on the vectorized kernels in simd.hpp.
+//
+// An expression has the scalar type T (value_type) of its Array and view
+// operands, which must all agree: it is evaluated in T, into a BasicArray<T>.
+// Scalars take on the type of the expression they appear in.
+constexpr int BLOCK = 256;
+
+// A run of values produced for one chunk of a row
+template <typename T> struct Block {
+  const T *ptr;
+  std::ptrdiff_t stride;
+};
+
+template <typename E> class ArrayExpr {
+public:
+  const E &self() const { return static_cast<const E &>(*this); }
+  E &self() { return static_cast<E &>(*this); }
+  int get_nrow() const { return self().get_nrow(); }
+  int get_ncol() const { return self().get_ncol(); }
+
+  // Whether any operand is broadcast to reach a nrows x ncols result
+  bool broadcasts(int nrows, int ncols) const {
+    return get_nrow() != nrows || get_ncol() != ncols;
+  }
+};
+
+// Leaf node reading an Array: a dimension of length one is broadcast by
+// giving it a zero stride. Leaves never copy, so they need no scratch space.
+template <typename T> class ArrayLeaf : public ArrayExpr<ArrayLeaf<T>> {
+private:
+  const T *data;
+  int nrow, ncol;
+  std::ptrdiff_t row_stride, col_stride;
+
+public:
+  using value_type = T;
+  static constexpr int depth = 0;
+  static constexpr int n_ops = 0;
+  static constexpr int n_reads = 1;
+
+  explicit ArrayLeaf(const BasicArray<T> &a)
+      : data(a.vals.data()), nrow(a.nrow), ncol(a.ncol),
+        row_stride(a.nrow == 1 ? 0 : a.ncol), col_stride(a.ncol == 1 ? 0 : 1) {}
+
+  int get_nrow() const { return nrow; }
+  int get_ncol() const { return ncol; }
+
+  Block<T> block(int i, int j0, int, T *) const {
+    return {data + i * row_stride + j0 * col_stride, col_stride};
+  }
+
+  void eval_into(int i, int j0, int n, T *out, T *) const {
+    const T *in = data + i * row_stride + j0 * col_stride;
+    if (col_stride == 0) {
+      simd::fill(n, in[0], out);
+    } else {
+      std::copy(in, in + n, out);
+    }
+  }
+
+  // An Array is only ever read at the index being written, so writing the
+  // result over it (or over any other Array) is always safe
+  bool may_alias(const T *, const T *) const { return false; }
+
+  // Only temporaries may have their storage reused (see OwnedLeaf)
+  BasicArray<T> *reusable(int, int) { return nullptr; }
+};
+
+// Leaf node owning a temporary Array (an rvalue operand), read as ArrayLeaf
+// reads an Array. The result of the expression may be written over it when
+// their shapes match, saving an allocation.
+template <typename T> class OwnedLeaf : public ArrayExpr<OwnedLeaf<T>> {
+private:
+  BasicArray<T> owned;
+
+public:
+  using value_type = T;
+  static constexpr int depth = 0;
+  static constexpr int n_ops = 0;
+  static constexpr int n_reads = 1;
+
+  explicit OwnedLeaf(BasicArray<T> &&a) : owned(std::move(a)) {}
+
+  int get_nrow() const { return owned.get_nrow(); }
+  int get_ncol() const { return owned.get_ncol(); }
+
+  Block<T> block(int i, int j0, int n, T *scratch) const {
+    return ArrayLeaf<T>(owned).block(i, j0, n, scratch);
+  }
+
+  void eval_into(int i, int j0, int n, T *out, T *scratch) const {
+    ArrayLeaf<T>(owned).eval_into(i, j0, n, out, scratch);
+  }
+
+  bool may_alias(const T *, const T *) const { return false; }
+
+  BasicArray<T> *reusable(int nrows, int ncols) {
+    return (nrows == get_nrow() && ncols == get_ncol()) ? &owned : nullptr;
+  }
+};
+
+// Leaf node reading a view. Rows with a unit (or broadcast) column stride are
+// used in place; other strides (e.g. a transposed view) are gathered into one
+// BLOCK of scratch.
+template <typename T> class ViewLeaf : public ArrayExpr<ViewLeaf<T>> {
+private:
+  const T *data;
+  int nrow, ncol;
+  std::ptrdiff_t row_stride, col_stride;
+
+public:
+  using value_type = T;
+  static constexpr int depth = 1;
+  static constexpr int n_ops = 0;
+  static constexpr int n_reads = 1;
+
+  explicit ViewLeaf(const BasicArrayView<const T> &v)
+      : data(v.data()), nrow(v.get_nrow()), ncol(v.get_ncol()),
+        row_stride(v.get_nrow() == 1 ? 0 : v.row_stride()),
+        col_stride(v.get_ncol() == 1 ? 0 : v.col_stride()) {}
+
+  int get_nrow() const { return nrow; }
+  int get_ncol() const { return ncol; }
+
+  Block<T> block(int i, int j0, int n, T *scratch) const {
+    const T *in = data + i * row_stride + j0 * col_stride;
+    if (col_stride == 0 || col_stride == 1) {
+      return {in, col_stride};
+    }
+    for (int j = 0; j < n; ++j) {
+      scratch[j] = in[j * col_stride];
+    }
+    return {scratch, 1};
+  }
+
+  void eval_into(int i, int j0, int n, T *out, T *) const {
+    const T *in = data + i * row_stride + j0 * col_stride;
+    if (col_stride == 0) {
+      simd::fill(n, in[0], out);
+    } else {
+      for (int j = 0; j < n; ++j) {
+        out[j] = in[j * col_stride];
+      }
+    }
+  }
+
+  // A view may read a different index of the same storage (e.g. a row of
+  // the Array being written), so any overlap counts as aliasing
+  bool may_alias(const T *begin, const T *end) const {
+    if (nrow == 0 || ncol == 0) {
+      return false;
+    }
+    const T *last = data + (nrow - 1) * row_stride + (ncol - 1) * col_stride;
+    return data < end && last >= begin;
+  }
+
+  BasicArray<T> *reusable(int, int) { return nullptr; }
+};
+
+// Leaf node holding a scalar, broadcast as a 1 x 1 Array. The value is kept
+// in the node (in both scalar types), so it may come from a temporary, and it
+// is read in the type of the expression around it.
+class ScalarLeaf : public ArrayExpr<ScalarLeaf> {
+private:
+  double value;
+  float value_f;
+
+  const double *get(const double *) const { return &value; }
+  const float *get(const float *) const { return &value_f; }
+
+public:
+  using value_type = void; // any: see BinaryExpr
+  static constexpr int depth = 0;
+  static constexpr int n_ops = 0;
+  static constexpr int n_reads = 0;
+
+  explicit ScalarLeaf(double v) : value(v), value_f(static_cast<float>(v)) {}
+
+  int get_nrow() const { return 1; }
+  int get_ncol() const { return 1; }
+
+  template <typename T> Block<T> block(int, int, int, T *scratch) const {
+    return {get(scratch), 0};
+  }
+
+  template <typename T> void eval_into(int, int, int n, T *out, T *) const {
+    simd::fill(n, *get(out), out);
+  }
+
+  bool may_alias(const void *, const void *) const { return false; }
+
+  std::nullptr_t reusable(int, int) { return nullptr; }
+};
+
+// The scalar type of an expression with operands of types L and R (void for
+// a scalar, which takes on the other operand's type)
+template <typename L, typename R> struct common_value {
+  static_assert(std::is_same<L, R>::value || std::is_void<L>::value ||
+                    std::is_void<R>::value,
+                "Elementwise operands must have the same scalar type "
+                "(convert one, e.g. with BasicArray<float>(a))");
+  using type = std::conditional_t<std::is_void<L>::value, R, L>;
+};
+
+// Binary node: the output shape follows the broadcasting rules, and is checked
+// when the node is built. Each node needs one BLOCK of scratch for its own
+// result, plus whatever its operands need.
+template <typename Op, typename L, typename R>
+class BinaryExpr : public ArrayExpr<BinaryExpr<Op, L, R>> {
+public:
+  using value_type =
+      typename common_value<typename L::value_type,
+                            typename R::value_type>::type;
+
+private:
+  using T = value_type;
+  L lhs;
+  R rhs;
+  int nrow, ncol;
+
+public:
+  static constexpr int depth = 1 + L::depth + R::depth;
+
+  // Operations and operands read per output entry (estimates, for profiling)
+  static constexpr int n_ops = 1 + L::n_ops + R::n_ops;
+  static constexpr int n_reads = L::n_reads + R::n_reads;
+
+  BinaryExpr(L l, R r)
+      : lhs(std::move(l)), rhs(std::move(r)),
+        nrow(get_op_nrow_out(lhs.get_nrow(), rhs.get_nrow())),
+        ncol(get_op_ncol_out(lhs.get_ncol(), rhs.get_ncol())) {}
+
+  int get_nrow() const { return nrow; }
+  int get_ncol() const { return ncol; }
+
+  // Evaluate n entries of row i from column j0 directly into out
+  void eval_into(int i, int j0, int n, T *out, T *scratch) const {
+    Block<T> l = lhs.block(i, j0, n, scratch);
+    Block<T> r = rhs.block(i, j0, n, scratch + L::depth * BLOCK);
+    simd::binary(Op::code, n, l.ptr, l.stride, r.ptr, r.stride, out);
+  }
+
+  bool may_alias(const T *begin, const T *end) const {
+    return lhs.may_alias(begin, end) || rhs.may_alias(begin, end);
+  }
+
+  bool broadcasts(int nrows, int ncols) const {
+    return lhs.broadcasts(nrows, ncols) || rhs.broadcasts(nrows, ncols);
+  }
+
+  // A temporary operand of shape nrows x ncols, if there is one
+  BasicArray<T> *reusable(int nrows, int ncols) {
+    BasicArray<T> *a = lhs.reusable(nrows, ncols);
+    return a != nullptr ? a : rhs.reusable(nrows, ncols);
+  }
+
+  // Evaluate into scratch; a node that is itself broadcast along the row only
+  // computes its single value
+  Block<T> block(int i, int j0, int n, T *scratch) const {
+    if (ncol == 1) {
+      eval_into(i, 0, 1, scratch, scratch + BLOCK);
+      return {scratch, 0};
+    }
+    eval_into(i, j0, n, scratch, scratch + BLOCK);
+    return {scratch, 1};
+  }
+};
+
+// Operation tags, mapping each operator onto its vectorized kernel
+struct OpAdd {
+  static constexpr simd::Op code = simd::Op::add;
+};
+struct OpSub {
+  static constexpr simd::Op code = simd::Op::sub;
+};
+struct OpMul {
+  static constexpr simd::Op code = simd::Op::mul;
+};
+struct OpDiv {
+  static constexpr simd::Op code = simd::Op::div;
+};
+
+// Operands of the elementwise operators: Arrays, views and scalars enter
+// expressions as leaves, and expressions are used as they are. Temporary
+// Arrays and expressions are moved into the new node.
+template <typename T> ArrayLeaf<T> as_expr(const BasicArray<T> &a) {
+  return ArrayLeaf<T>(a);
+}
+template <typename T> OwnedLeaf<T> as_expr(BasicArray<T> &&a) {
+  return OwnedLeaf<T>(std::move(a));
+}
+template <typename T>
+ViewLeaf<std::remove_const_t<T>> as_expr(const BasicArrayView<T> &v) {
+  return ViewLeaf<std::remove_const_t<T>>(v);
+}
+template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+ScalarLeaf as_expr(const T &v) {
+  return ScalarLeaf(static_cast<double>(v));
+}
+template <typename E> const E &as_expr(const ArrayExpr<E> &e) {
+  return e.self();
+}
+template <typename E> E as_expr(ArrayExpr<E> &&e) {
+  return std::move(e.self());
+}
+
+template <typename T>
+using is_expr = std::is_base_of<ArrayExpr<T>, T>;
+
+template <typename T> struct is_array : std::false_type {};
+template <typename T> struct is_array<BasicArray<T>> : std::true_type {};
+
+template <typename T> struct is_view : std::false_type {};
+template <typename T> struct is_view<BasicArrayView<T>> : std::true_type {};
+
+template <typename T>
+struct is_operand
+    : std::integral_constant<bool, is_array<T>::value || is_view<T>::value ||
+                                       is_expr<T>::value ||
+                                       std::is_arithmetic<T>::value> {};
+
+// Node type of an operand forwarded as T (an rvalue unless T is a reference)
+template <typename T>
+using expr_t = std::decay_t<decltype(as_expr(std::declval<T>()))>;
+
+// The profiling category of evaluating an expression into a nrows x ncols
+// result: its last operator, marked as broadcasting if any operand is
+template <typename Op, typename L, typename R>
+profile::Op profile_op(const BinaryExpr<Op, L, R> &expr, int nrows,
+                       int ncols) {
+  int op = static_cast<int>(profile::Op::add) + static_cast<int>(Op::code);
+  if (expr.broadcasts(nrows, ncols)) {
+    op += static_cast<int>(profile::Op::add_bcast) -
+          static_cast<int>(profile::Op::add);
+  }
+  return static_cast<profile::Op>(op);
+}
+
+// Expressions are evaluated in their own scalar type, so only into an Array
+// of that type
+template <typename T, typename E> constexpr void check_value_type() {
+  static_assert(std::is_same<typename E::value_type, T>::value,
+                "An elementwise expression evaluates into an Array of its "
+                "scalar type (convert the result, e.g. with Array(...))");
+}
+
+template <typename Op, typename L, typename R>
+using binary_t =
+    std::enable_if_t<is_operand<std::decay_t<L>>::value &&
+                         is_operand<std::decay_t<R>>::value,
+                     BinaryExpr<Op, expr_t<L>, expr_t<R>>>;
 } // namespace array_detail
 
+// Binary (broadcasting) elementwise operations on Arrays, views, scalars and
+// expressions
+template <typename L, typename R>
+array_detail::binary_t<array_detail::OpAdd, L, R> operator+(L &&l, R &&r) {
+  return {array_detail::as_expr(std::forward<L>(l)),
+          array_detail::as_expr(std::forward<R>(r))};
+}
+
+template <typename L, typename R>
+array_detail::binary_t<array_detail::OpSub, L, R> operator-(L &&l, R &&r) {
+  return {array_detail::as_expr(std::forward<L>(l)),
+          array_detail::as_expr(std::forward<R>(r))};
+}
+
+template <typename L, typename R>
+array_detail::binary_t<array_detail::OpMul, L, R> operator*(L &&l, R &&r) {
+  return {array_detail::as_expr(std::forward<L>(l)),
+          array_detail::as_expr(std::forward<R>(r))};
+}
+
+template <typename L, typename R>
+array_detail::binary_t<array_detail::OpDiv, L, R> operator/(L &&l, R &&r) {
+  return {array_detail::as_expr(std::forward<L>(l)),
+          array_detail::as_expr(std::forward<R>(r))};
+}
+
+namespace array_detail {
+// Evaluate an expression into out, which must already have its shape: no
+// storage is allocated unless a view in the expression overlaps out
+template <typename T, typename E>
+void write(BasicArray<T> &out, const ArrayExpr<E> &expr) {
+  if (expr.get_nrow() != out.get_nrow() || expr.get_ncol() != out.get_ncol()) {
+    throw std::invalid_argument("Output dimensions incompatible");
+  }
+  out = expr;
+}
+} // namespace array_detail
+
+// Elementwise operations written into an existing Array of the broadcast
+// shape, e.g. add(out, a, b) for out = a + b. Reusing out across iterations
+// keeps a loop free of allocations.
+template <typename T, typename L, typename R,
+          typename = array_detail::binary_t<array_detail::OpAdd, L, R>>
+void add(BasicArray<T> &out, const L &l, const R &r) {
+  array_detail::write(out, l + r);
+}
+
+template <typename T, typename L, typename R,
+          typename = array_detail::binary_t<array_detail::OpSub, L, R>>
+void subtract(BasicArray<T> &out, const L &l, const R &r) {
+  array_detail::write(out, l - r);
+}
+
+template <typename T, typename L, typename R,
+          typename = array_detail::binary_t<array_detail::OpMul, L, R>>
+void multiply(BasicArray<T> &out, const L &l, const R &r) {
+  array_detail::write(out, l * r);
+}
+
+template <typename T, typename L, typename R,
+          typename = array_detail::binary_t<array_detail::OpDiv, L, R>>
+void divide(BasicArray<T> &out, const L &l, const R &r) {
+  array_detail::write(out, l / r);
+}
+
+template <typename T>
+template <typename R>
+BasicArray<T> &BasicArray<T>::operator+=(const R &r) {
+  array_detail::write(*this, *this + r);
+  return *this;
+}
+
+template <typename T>
+template <typename R>
+BasicArray<T> &BasicArray<T>::operator-=(const R &r) {
+  array_detail::write(*this, *this - r);
+  return *this;
+}
+
+template <typename T>
+template <typename R>
+BasicArray<T> &BasicArray<T>::operator*=(const R &r) {
+  array_detail::write(*this, *this * r);
+  return *this;
+}
+
+template <typename T>
+template <typename R>
+BasicArray<T> &BasicArray<T>::operator/=(const R &r) {
+  array_detail::write(*this, *this / r);
+  return *this;
+}
+
+template <typename T>
+template <typename E>
+void BasicArray<T>::assign(const E &expr) {
+  ULINALG_PROFILE_SCOPE(array_detail::profile_op(expr, nrow, ncol), nrow, ncol,
+                        static_cast<double>(E::n_ops) * nrow * ncol,
+                        1.0 * sizeof(T) * (E::n_reads + 1) * nrow * ncol);
+  T scratch[E::depth > 0 ? E::depth * array_detail::BLOCK : 1];
+  for (int i = 0; i < nrow; ++i) {
+    T *row = vals.data() + static_cast<std::ptrdiff_t>(i) * ncol;
+    for (int j0 = 0; j0 < ncol; j0 += array_detail::BLOCK) {
+      int n = std::min(array_detail::BLOCK, ncol - j0);
+      expr.eval_into(i, j0, n, row + j0, scratch);
+    }
+  }
+}
+
+template <typename T>
+template <typename E>
+BasicArray<T>::BasicArray(const array_detail::ArrayExpr<E> &expr)
+    : BasicArray(expr.get_nrow(), expr.get_ncol()) {
+  array_detail::check_value_type<T, E>();
+  assign(expr.self());
+}
+
+// Elementwise expressions only read Array operands at the index being
+// written, so when the shape is unchanged the result can be written in place
+// even if this Array appears in the expression (e.g. a = a + b). Only a view
+// into this Array (e.g. a = a + a.row(0)) forces a temporary.
+template <typename T>
+template <typename E>
+BasicArray<T> &
+BasicArray<T>::operator=(const array_detail::ArrayExpr<E> &expr) {
+  array_detail::check_value_type<T, E>();
+  const T *begin = vals.data();
+  if (expr.get_nrow() == nrow && expr.get_ncol() == ncol &&
+      !expr.self().may_alias(begin, begin + vals.size())) {
+    assign(expr.self());
+  } else {
+    *this = BasicArray(expr);
+  }
+  return *this;
+}
+
+// Evaluate into a temporary operand's storage when the expression holds one of
+// the right shape (and no view in the expression reads it at other indices),
+// then take that storage over
+template <typename T>
+template <typename E>
+BasicArray<T>::BasicArray(array_detail::ArrayExpr<E> &&expr)
+    : nrow(0), ncol(0) {
+  array_detail::check_value_type<T, E>();
+  E &e = expr.self();
+  BasicArray *reuse = e.reusable(e.get_nrow(), e.get_ncol());
+  if (reuse != nullptr) {
+    const T *begin = reuse->vals.data();
+    if (!e.may_alias(begin, begin + reuse->vals.size())) {
+      reuse->assign(e);
+      *this = std::move(*reuse);
+      return;
+    }
+  }
+  *this = BasicArray(static_cast<const array_detail::ArrayExpr<E> &>(expr));
+}
+
+template <typename T>
+template <typename E>
+BasicArray<T> &BasicArray<T>::operator=(array_detail::ArrayExpr<E> &&expr) {
+  array_detail::check_value_type<T, E>();
+  const T *begin = vals.data();
+  if (expr.get_nrow() == nrow && expr.get_ncol() == ncol &&
+      !expr.self().may_alias(begin, begin + vals.size())) {
+    assign(expr.self());
+  } else {
+    *this = BasicArray(std::move(expr));
+  }
+  return *this;
+}
+
 #endif
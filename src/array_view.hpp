@@ -0,0 +1,92 @@
+#ifndef ARRAY_VIEW_HPP
+#define ARRAY_VIEW_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+// Non-owning contiguous range of values (a minimal stand-in for C++20's
+// std::span)
+template <typename T> class Span {
+private:
+  T *ptr;
+  std::size_t len;
+
+public:
+  Span(T *data, std::size_t size) : ptr(data), len(size) {}
+
+  T *data() const { return ptr; }
+  std::size_t size() const { return len; }
+  bool empty() const { return len == 0; }
+  T *begin() const { return ptr; }
+  T *end() const { return ptr + len; }
+  T &operator[](std::size_t i) const { return ptr[i]; }
+};
+
+// Non-owning strided 2D view: element (i, j) lives at
+// data()[i * row_stride() + j * col_stride()]. Views are cheap to copy, and
+// slicing one (row, column, block or transpose) never copies any values. A
+// view is only valid while the storage it points into is.
+//
+// ArrayView allows writing through the view and converts implicitly to the
+// read-only ConstArrayView, which is what functions taking views accept.
+template <typename T> class BasicArrayView {
+private:
+  T *ptr;
+  int nrow, ncol;
+  std::ptrdiff_t rs, cs;
+
+public:
+  BasicArrayView(T *data, int nrows, int ncols, std::ptrdiff_t row_stride,
+                 std::ptrdiff_t col_stride)
+      : ptr(data), nrow(nrows), ncol(ncols), rs(row_stride), cs(col_stride) {}
+
+  template <typename U, typename = std::enable_if_t<
+                            std::is_same<const U, T>::value &&
+                            !std::is_same<U, T>::value>>
+  BasicArrayView(const BasicArrayView<U> &v)
+      : ptr(v.data()), nrow(v.get_nrow()), ncol(v.get_ncol()),
+        rs(v.row_stride()), cs(v.col_stride()) {}
+
+  int get_nrow() const { return nrow; }
+  int get_ncol() const { return ncol; }
+  std::ptrdiff_t row_stride() const { return rs; }
+  std::ptrdiff_t col_stride() const { return cs; }
+  T *data() const { return ptr; }
+
+  // True when the view covers a gap-free row-major range of memory
+  bool is_contiguous() const { return cs == 1 && (rs == ncol || nrow <= 1); }
+
+  T &operator()(int i, int j) const { return ptr[i * rs + j * cs]; }
+
+  BasicArrayView row(int i) const {
+    if (i < 0 || i >= nrow) {
+      throw std::out_of_range("Row index out of range");
+    }
+    return BasicArrayView(ptr + i * rs, 1, ncol, rs, cs);
+  }
+
+  BasicArrayView col(int j) const {
+    if (j < 0 || j >= ncol) {
+      throw std::out_of_range("Column index out of range");
+    }
+    return BasicArrayView(ptr + j * cs, nrow, 1, rs, cs);
+  }
+
+  // The nrows x ncols block with top-left corner at (r0, c0)
+  BasicArrayView block(int r0, int c0, int nrows, int ncols) const {
+    if (r0 < 0 || c0 < 0 || nrows < 0 || ncols < 0 || r0 + nrows > nrow ||
+        c0 + ncols > ncol) {
+      throw std::out_of_range("Block exceeds the viewed dimensions");
+    }
+    return BasicArrayView(ptr + r0 * rs + c0 * cs, nrows, ncols, rs, cs);
+  }
+
+  // Transpose, by swapping the strides
+  BasicArrayView t() const { return BasicArrayView(ptr, ncol, nrow, cs, rs); }
+};
+
+using ArrayView = BasicArrayView<double>;
+using ConstArrayView = BasicArrayView<const double>;
+
+#endif
@@ -0,0 +1,316 @@
+#include "banded.hpp"
+#include "decomp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace decomp_detail;
+
+namespace {
+
+// y[0:k] -= a * x[0:k], for rows of right-hand sides
+void sub_row(int k, double a, const double *x, double *y) {
+  for (int j = 0; j < k; ++j) {
+    y[j] -= a * x[j];
+  }
+}
+
+void scale_row(int k, double a, double *y) {
+  for (int j = 0; j < k; ++j) {
+    y[j] *= a;
+  }
+}
+
+// Copy of the right-hand sides of an n x n system
+Array solve_input(int n, const ConstArrayView &b) {
+  if (b.get_nrow() != n) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  return Array(b);
+}
+
+} // namespace
+
+BandedArray::BandedArray(int n, int kl, int ku) : n(n), kl(kl), ku(ku) {
+  if (n < 0 || kl < 0 || ku < 0) {
+    throw std::invalid_argument("Dimensions must be non-negative");
+  }
+  vals.assign(static_cast<std::size_t>(n) * (kl + ku + 1), 0.0);
+}
+
+BandedArray::BandedArray(const ConstArrayView &A, int kl, int ku)
+    : BandedArray(A.get_nrow(), kl, ku) {
+  check_square(A.get_nrow(), A.get_ncol());
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + ku); ++j) {
+      set(i, j, A(i, j));
+    }
+  }
+}
+
+int BandedArray::get_nrows() const { return n; }
+
+int BandedArray::get_ncols() const { return n; }
+
+int BandedArray::get_kl() const { return kl; }
+
+int BandedArray::get_ku() const { return ku; }
+
+double BandedArray::operator()(int i, int j) const {
+  if (i < 0 || i >= n || j < 0 || j >= n) {
+    throw std::out_of_range("Index out of range");
+  }
+  if (j - i < -kl || j - i > ku) {
+    return 0.0;
+  }
+  return vals[static_cast<std::size_t>(i) * (kl + ku + 1) + j - i + kl];
+}
+
+void BandedArray::set(int i, int j, double value) {
+  if (i < 0 || i >= n || j < 0 || j >= n || j - i < -kl || j - i > ku) {
+    throw std::out_of_range("Entry outside the band");
+  }
+  vals[static_cast<std::size_t>(i) * (kl + ku + 1) + j - i + kl] = value;
+}
+
+const double *BandedArray::data() const { return vals.data(); }
+
+Array BandedArray::to_dense() const {
+  Array res(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + ku); ++j) {
+      res[i][j] = (*this)(i, j);
+    }
+  }
+  return res;
+}
+
+Array BandedArray::mult(const ConstArrayView &x) const {
+  if (x.get_nrow() != n) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
+  }
+  int k = x.get_ncol();
+  Array res(n, k);
+  res.set_zeros();
+  for (int i = 0; i < n; ++i) {
+    double *res_i = res[i];
+    for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + ku); ++j) {
+      double a = (*this)(i, j);
+      for (int c = 0; c < k; ++c) {
+        res_i[c] += a * x(j, c);
+      }
+    }
+  }
+  return res;
+}
+
+BandedLUDecomp::BandedLUDecomp(const BandedArray &A)
+    : n(A.get_nrows()), kl(A.get_kl()), ku(A.get_ku()),
+      M(static_cast<std::size_t>(n) * (2 * kl + ku + 1), 0.0), p(n) {
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + ku); ++j) {
+      at(i, j) = A(i, j);
+    }
+  }
+}
+
+// Gaussian elimination within the band: the pivot for column k is searched
+// for in the kl rows below the diagonal, so after the swap row k extends to
+// column k + kl + ku (the storage's extra kl superdiagonals), and the update
+// touches only the kl x (kl + ku) block below and right of the pivot.
+void BandedLUDecomp::decompose() {
+  decomposed = false;
+  for (int k = 0; k < n; ++k) {
+    int last_row = std::min(n - 1, k + kl);
+    int last_col = std::min(n - 1, k + kl + ku);
+
+    int pivot_row = k;
+    double max_curr = std::abs(at(k, k));
+    for (int i = k + 1; i <= last_row; ++i) {
+      if (std::abs(at(i, k)) > max_curr) {
+        max_curr = std::abs(at(i, k));
+        pivot_row = i;
+      }
+    }
+    if (max_curr <= PIVOT_TOL<double>) {
+      throw std::runtime_error("Not able to proceed as pivot is below tol");
+    }
+
+    p[k] = pivot_row;
+    if (pivot_row != k) {
+      for (int j = k; j <= last_col; ++j) {
+        std::swap(at(k, j), at(pivot_row, j));
+      }
+    }
+
+    double inv_pivot = 1.0 / at(k, k);
+    for (int i = k + 1; i <= last_row; ++i) {
+      double l = at(i, k) *= inv_pivot;
+      for (int j = k + 1; j <= last_col; ++j) {
+        at(i, j) -= l * at(k, j);
+      }
+    }
+  }
+  decomposed = true;
+}
+
+Array BandedLUDecomp::solve(Array &b) const { return solve(b.view()); }
+
+Array BandedLUDecomp::solve(const ConstArrayView &b) const {
+  check_decomposed(decomposed);
+  Array x = solve_input(n, b);
+  int k = x.get_ncol();
+
+  // Apply each step's swap and multipliers, then back solve with U
+  for (int s = 0; s < n; ++s) {
+    if (p[s] != s) {
+      std::swap_ranges(x[s], x[s] + k, x[p[s]]);
+    }
+    for (int i = s + 1; i <= std::min(n - 1, s + kl); ++i) {
+      sub_row(k, at(i, s), x[s], x[i]);
+    }
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    for (int j = i + 1; j <= std::min(n - 1, i + kl + ku); ++j) {
+      sub_row(k, at(i, j), x[j], x[i]);
+    }
+    scale_row(k, 1.0 / at(i, i), x[i]);
+  }
+  return x;
+}
+
+int BandedLUDecomp::get_nrows() const { return n; }
+
+int BandedLUDecomp::get_ncols() const { return n; }
+
+BandedCholesky::BandedCholesky(const BandedArray &A)
+    : n(A.get_nrows()), kd(A.get_kl()),
+      M(static_cast<std::size_t>(n) * (kd + 1), 0.0) {
+  if (A.get_kl() != A.get_ku()) {
+    throw std::invalid_argument("Banded Cholesky needs kl == ku");
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kd); j <= i; ++j) {
+      at(i, j) = A(i, j);
+    }
+  }
+}
+
+// Row by row: L(i, j) = (A(i, j) - sum_k L(i, k) L(j, k)) / L(j, j), where
+// only the k within kd of i can be nonzero
+void BandedCholesky::decompose() {
+  decomposed = false;
+  for (int i = 0; i < n; ++i) {
+    int j0 = std::max(0, i - kd);
+    for (int j = j0; j <= i; ++j) {
+      double sum = at(i, j);
+      for (int k = j0; k < j; ++k) {
+        sum -= at(i, k) * at(j, k);
+      }
+      if (j < i) {
+        at(i, j) = sum / at(j, j);
+      } else if (!(sum > 0.0)) {
+        throw std::runtime_error(
+            "Matrix is not positive definite (leading minor of order " +
+            std::to_string(i + 1) + " is not positive)");
+      } else {
+        at(i, i) = std::sqrt(sum);
+      }
+    }
+  }
+  decomposed = true;
+}
+
+Array BandedCholesky::solve(Array &b) const { return solve(b.view()); }
+
+Array BandedCholesky::solve(const ConstArrayView &b) const {
+  check_decomposed(decomposed);
+  Array x = solve_input(n, b);
+  int k = x.get_ncol();
+
+  // Forward solve with L, then back solve with L^T (read by rows of L)
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kd); j < i; ++j) {
+      sub_row(k, at(i, j), x[j], x[i]);
+    }
+    scale_row(k, 1.0 / at(i, i), x[i]);
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    scale_row(k, 1.0 / at(i, i), x[i]);
+    for (int j = std::max(0, i - kd); j < i; ++j) {
+      sub_row(k, at(i, j), x[i], x[j]);
+    }
+  }
+  return x;
+}
+
+int BandedCholesky::get_nrows() const { return n; }
+
+int BandedCholesky::get_ncols() const { return n; }
+
+TridiagonalDecomp::TridiagonalDecomp(const std::vector<double> &lower,
+                                     const std::vector<double> &diag,
+                                     const std::vector<double> &upper)
+    : n(static_cast<int>(diag.size())), lower(lower), diag(diag),
+      upper(upper) {
+  std::size_t off = diag.empty() ? 0 : diag.size() - 1;
+  if (lower.size() != off || upper.size() != off) {
+    throw std::invalid_argument("Diagonal lengths incompatible");
+  }
+}
+
+TridiagonalDecomp::TridiagonalDecomp(const BandedArray &A)
+    : n(A.get_nrows()), lower(std::max(0, n - 1)), diag(n),
+      upper(std::max(0, n - 1)) {
+  if (A.get_kl() != 1 || A.get_ku() != 1) {
+    throw std::invalid_argument("Tridiagonal matrices need kl == ku == 1");
+  }
+  for (int i = 0; i < n; ++i) {
+    diag[i] = A(i, i);
+    if (i + 1 < n) {
+      lower[i] = A(i + 1, i);
+      upper[i] = A(i, i + 1);
+    }
+  }
+}
+
+// Eliminate each subdiagonal entry with the row above: the multiplier
+// replaces it, and the diagonal becomes the pivot (U keeps the superdiagonal)
+void TridiagonalDecomp::decompose() {
+  decomposed = false;
+  for (int i = 0; i < n; ++i) {
+    if (i > 0) {
+      lower[i - 1] /= diag[i - 1];
+      diag[i] -= lower[i - 1] * upper[i - 1];
+    }
+    if (std::abs(diag[i]) <= PIVOT_TOL<double>) {
+      throw std::runtime_error("Not able to proceed as pivot is below tol");
+    }
+  }
+  decomposed = true;
+}
+
+Array TridiagonalDecomp::solve(Array &b) const { return solve(b.view()); }
+
+Array TridiagonalDecomp::solve(const ConstArrayView &b) const {
+  check_decomposed(decomposed);
+  Array x = solve_input(n, b);
+  int k = x.get_ncol();
+  for (int i = 1; i < n; ++i) {
+    sub_row(k, lower[i - 1], x[i - 1], x[i]);
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    if (i + 1 < n) {
+      sub_row(k, upper[i], x[i + 1], x[i]);
+    }
+    scale_row(k, 1.0 / diag[i], x[i]);
+  }
+  return x;
+}
+
+int TridiagonalDecomp::get_nrows() const { return n; }
+
+int TridiagonalDecomp::get_ncols() const { return n; }
@@ -0,0 +1,141 @@
+#ifndef BANDED_HPP
+#define BANDED_HPP
+
+#include "array.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Square banded matrices: only the entries (i, j) with -kl <= j - i <= ku are
+// stored, in n rows of kl + ku + 1 values. Row i holds columns i - kl to
+// i + ku, with the entries past the corners of the matrix unused (zero).
+class BandedArray {
+private:
+  int n, kl, ku;
+  std::vector<double> vals;
+
+public:
+  // An all-zero n x n matrix with kl subdiagonals and ku superdiagonals
+  BandedArray(int n, int kl, int ku);
+
+  // The band of a square dense matrix (entries outside it are dropped)
+  BandedArray(const ConstArrayView &, int kl, int ku);
+
+  int get_nrows() const;
+  int get_ncols() const;
+  int get_kl() const;
+  int get_ku() const;
+
+  // Entry (i, j), zero outside the band. Throws std::out_of_range outside
+  // the matrix.
+  double operator()(int i, int j) const;
+
+  // Set entry (i, j). Throws std::out_of_range outside the band.
+  void set(int i, int j, double value);
+
+  // Row-major band storage: entry (i, j) is data()[i * width + j - i + kl],
+  // with width = kl + ku + 1
+  const double *data() const;
+
+  Array to_dense() const;
+
+  // Banded x dense matrix multiplication
+  Array mult(const ConstArrayView &) const;
+};
+
+// LU decomposition with partial pivoting of a banded matrix, in O(n kl (kl +
+// ku)) time and O(n (2 kl + ku)) memory. Row swaps widen U to kl + ku
+// superdiagonals; the multipliers of L are kept below the diagonal of the
+// columns that produced them, and applied with the swaps during solve.
+class BandedLUDecomp {
+private:
+  int n, kl, ku;
+  std::vector<double> M; // rows of width 2 kl + ku + 1, from column i - kl
+  std::vector<int> p;    // row k was swapped with row p[k] at step k
+  bool decomposed = false;
+
+  double &at(int i, int j) {
+    return M[static_cast<std::size_t>(i) * (2 * kl + ku + 1) + j - i + kl];
+  }
+  double at(int i, int j) const {
+    return M[static_cast<std::size_t>(i) * (2 * kl + ku + 1) + j - i + kl];
+  }
+
+public:
+  BandedLUDecomp(const BandedArray &);
+
+  // Throws std::runtime_error if a pivot is below tolerance
+  void decompose();
+
+  // Solve A X = B for an n x k B (k right-hand sides at once). Throws
+  // std::logic_error unless decompose() has succeeded.
+  Array solve(Array &) const;
+  Array solve(const ConstArrayView &) const;
+
+  int get_nrows() const;
+  int get_ncols() const;
+};
+
+// Cholesky decomposition A = L L^T of a symmetric positive definite banded
+// matrix with kd = kl = ku, in O(n kd^2) time and O(n kd) memory. Only the
+// lower band is read.
+class BandedCholesky {
+private:
+  int n, kd;
+  std::vector<double> M; // rows of width kd + 1, from column i - kd
+  bool decomposed = false;
+
+  double &at(int i, int j) {
+    return M[static_cast<std::size_t>(i) * (kd + 1) + j - i + kd];
+  }
+  double at(int i, int j) const {
+    return M[static_cast<std::size_t>(i) * (kd + 1) + j - i + kd];
+  }
+
+public:
+  // Throws std::invalid_argument unless kl == ku
+  BandedCholesky(const BandedArray &);
+
+  // Throws std::runtime_error if A is not positive definite
+  void decompose();
+
+  // Solve A X = B for an n x k B (k right-hand sides at once). Throws
+  // std::logic_error unless decompose() has succeeded.
+  Array solve(Array &) const;
+  Array solve(const ConstArrayView &) const;
+
+  int get_nrows() const;
+  int get_ncols() const;
+};
+
+// Tridiagonal systems by the Thomas algorithm (LU without pivoting), in O(n)
+// time and memory. Without pivoting it needs a matrix that is diagonally
+// dominant or symmetric positive definite to be stable.
+class TridiagonalDecomp {
+private:
+  int n;
+  std::vector<double> lower, diag, upper; // sub-, main and superdiagonal
+  bool decomposed = false;
+
+public:
+  // The n - 1 subdiagonal, n diagonal and n - 1 superdiagonal entries
+  TridiagonalDecomp(const std::vector<double> &lower,
+                    const std::vector<double> &diag,
+                    const std::vector<double> &upper);
+
+  // Throws std::invalid_argument unless kl == ku == 1
+  TridiagonalDecomp(const BandedArray &);
+
+  // Throws std::runtime_error if a pivot is below tolerance
+  void decompose();
+
+  // Solve A X = B for an n x k B (k right-hand sides at once). Throws
+  // std::logic_error unless decompose() has succeeded.
+  Array solve(Array &) const;
+  Array solve(const ConstArrayView &) const;
+
+  int get_nrows() const;
+  int get_ncols() const;
+};
+
+#endif
@@ -0,0 +1,592 @@
+#include "batch.hpp"
+#include "decomp.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "simd_detail.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+using namespace decomp_detail;
+
+namespace {
+
+using namespace simd_detail;
+
+constexpr int LANES = BatchArray::LANES;
+
+// Lanes per task when a batch is split across threads
+constexpr int LANES_PER_TASK = 512;
+
+enum class Kind { lu, lu_solve, chol, chol_solve };
+
+// One batched operation over n_groups groups of interleaved n x n matrices
+struct Job {
+  Kind kind;
+  int n;
+  int k; // columns of the right-hand sides (solves)
+  int n_groups;
+  double *A;         // matrices factored in place (factorizations)
+  int *piv;          // LU pivots written by the factorization
+  int *info;         // per-matrix status written by the factorizations
+  const double *F;   // factors (solves)
+  const int *pivots; // LU pivots (solves)
+  double *X;         // right-hand sides, overwritten by the solutions
+};
+
+// The kernels below process the W lanes (matrices) starting at lane b of a
+// job, with V a double (W = 1) or a vector of W doubles; W divides LANES, so
+// the lanes are all in one group. Within a group, entry (i, j) of every lane
+// is at (i * n + j) * LANES, so W lanes load as one vector.
+std::size_t group_offset(int b, int rows, int cols) {
+  return static_cast<std::size_t>(b / LANES) * rows * cols * LANES +
+         b % LANES;
+}
+
+// Whether any (or every) lane of a comparison's mask is set
+template <int W, typename M> ULINALG_ALWAYS_INLINE bool any_lane(const M &m) {
+  if constexpr (W == 1) {
+    return m;
+  } else {
+    bool res = false;
+    for (int l = 0; l < W; ++l) {
+      res = res || m[l];
+    }
+    return res;
+  }
+}
+
+template <int W, typename M> ULINALG_ALWAYS_INLINE bool all_lanes(const M &m) {
+  if constexpr (W == 1) {
+    return m;
+  } else {
+    bool res = true;
+    for (int l = 0; l < W; ++l) {
+      res = res && m[l];
+    }
+    return res;
+  }
+}
+
+// Call f(i) for i in [begin, end). The kernels take the matrix order N as a
+// template argument for the orders dispatched in run_sized, where the bounds
+// of every loop are constants and the loops are unrolled completely; N = 0
+// reads the order from the job, and leaves the loops as they are.
+template <int N, typename F>
+ULINALG_ALWAYS_INLINE void for_range(int begin, int end, const F &f) {
+  if constexpr (N > 0) {
+    ULINALG_UNROLL
+    for (int i = begin; i < end; ++i) {
+      f(i);
+    }
+  } else {
+    for (int i = begin; i < end; ++i) {
+      f(i);
+    }
+  }
+}
+
+// The kernels are written in Crout form: each entry of a factor (or of a
+// solution) is computed once, as its input value less a dot product, and
+// stored once. Updating the trailing entries at every step instead would store
+// and reload each of them n times.
+
+// out[r * out_step] -= sum over m < len of p[r * p_r + m * p_m] q[m * q_m]
+// for r < R, each term a vector of W lanes: R rows sharing q, so that each
+// load of q feeds R independent multiply-adds
+template <typename V, int N, int R>
+ULINALG_ALWAYS_INLINE void sub_dots(double *out, std::ptrdiff_t out_step,
+                                    const double *p, std::ptrdiff_t p_r,
+                                    std::ptrdiff_t p_m, const double *q,
+                                    std::ptrdiff_t q_m, int len) {
+  V sum[R];
+  for (int r = 0; r < R; ++r) {
+    sum[r] = load<V>(out + r * out_step);
+  }
+  for_range<N>(0, len, [&](int m) {
+    V q_m_val = load<V>(q + m * q_m);
+    for (int r = 0; r < R; ++r) {
+      sum[r] -= load<V>(p + r * p_r + m * p_m) * q_m_val;
+    }
+  });
+  for (int r = 0; r < R; ++r) {
+    store(out + r * out_step, sum[r]);
+  }
+}
+
+// sub_dots over rows [r0, r1), four at a time
+template <typename V, int N>
+ULINALG_ALWAYS_INLINE void sub_dots_rows(int r0, int r1, double *out,
+                                         std::ptrdiff_t out_step,
+                                         const double *p, std::ptrdiff_t p_r,
+                                         std::ptrdiff_t p_m, const double *q,
+                                         std::ptrdiff_t q_m, int len) {
+  int blocks = (r1 - r0) / 4;
+  for_range<N>(0, blocks, [&](int blk) {
+    int r = r0 + 4 * blk;
+    sub_dots<V, N, 4>(out + r * out_step, out_step, p + r * p_r, p_r, p_m, q,
+                      q_m, len);
+  });
+  for_range<N>(r0 + 4 * blocks, r1, [&](int r) {
+    sub_dots<V, N, 1>(out + r * out_step, out_step, p + r * p_r, p_r, p_m, q,
+                      q_m, len);
+  });
+}
+
+// The sum over m < len of p[m * p_step] q[m * q_step], in four partial sums
+// to keep independent multiply-adds in flight (for the solves, where each
+// entry waits on the previous one)
+template <typename V, int N>
+ULINALG_ALWAYS_INLINE V dot_lanes(const double *p, std::ptrdiff_t p_step,
+                                  const double *q, std::ptrdiff_t q_step,
+                                  int len) {
+  auto term = [&](int m) {
+    return load<V>(p + m * p_step) * load<V>(q + m * q_step);
+  };
+  V s0 = splat<V>(0.0), s1 = s0, s2 = s0, s3 = s0;
+  int blocks = len / 4;
+  for_range<N>(0, blocks, [&](int blk) {
+    int m = 4 * blk;
+    s0 += term(m);
+    s1 += term(m + 1);
+    s2 += term(m + 2);
+    s3 += term(m + 3);
+  });
+  for_range<N>(4 * blocks, len, [&](int m) { s0 += term(m); });
+  return (s0 + s1) + (s2 + s3);
+}
+
+template <typename V, int W, int N>
+ULINALG_ALWAYS_INLINE void lu_lanes(const Job &job, int b) {
+  const int n = N > 0 ? N : job.n;
+  double *A = job.A + group_offset(b, n, n);
+  int *piv = job.piv + group_offset(b, n, 1);
+  auto at = [&](int i, int j) { return A + (i * n + j) * LANES; };
+  const std::ptrdiff_t row = LANES, col = n * LANES;
+  const V zero = splat<V>(0.0);
+  const V one = splat<V>(1.0);
+  const V tol = splat<V>(PIVOT_TOL<double>);
+
+  for_range<N>(0, n, [&](int k) {
+    // Update column k on and below the diagonal with the columns of L to its
+    // left, then find each lane's pivot row (having the maximal entry)
+    sub_dots_rows<V, N>(k, n, at(0, k), col, at(0, 0), col, row, at(0, k), col,
+                        k);
+    V a = load<V>(at(k, k));
+    V max_curr = a < zero ? -a : a;
+    V pivot_row = splat<V>(k);
+    for_range<N>(k + 1, n, [&](int i) {
+      V v = load<V>(at(i, k));
+      v = v < zero ? -v : v;
+      auto larger = v > max_curr;
+      max_curr = larger ? v : max_curr;
+      pivot_row = larger ? splat<V>(i) : pivot_row;
+    });
+
+    // Record the pivots; rows are swapped and failures recorded lane by lane,
+    // only in the groups that need it
+    double rows[W];
+    store(rows, pivot_row);
+    for (int l = 0; l < W; ++l) {
+      piv[k * LANES + l] = static_cast<int>(rows[l]);
+    }
+    if (any_lane<W>(pivot_row != splat<V>(k))) {
+      for (int l = 0; l < W; ++l) {
+        int r = static_cast<int>(rows[l]);
+        if (r != k) {
+          for (int j = 0; j < n; ++j) {
+            std::swap(at(k, j)[l], at(r, j)[l]);
+          }
+        }
+      }
+    }
+    auto ok = max_curr > tol;
+    if (!all_lanes<W>(ok)) {
+      double maxes[W];
+      store(maxes, max_curr);
+      for (int l = 0; l < W; ++l) {
+        if (!(maxes[l] > PIVOT_TOL<double>) && job.info[b + l] == 0) {
+          job.info[b + l] = k + 1;
+        }
+      }
+    }
+
+    // Update row k of U right of the diagonal with the rows above it
+    sub_dots_rows<V, N>(k + 1, n, at(k, 0), row, at(0, 0), row, col,
+                        at(k, 0), row, k);
+
+    // Compute the multipliers, dividing as LUDecomp does so that later pivots
+    // match its own; failed lanes divide by one instead, so they can't raise
+    // floating point exceptions in the others
+    V pivot = ok ? load<V>(at(k, k)) : one;
+    for_range<N>(k + 1, n,
+                 [&](int i) { store(at(i, k), load<V>(at(i, k)) / pivot); });
+  });
+}
+
+template <typename V, int W, int N>
+ULINALG_ALWAYS_INLINE void lu_solve_lanes(const Job &job, int b) {
+  const int n = N > 0 ? N : job.n;
+  const int k = job.k;
+  const double *A = job.F + group_offset(b, n, n);
+  double *X = job.X + group_offset(b, n, k);
+  auto a_at = [&](int i, int j) { return A + (i * n + j) * LANES; };
+  auto x_at = [&](int i, int j) { return X + (i * k + j) * LANES; };
+  const std::ptrdiff_t a_row = LANES, x_col = k * LANES;
+  const int *pivots = job.pivots + group_offset(b, n, 1);
+  const V zero = splat<V>(0.0);
+  const V one = splat<V>(1.0);
+  const V tol = splat<V>(PIVOT_TOL<double>);
+
+  // Apply the row swaps, in the order they were made
+  for (int i = 0; i < n; ++i) {
+    bool moved = false;
+    for (int l = 0; l < W; ++l) {
+      moved = moved || pivots[i * LANES + l] != i;
+    }
+    if (!moved) {
+      continue;
+    }
+    for (int l = 0; l < W; ++l) {
+      int r = pivots[i * LANES + l];
+      if (r != i) {
+        for (int j = 0; j < k; ++j) {
+          std::swap(x_at(i, j)[l], x_at(r, j)[l]);
+        }
+      }
+    }
+  }
+
+  // Forward solve with the unit lower L, then backsolve with U
+  for_range<N>(1, n, [&](int i) {
+    for (int j = 0; j < k; ++j) {
+      V sum = dot_lanes<V, N>(a_at(i, 0), a_row, x_at(0, j), x_col, i);
+      store(x_at(i, j), load<V>(x_at(i, j)) - sum);
+    }
+  });
+  for_range<N>(0, n, [&](int t) {
+    int i = n - 1 - t;
+    // Failed lanes divide by one, as in lu_lanes
+    V u_ii = load<V>(a_at(i, i));
+    V u_abs = u_ii < zero ? -u_ii : u_ii;
+    V inv = one / (u_abs > tol ? u_ii : one);
+    for (int j = 0; j < k; ++j) {
+      V sum =
+          dot_lanes<V, N>(a_at(i, i + 1), a_row, x_at(i + 1, j), x_col, t);
+      store(x_at(i, j), (load<V>(x_at(i, j)) - sum) * inv);
+    }
+  });
+}
+
+template <typename V, int W, int N>
+ULINALG_ALWAYS_INLINE void chol_lanes(const Job &job, int b) {
+  const int n = N > 0 ? N : job.n;
+  double *A = job.A + group_offset(b, n, n);
+  auto at = [&](int i, int j) { return A + (i * n + j) * LANES; };
+  const std::ptrdiff_t row = LANES, col = n * LANES;
+  const V zero = splat<V>(0.0);
+  const V one = splat<V>(1.0);
+
+  for_range<N>(0, n, [&](int j) {
+    // Update column j on and below the diagonal with the columns to its left
+    sub_dots_rows<V, N>(j, n, at(0, j), col, at(0, 0), col, row, at(j, 0),
+                        row, j);
+
+    // Failed lanes (including NaN) carry on with a unit diagonal
+    V d = load<V>(at(j, j));
+    auto positive = d > zero;
+    if (!all_lanes<W>(positive)) {
+      double diag[W];
+      store(diag, d);
+      for (int l = 0; l < W; ++l) {
+        if (!(diag[l] > 0.0) && job.info[b + l] == 0) {
+          job.info[b + l] = j + 1;
+        }
+      }
+      d = positive ? d : one;
+    }
+    double diag[W];
+    store(diag, d);
+    for (int l = 0; l < W; ++l) {
+      diag[l] = std::sqrt(diag[l]);
+    }
+    V l_jj = load<V>(diag);
+
+    store(at(j, j), l_jj);
+    V inv = one / l_jj;
+    for_range<N>(j + 1, n,
+                 [&](int i) { store(at(i, j), load<V>(at(i, j)) * inv); });
+  });
+}
+
+template <typename V, int W, int N>
+ULINALG_ALWAYS_INLINE void chol_solve_lanes(const Job &job, int b) {
+  const int n = N > 0 ? N : job.n;
+  const int k = job.k;
+  const double *A = job.F + group_offset(b, n, n);
+  double *X = job.X + group_offset(b, n, k);
+  auto a_at = [&](int i, int j) { return A + (i * n + j) * LANES; };
+  auto x_at = [&](int i, int j) { return X + (i * k + j) * LANES; };
+  const std::ptrdiff_t a_row = LANES, a_col = n * LANES, x_col = k * LANES;
+  const V zero = splat<V>(0.0);
+  const V one = splat<V>(1.0);
+
+  // Lanes without a positive diagonal divide by one, as in chol_lanes
+  auto inv_diag = [&](int i) {
+    V l_ii = load<V>(a_at(i, i));
+    return one / (l_ii > zero ? l_ii : one);
+  };
+
+  // Forward solve with L, then backsolve with L^T
+  for_range<N>(0, n, [&](int i) {
+    V inv = inv_diag(i);
+    for (int j = 0; j < k; ++j) {
+      V sum = dot_lanes<V, N>(a_at(i, 0), a_row, x_at(0, j), x_col, i);
+      store(x_at(i, j), (load<V>(x_at(i, j)) - sum) * inv);
+    }
+  });
+  for_range<N>(0, n, [&](int t) {
+    int i = n - 1 - t;
+    V inv = inv_diag(i);
+    for (int j = 0; j < k; ++j) {
+      V sum =
+          dot_lanes<V, N>(a_at(i + 1, i), a_col, x_at(i + 1, j), x_col, t);
+      store(x_at(i, j), (load<V>(x_at(i, j)) - sum) * inv);
+    }
+  });
+}
+
+// Run a job over lanes [b0, b1), W at a time
+template <typename V, int W, int N>
+ULINALG_ALWAYS_INLINE void run_variant(const Job &job, int b0, int b1) {
+  for (int b = b0; b < b1; b += W) {
+    switch (job.kind) {
+    case Kind::lu:
+      lu_lanes<V, W, N>(job, b);
+      break;
+    case Kind::lu_solve:
+      lu_solve_lanes<V, W, N>(job, b);
+      break;
+    case Kind::chol:
+      chol_lanes<V, W, N>(job, b);
+      break;
+    case Kind::chol_solve:
+      chol_solve_lanes<V, W, N>(job, b);
+      break;
+    }
+  }
+}
+
+// Dispatch on the matrix order: the kernels are compiled for each order up
+// to MAX_SIZED, where unrolling pays the most. Beyond it, unrolled code grows
+// as n^3 and gains little over the loops.
+constexpr int MAX_SIZED = 8;
+
+template <typename V, int W, int N = 1>
+ULINALG_ALWAYS_INLINE void run_sized(const Job &job, int b0, int b1) {
+  if constexpr (N > MAX_SIZED) {
+    run_variant<V, W, 0>(job, b0, b1);
+  } else if (job.n == N) {
+    run_variant<V, W, N>(job, b0, b1);
+  } else {
+    run_sized<V, W, N + 1>(job, b0, b1);
+  }
+}
+
+void run_scalar(const Job &job, int b0, int b1) {
+  run_sized<double, 1>(job, b0, b1);
+}
+
+// The vector variants are flattened: the kernels' loop bodies (lambdas) must
+// be inlined to be compiled for the wrapper's instruction set
+#ifdef ULINALG_SIMD_X86
+__attribute__((target("sse2"), flatten)) void run_sse2(const Job &job,
+                                                       int b0, int b1) {
+  run_sized<v2d, 2>(job, b0, b1);
+}
+
+__attribute__((target("avx2"), flatten)) void run_avx2(const Job &job,
+                                                       int b0, int b1) {
+  run_sized<v4d, 4>(job, b0, b1);
+}
+
+__attribute__((target("avx512f"), flatten)) void run_avx512(const Job &job,
+                                                           int b0, int b1) {
+  run_sized<v8d, 8>(job, b0, b1);
+}
+#endif
+
+// Run a job over the whole (padded) batch, in parallel for large batches
+void run(const Job &job) {
+  int n_lanes = job.n_groups * LANES;
+  int n_tasks = (n_lanes + LANES_PER_TASK - 1) / LANES_PER_TASK;
+  simd::Isa isa = simd::get_isa();
+  parallel::parallel_for(n_tasks, [&](int t) {
+    int b0 = t * LANES_PER_TASK;
+    int b1 = std::min(n_lanes, b0 + LANES_PER_TASK);
+    switch (isa) {
+#ifdef ULINALG_SIMD_X86
+    case simd::Isa::avx512:
+      run_avx512(job, b0, b1);
+      return;
+    case simd::Isa::avx2:
+      run_avx2(job, b0, b1);
+      return;
+    case simd::Isa::sse2:
+      run_sse2(job, b0, b1);
+      return;
+#endif
+    default:
+      run_scalar(job, b0, b1);
+    }
+  });
+}
+
+// Check right-hand sides against the factors
+void check_solve_input(const BatchArray &M, const BatchArray &B) {
+  if (B.get_count() != M.get_count() || B.get_nrow() != M.get_nrow()) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+}
+
+} // namespace
+
+BatchArray::BatchArray(int count, int nrows, int ncols)
+    : count(count), nrow(nrows), ncol(ncols) {
+  if (count < 0 || nrows < 0 || ncols < 0) {
+    throw std::invalid_argument("Batch dimensions must be non-negative");
+  }
+  vals.resize(static_cast<std::size_t>(get_groups()) * nrow * ncol * LANES);
+}
+
+int BatchArray::get_count() const { return count; }
+
+int BatchArray::get_nrow() const { return nrow; }
+
+int BatchArray::get_ncol() const { return ncol; }
+
+int BatchArray::get_groups() const { return (count + LANES - 1) / LANES; }
+
+double *BatchArray::data() { return vals.data(); }
+
+const double *BatchArray::data() const { return vals.data(); }
+
+void BatchArray::set(int b, const ConstArrayView &A) {
+  if (b < 0 || b >= count) {
+    throw std::out_of_range("Batch index out of range");
+  }
+  if (A.get_nrow() != nrow || A.get_ncol() != ncol) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      (*this)(b, i, j) = A(i, j);
+    }
+  }
+}
+
+Array BatchArray::get(int b) const {
+  if (b < 0 || b >= count) {
+    throw std::out_of_range("Batch index out of range");
+  }
+  Array A(nrow, ncol);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      A[i][j] = (*this)(b, i, j);
+    }
+  }
+  return A;
+}
+
+BatchLUDecomp::BatchLUDecomp(BatchArray A)
+    : n(A.get_nrow()), M(std::move(A)) {
+  check_square(M.get_nrow(), M.get_ncol());
+}
+
+void BatchLUDecomp::decompose() {
+  piv.assign(static_cast<std::size_t>(M.get_groups()) * n * LANES, 0);
+  info.assign(M.get_groups() * LANES, 0);
+  Job job{};
+  job.kind = Kind::lu;
+  job.n = n;
+  job.n_groups = M.get_groups();
+  job.A = M.data();
+  job.piv = piv.data();
+  job.info = info.data();
+  run(job);
+  info.resize(M.get_count());
+  decomposed = true;
+}
+
+BatchArray BatchLUDecomp::solve(BatchArray X) const {
+  check_decomposed(decomposed);
+  check_solve_input(M, X);
+  Job job{};
+  job.kind = Kind::lu_solve;
+  job.n = n;
+  job.k = X.get_ncol();
+  job.n_groups = M.get_groups();
+  job.F = M.data();
+  job.pivots = piv.data();
+  job.X = X.data();
+  run(job);
+  return X;
+}
+
+const BatchArray &BatchLUDecomp::get_factors() const { return M; }
+
+const std::vector<int> &BatchLUDecomp::get_info() const { return info; }
+
+std::vector<int> BatchLUDecomp::get_pivots(int b) const {
+  if (b < 0 || b >= M.get_count()) {
+    throw std::out_of_range("Batch index out of range");
+  }
+  check_decomposed(decomposed);
+  std::vector<int> p(n);
+  for (int i = 0; i < n; ++i) {
+    p[i] = i;
+  }
+  for (int k = 0; k < n; ++k) {
+    std::swap(p[k], p[piv[group_offset(b, n, 1) + k * LANES]]);
+  }
+  return p;
+}
+
+BatchCholesky::BatchCholesky(BatchArray A)
+    : n(A.get_nrow()), M(std::move(A)) {
+  check_square(M.get_nrow(), M.get_ncol());
+}
+
+void BatchCholesky::decompose() {
+  info.assign(M.get_groups() * LANES, 0);
+  Job job{};
+  job.kind = Kind::chol;
+  job.n = n;
+  job.n_groups = M.get_groups();
+  job.A = M.data();
+  job.info = info.data();
+  run(job);
+  info.resize(M.get_count());
+  decomposed = true;
+}
+
+BatchArray BatchCholesky::solve(BatchArray X) const {
+  check_decomposed(decomposed);
+  check_solve_input(M, X);
+  Job job{};
+  job.kind = Kind::chol_solve;
+  job.n = n;
+  job.k = X.get_ncol();
+  job.n_groups = M.get_groups();
+  job.F = M.data();
+  job.X = X.data();
+  run(job);
+  return X;
+}
+
+const BatchArray &BatchCholesky::get_factors() const { return M; }
+
+const std::vector<int> &BatchCholesky::get_info() const { return info; }
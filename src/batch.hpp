@@ -0,0 +1,108 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "array.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A batch of same-sized matrices stored batch-interleaved (structure of
+// arrays) in groups of LANES matrices: within a group, entry (i, j) of each
+// of its matrices is stored contiguously, so that one SIMD vector holds the
+// same entry of several matrices. Entry (i, j) of matrix b lives at
+//   data()[((b / LANES) * nrow * ncol + i * ncol + j) * LANES + b % LANES].
+// Keeping each group's matrices together keeps them in cache while they are
+// worked on. The last group is zero padded; the padding is never read back.
+class BatchArray {
+private:
+  int count, nrow, ncol;
+  std::vector<double> vals;
+
+  std::size_t index(int b, int i, int j) const {
+    return ((static_cast<std::size_t>(b / LANES) * nrow + i) * ncol + j) *
+               LANES +
+           b % LANES;
+  }
+
+public:
+  // Matrices per group: the widest vectors (AVX-512) hold 8 doubles
+  static constexpr int LANES = 8;
+
+  BatchArray(int count, int nrows, int ncols);
+
+  int get_count() const;
+  int get_nrow() const;
+  int get_ncol() const;
+
+  // Number of groups of LANES matrices, the last one possibly padded
+  int get_groups() const;
+
+  double *data();
+  const double *data() const;
+
+  // Entry (i, j) of matrix b
+  double &operator()(int b, int i, int j) { return vals[index(b, i, j)]; }
+  double operator()(int b, int i, int j) const { return vals[index(b, i, j)]; }
+
+  // Copy matrix b in from (or out to) the usual row-major layout
+  void set(int b, const ConstArrayView &);
+  Array get(int b) const;
+};
+
+// Batched LU decompositions (with partial pivoting) of many small square
+// matrices, e.g. 3x3 to 32x32. Each SIMD lane works on a different matrix,
+// so the whole batch is factored or solved in one vectorized pass with no
+// per-matrix allocation. Large batches are split across
+// parallel::get_num_threads() threads.
+//
+// Failures don't throw: get_info()[b] is 0 if matrix b was factored, or
+// k + 1 if its k-th pivot was below tolerance (it is singular). The factors
+// and solutions of failed matrices are unspecified, but they don't raise
+// floating point exceptions. solve() and get_pivots() throw std::logic_error
+// before decompose().
+class BatchLUDecomp {
+private:
+  int n;
+  BatchArray M;
+  std::vector<int> piv;
+  std::vector<int> info;
+  bool decomposed = false;
+
+public:
+  // Takes the batch by value: pass it with std::move to factor in place
+  explicit BatchLUDecomp(BatchArray);
+  void decompose();
+
+  // Solve A_b X_b = B_b for every matrix b, where B holds an n x k
+  // right-hand side per matrix. Takes B by value: pass it with std::move to
+  // solve in place, without allocating.
+  BatchArray solve(BatchArray) const;
+
+  const BatchArray &get_factors() const;
+  const std::vector<int> &get_info() const;
+
+  // Row i of factored matrix b is row p[i] of the input (as in LUDecomp)
+  std::vector<int> get_pivots(int b) const;
+};
+
+// Batched Cholesky decompositions A = L L^T of many small symmetric positive
+// definite matrices, laid out and parallelised as BatchLUDecomp. L is written
+// to the lower triangles; get_info()[b] is k + 1 if the leading minor of
+// order k + 1 of matrix b is not positive.
+class BatchCholesky {
+private:
+  int n;
+  BatchArray M;
+  std::vector<int> info;
+  bool decomposed = false;
+
+public:
+  explicit BatchCholesky(BatchArray);
+  void decompose();
+  BatchArray solve(BatchArray) const;
+
+  const BatchArray &get_factors() const;
+  const std::vector<int> &get_info() const;
+};
+
+#endif
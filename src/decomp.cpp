@@ -1,166 +1,1005 @@
 #include "decomp.hpp"
 #include "array.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "simd_detail.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <iostream>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
-Decomp::Decomp(Array &A, int dim) : n(dim), M(dim, dim) {
-  // Check that dimensions are square
-  int nrow = M.get_nrow();
-  int ncol = M.get_ncol();
-  if (n != nrow && n != ncol) {
-    std::invalid_argument("nrows != ncols: This class only works for square "
-                          "arrays (square matrices)!");
+using namespace decomp_detail;
+
+void decomp_detail::check_square(int nrow, int ncol) {
+  if (nrow != ncol) {
+    throw std::invalid_argument("nrows != ncols: This class only works for "
+                                "square arrays (square matrices)!");
+  }
+}
+
+void decomp_detail::check_decomposed(bool decomposed) {
+  if (!decomposed) {
+    throw std::logic_error("decompose() must be called first");
+  }
+}
+
+template <typename T>
+BasicDecomp<T>::BasicDecomp(BasicArray<T> &A, int dim) : BasicDecomp(A.view()) {
+  if (n != dim) {
+    throw std::invalid_argument("Input dimensions do not match!");
+  }
+}
+
+template <typename T>
+BasicDecomp<T>::BasicDecomp(const BasicArrayView<const T> &A)
+    : n(A.get_nrow()), M(A) {
+  check_square(A.get_nrow(), A.get_ncol());
+}
+
+template <typename T>
+BasicDecomp<T>::BasicDecomp(BasicArray<T> &&A)
+    : n(A.get_nrow()), M(std::move(A)) {
+  check_square(M.get_nrow(), M.get_ncol());
+}
+
+namespace {
+
+// Block column width of the blocked factorizations
+constexpr int LU_BLOCK = 64;
+
+// Rows per task of the parallel Cholesky updates (the tiles of the trailing
+// SYRK update are CHOL_TILE x CHOL_TILE)
+constexpr int CHOL_TILE = 128;
+
+// Unblocked LU with partial pivoting of the m x nb panel at A (leading
+// dimension lda), swapping rows within the panel only. piv[k] receives the
+// panel row swapped with row k. Only the first n_check columns have their
+// pivot checked against the tolerance (the last column of the matrix is
+// never used as a divisor during the elimination).
+template <typename T>
+void lu_panel(int m, int nb, T *A, std::ptrdiff_t lda, int n_check, int *piv) {
+  for (int k = 0; k < nb; ++k) {
+    T *a_k = A + k * lda;
+
+    // Find the pivot row (having the maximal entry)
+    int pivot_row = k;
+    T max_curr = std::abs(a_k[k]);
+    for (int i = k + 1; i < m; ++i) {
+      T v = std::abs(A[i * lda + k]);
+      if (v > max_curr) {
+        max_curr = v;
+        pivot_row = i;
+      }
+    }
+
+    // Fail if the pivot is less than tolerance
+    if (k < n_check && max_curr <= PIVOT_TOL<T>) {
+      throw std::runtime_error("Not able to proceed as pivot is below tol");
+    }
+
+    piv[k] = pivot_row;
+    if (pivot_row != k) {
+      std::swap_ranges(a_k, a_k + nb, A + pivot_row * lda);
+    }
+
+    // Compute the multipliers, then eliminate within the panel
+    for (int i = k + 1; i < m; ++i) {
+      T *a_i = A + i * lda;
+      T l_mult = a_i[k] / a_k[k];
+      a_i[k] = l_mult;
+      for (int j = k + 1; j < nb; ++j) {
+        a_i[j] -= l_mult * a_k[j];
+      }
+    }
   }
+}
+
+// Unblocked Cholesky of the nb x nb diagonal block at A (leading dimension
+// lda), reading and writing its lower triangle only. off is the block's
+// offset in the whole matrix, used to report where factorization failed.
+template <typename T>
+void chol_diag(int nb, T *A, std::ptrdiff_t lda, int off) {
+  for (int i = 0; i < nb; ++i) {
+    T *a_i = A + i * lda;
+    for (int j = 0; j <= i; ++j) {
+      const T *a_j = A + j * lda;
+      T sum = a_i[j];
+      for (int k = 0; k < j; ++k) {
+        sum -= a_i[k] * a_j[k];
+      }
+
+      if (i == j) {
+        // Also catches NaN, which would otherwise spread through the factor
+        if (!(sum > 0.0)) {
+          throw std::runtime_error(
+              "Matrix is not positive definite (leading minor of order " +
+              std::to_string(off + i + 1) + " is not positive)");
+        }
+        a_i[i] = std::sqrt(sum);
+      } else {
+        a_i[j] = sum / a_j[j];
+      }
+    }
+  }
+}
+
+// In-place blocked (right-looking) LU decomposition with partial pivoting.
+//
+// For each block column of width LU_BLOCK:
+//  1. factor the panel (the block column, from the diagonal down) unblocked,
+//  2. apply the panel's row swaps to the columns left and right of it,
+//  3. solve for the U block row, U12 = L11^{-1} A12,
+//  4. update the trailing matrix, A22 -= L21 U12, with a (parallel) gemm.
+// Almost all of the work lands in step 4. The result is the same packed L\U
+// layout and pivot vector as an unblocked elimination. A is n x n row-major,
+// of double or float (for the mixed precision decomposition).
+template <typename T> void lu_blocked(int n, T *A, std::vector<int> &p) {
+  std::vector<int> piv(LU_BLOCK);
+
+  for (int k0 = 0; k0 < n; k0 += LU_BLOCK) {
+    int nb = std::min(LU_BLOCK, n - k0);
+    int n_rest = n - k0 - nb;
+
+    lu_panel(n - k0, nb, A + k0 * n + k0, n, n - 1 - k0, piv.data());
+
+    // Swap the rest of each pivoted row, and save the swaps in p
+    for (int k = 0; k < nb; ++k) {
+      int row = k0 + k;
+      int pivot_row = k0 + piv[k];
+      if (pivot_row != row) {
+        T *a_row = A + row * n, *a_pivot = A + pivot_row * n;
+        std::swap_ranges(a_row, a_row + k0, a_pivot);
+        std::swap_ranges(a_row + k0 + nb, a_row + n, a_pivot + k0 + nb);
+        std::swap(p[row], p[pivot_row]);
+      }
+    }
 
-  // If dimensions are OK, initialize the M matrix
-  std::vector<double> vals = A.get_vals();
-  M.set_vals(vals);
+    if (n_rest > 0) {
+      kernels::trsm(kernels::Uplo::lower, kernels::Diag::unit, nb, n_rest,
+                    A + k0 * n + k0, n, 1, A + k0 * n + k0 + nb, n);
+      kernels::gemm(n_rest, n_rest, nb, T(-1), A + (k0 + nb) * n + k0, n, 1,
+                    A + k0 * n + k0 + nb, n, 1, T(1),
+                    A + (k0 + nb) * n + k0 + nb, n);
+    }
+  }
 }
 
-int Decomp::get_nrows() const { return n; }
+// In-place blocked Cholesky decomposition A = L L^T. L is written to the lower
+// triangle of A; the strictly upper triangle is left as it was.
+//
+// For each block column of width LU_BLOCK:
+//  1. factor the diagonal block, L11 L11^T = A11 (unblocked),
+//  2. solve for the block below it, L21 = A21 L11^{-T} (TRSM),
+//  3. update the lower triangle of the trailing matrix, A22 -= L21 L21^T
+//     (SYRK), one CHOL_TILE x CHOL_TILE tile per task.
+// Steps 2 and 3 run on parallel::get_num_threads() threads. Throws
+// std::runtime_error if the matrix is not (numerically) positive definite.
+template <typename T> void chol_blocked(int n, T *A) {
+  // Scratch for every step, allocated once: a transposed strip of A21 per
+  // strip, and a tile per diagonal tile of A22 (one per strip). The tiles of
+  // the lower triangle of A22 are listed by row of tiles, so those of a later,
+  // smaller A22 are a prefix of the list.
+  int max_strips = std::max(n - LU_BLOCK, 0) / CHOL_TILE + 1;
+  std::vector<T> strips(static_cast<std::size_t>(max_strips) * LU_BLOCK *
+                        CHOL_TILE);
+  std::vector<T> diag(static_cast<std::size_t>(max_strips) * CHOL_TILE *
+                      CHOL_TILE);
+  std::vector<std::pair<int, int>> tiles;
+  for (int i = 0; i < max_strips; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      tiles.emplace_back(i, j);
+    }
+  }
 
-int Decomp::get_ncols() const { return n; }
+  for (int k0 = 0; k0 < n; k0 += LU_BLOCK) {
+    int nb = std::min(LU_BLOCK, n - k0);
+    int r0 = k0 + nb;
+    int n_rest = n - r0;
 
-std::vector<double> Decomp::get_vals() { return M.get_vals(); }
+    chol_diag(nb, A + k0 * n + k0, n, k0);
+    if (n_rest == 0) {
+      break;
+    }
+
+    // L21^T = L11^{-1} A21^T, solved through a transposed copy of each strip
+    // of rows of A21
+    int n_strips = (n_rest + CHOL_TILE - 1) / CHOL_TILE;
+    parallel::parallel_for(n_strips, [&](int s) {
+      int i0 = r0 + s * CHOL_TILE;
+      int mi = std::min(CHOL_TILE, n - i0);
+      T *w = strips.data() + static_cast<std::size_t>(s) * LU_BLOCK * CHOL_TILE;
+      for (int i = 0; i < mi; ++i) {
+        for (int k = 0; k < nb; ++k) {
+          w[k * mi + i] = A[(i0 + i) * n + k0 + k];
+        }
+      }
+      kernels::trsm(kernels::Uplo::lower, kernels::Diag::non_unit, nb, mi,
+                    A + k0 * n + k0, n, 1, w, mi);
+      for (int i = 0; i < mi; ++i) {
+        for (int k = 0; k < nb; ++k) {
+          A[(i0 + i) * n + k0 + k] = w[k * mi + i];
+        }
+      }
+    });
+
+    // Tiles (i, j), j <= i, of the lower triangle of A22. Off-diagonal tiles
+    // are updated in place; diagonal ones go through a scratch tile so the
+    // upper triangle is not written.
+    parallel::parallel_for(n_strips * (n_strips + 1) / 2, [&](int t) {
+      int i0 = r0 + tiles[t].first * CHOL_TILE;
+      int j0 = r0 + tiles[t].second * CHOL_TILE;
+      int mi = std::min(CHOL_TILE, n - i0);
+      int nj = std::min(CHOL_TILE, n - j0);
+      const T *l_i = A + i0 * n + k0;
+      const T *l_j = A + j0 * n + k0;
+
+      if (i0 != j0) {
+        kernels::gemm(mi, nj, nb, T(-1), l_i, n, 1, l_j, 1, n, T(1),
+                      A + i0 * n + j0, n);
+        return;
+      }
+      T *c = diag.data() +
+             static_cast<std::size_t>(tiles[t].first) * CHOL_TILE * CHOL_TILE;
+      kernels::gemm(mi, mi, nb, T(1), l_i, n, 1, l_j, 1, n, T(0), c, mi);
+      for (int i = 0; i < mi; ++i) {
+        T *a_i = A + (i0 + i) * n + j0;
+        for (int j = 0; j <= i; ++j) {
+          a_i[j] -= c[i * mi + j];
+        }
+      }
+    });
+  }
+}
+
+} // namespace
+
+template <typename T> int BasicDecomp<T>::get_nrows() const { return n; }
+
+template <typename T> int BasicDecomp<T>::get_ncols() const { return n; }
+
+template <typename T> std::vector<T> BasicDecomp<T>::get_vals() const {
+  return M.get_vals();
+}
 
 // Only need to initialize the pivot vector
-LUDecomp::LUDecomp(Array &A, int dim) : Decomp(A, dim), p(dim) {
+template <typename T>
+BasicLUDecomp<T>::BasicLUDecomp(BasicArray<T> &A, int dim)
+    : BasicDecomp<T>(A, dim), p(dim) {
   for (int i = 0; i < dim; ++i) {
     p[i] = i;
   }
 }
 
-// In-place LU decomposition with partial (column) pivoting
-void LUDecomp::decompose() {
-  double max_curr;
-  double l_mult{1};
-  double temp_dbl;
+template <typename T>
+BasicLUDecomp<T>::BasicLUDecomp(const BasicArrayView<const T> &A)
+    : BasicDecomp<T>(A), p(n) {
+  for (int i = 0; i < n; ++i) {
+    p[i] = i;
+  }
+}
+
+template <typename T>
+BasicLUDecomp<T>::BasicLUDecomp(BasicArray<T> &&A)
+    : BasicDecomp<T>(std::move(A)), p(n) {
+  for (int i = 0; i < n; ++i) {
+    p[i] = i;
+  }
+}
+
+template <typename T> void BasicLUDecomp<T>::decompose() {
+  ULINALG_PROFILE_SCOPE(profile::Op::lu_decompose, n, n,
+                        2.0 / 3.0 * n * n * n, 2.0 * sizeof(T) * n * n);
+  lu_blocked(n, M[0], p);
+}
+
+// Tiled LU, scheduled as a task graph. With nt block columns of width ts,
+// step k of the elimination is made of the tasks
+//  - PANEL(k): factor block column k from the diagonal down (lu_panel),
+//  - SWAP_TRSM(k, j), j > k: apply the panel's row swaps to block column j,
+//    then solve for the U tile (k, j),
+//  - GEMM(k, i, j), i, j > k: update tile (i, j) -= L(i, k) U(k, j).
+// Each task only waits for the tasks that produce its inputs, so the panel of
+// step k + 1 can start as soon as block column k + 1 is updated, while the
+// rest of step k's updates are still running (lookahead). Tasks are
+// prioritised by block column, which keeps that critical path moving first.
+// The row swaps left of each panel are applied once every panel is done.
+template <typename T>
+void BasicLUDecomp<T>::decompose_tiled(int tile_size, int num_threads) {
+  if (tile_size < 1) {
+    throw std::invalid_argument("Tile size must be positive");
+  }
+  ULINALG_PROFILE_SCOPE(profile::Op::lu_decompose, n, n,
+                        2.0 / 3.0 * n * n * n, 2.0 * sizeof(T) * n * n);
+  int ts = tile_size;
+  int nt = (n + ts - 1) / ts;
+  auto width = [&](int k) { return std::min(ts, n - k * ts); };
+  T *A = M[0];
 
-  // initialize pivot temps
-  int pivot_row;
-  int temp_pivot;
+  // piv[k][r] is the panel row swapped with row r of panel k
+  std::vector<std::vector<int>> piv(nt);
 
-  for (int i = 0; i < (n - 1); ++i) {
-    max_curr = 0.0;
-    pivot_row = i;
+  parallel::TaskGraph graph;
+  std::vector<int> panel(nt);
+  // last_update[i][j]: latest task to have written tile (i, j), or -1
+  std::vector<std::vector<int>> last_update(nt, std::vector<int>(nt, -1));
 
-    // Find the pivot row (having the maximal entry)
-    for (int m = i + 1; m < n; ++m) {
-      if (std::abs(M[m][i]) >= max_curr) {
-        max_curr = M[m][i];
-        pivot_row = m;
+  for (int k = 0; k < nt; ++k) {
+    int k0 = k * ts;
+    int nb = width(k);
+    piv[k].resize(nb);
+
+    panel[k] = graph.add(
+        [=, &piv]() {
+          lu_panel(n - k0, nb, A + k0 * n + k0, n, n - 1 - k0, piv[k].data());
+        },
+        2 * (nt - k) + 1);
+    for (int i = k; i < nt; ++i) {
+      if (last_update[i][k] >= 0) {
+        graph.depend(last_update[i][k], panel[k]);
       }
     }
 
-    // Fail if the pivot is less than tolerance
-    if (std::abs(max_curr) <= 1e-8) {
-      throw std::runtime_error("Not able to proceed as pivot is below tol");
-    }
+    for (int j = k + 1; j < nt; ++j) {
+      int j0 = j * ts;
+      int nj = width(j);
+
+      int trsm = graph.add(
+          [=, &piv]() {
+            for (int r = 0; r < nb; ++r) {
+              int row = k0 + r;
+              int pivot_row = k0 + piv[k][r];
+              if (pivot_row != row) {
+                std::swap_ranges(A + row * n + j0, A + row * n + j0 + nj,
+                                 A + pivot_row * n + j0);
+              }
+            }
+            kernels::trsm(kernels::Uplo::lower, kernels::Diag::unit, nb, nj,
+                          A + k0 * n + k0, n, 1, A + k0 * n + j0, n);
+          },
+          2 * (nt - j));
+      graph.depend(panel[k], trsm);
+      for (int i = k; i < nt; ++i) {
+        if (last_update[i][j] >= 0) {
+          graph.depend(last_update[i][j], trsm);
+        }
+      }
 
-    // Swap the rows
-    for (int m = 0; m < n; ++m) {
-      temp_dbl = M[i][m];
-      M[i][m] = M[pivot_row][m];
-      M[pivot_row][m] = temp_dbl;
+      for (int i = k + 1; i < nt; ++i) {
+        int i0 = i * ts;
+        int mi = width(i);
+        int update = graph.add(
+            [=]() {
+              kernels::gemm(mi, nj, nb, T(-1), A + i0 * n + k0, n, 1,
+                            A + k0 * n + j0, n, 1, T(1), A + i0 * n + j0, n);
+            },
+            2 * (nt - j));
+        graph.depend(trsm, update);
+        last_update[i][j] = update;
+      }
     }
+  }
 
-    // Save the swaps with the pivot vector
-    std::swap(p[i], p[pivot_row]);
+  graph.run(num_threads);
 
-    for (int j = i + 1; j < n; ++j) {
-      // Compute the multiplier for the current row
-      l_mult = M[j][i] / M[i][i];
-      for (int k = i; k < n; ++k) {
-        // Loop over the row, eliminating elements as we go
-        M[j][k] -= l_mult * M[i][k];
+  // Apply each panel's swaps to the columns left of it, and record them in p
+  for (int k = 0; k < nt; ++k) {
+    int k0 = k * ts;
+    for (int r = 0; r < width(k); ++r) {
+      int row = k0 + r;
+      int pivot_row = k0 + piv[k][r];
+      if (pivot_row != row) {
+        std::swap_ranges(M[row], M[row] + k0, M[pivot_row]);
+        std::swap(p[row], p[pivot_row]);
       }
-      // After writing this, then write over zeros with the multiplier
-      M[j][i] = l_mult;
     }
   }
 }
 
+template <typename T> std::vector<int> BasicLUDecomp<T>::get_pivots() const {
+  return p;
+}
+
 // Solve using the LU decomposition
-Array LUDecomp::solve(Array &b) {
+template <typename T>
+BasicArray<T> BasicLUDecomp<T>::solve(BasicArray<T> &b) const {
+  return solve(b.view());
+}
+
+template <typename T>
+BasicArray<T> BasicLUDecomp<T>::solve(const BasicArrayView<const T> &b) const {
   // Check input dimension align
-  int len_b = b.get_nrow();
-  int width_b = b.get_ncol();
-  if (len_b != n || width_b != 1) {
+  if (b.get_nrow() != n) {
     throw std::invalid_argument("Input dimensions incompatible");
   }
+  int k = b.get_ncol();
+  ULINALG_PROFILE_SCOPE(profile::Op::lu_solve, n, k, 2.0 * n * n * k,
+                        1.0 * sizeof(T) * n * n + 2.0 * sizeof(T) * n * k);
 
   // Permute the rows of b, into x
-  Array x(n, 1);
+  BasicArray<T> x(n, k);
   for (int i = 0; i < n; ++i) {
-    x[i][0] = b[p[i]][0];
+    T *x_i = x[i];
+    for (int j = 0; j < k; ++j) {
+      x_i[j] = b(p[i], j);
+    }
   }
 
-  // First forward solve
-  for (int i = 1; i < n; ++i) {
-    for (int j = 0; j < i; ++j) {
-      x[i][0] -= M[i][j] * x[j][0];
+  // Forward solve with the unit lower L, then backsolve with U, for all the
+  // columns at once
+  const T *A = M.view().data();
+  kernels::trsm(kernels::Uplo::lower, kernels::Diag::unit, n, k, A, n, 1, x[0],
+                k);
+  kernels::trsm(kernels::Uplo::upper, kernels::Diag::non_unit, n, k, A, n, 1,
+                x[0], k);
+
+  return x;
+}
+
+template <typename T>
+BasicCholesky<T>::BasicCholesky(BasicArray<T> &A, int dim)
+    : BasicDecomp<T>(A, dim) {}
+
+template <typename T>
+BasicCholesky<T>::BasicCholesky(const BasicArrayView<const T> &A)
+    : BasicDecomp<T>(A) {}
+
+template <typename T>
+BasicCholesky<T>::BasicCholesky(BasicArray<T> &&A)
+    : BasicDecomp<T>(std::move(A)) {}
+
+template <typename T> void BasicCholesky<T>::decompose() {
+  ULINALG_PROFILE_SCOPE(profile::Op::chol_decompose, n, n,
+                        1.0 / 3.0 * n * n * n, 1.0 * sizeof(T) * n * n);
+  chol_blocked(n, M[0]);
+}
+
+template <typename T>
+BasicArray<T> BasicCholesky<T>::solve(BasicArray<T> &b) const {
+  return solve(b.view());
+}
+
+template <typename T>
+BasicArray<T> BasicCholesky<T>::solve(const BasicArrayView<const T> &b) const {
+  // Check input dimension align
+  if (b.get_nrow() != n) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  int k = b.get_ncol();
+  ULINALG_PROFILE_SCOPE(profile::Op::chol_solve, n, k, 2.0 * n * n * k,
+                        1.0 * sizeof(T) * n * n + 2.0 * sizeof(T) * n * k);
+
+  // Initialize output array
+  BasicArray<T> x(b);
+
+  // First forward solve with L, then backsolve with L^T (M with its strides
+  // swapped) to finish up
+  const T *A = M.view().data();
+  kernels::trsm(kernels::Uplo::lower, kernels::Diag::non_unit, n, k, A, n, 1,
+                x[0], k);
+  kernels::trsm(kernels::Uplo::upper, kernels::Diag::non_unit, n, k, A, 1, n,
+                x[0], k);
+
+  return x;
+}
+
+namespace {
+
+using namespace simd_detail;
+
+// Rows per block of the Cholesky update: the block's entries in a range of
+// columns are transposed into a scratch tile, so that its rows fill the
+// vector lanes
+constexpr int UPDATE_ROWS = 16;
+
+// Columns per panel of the Cholesky update (a multiple of UPDATE_ROWS). The
+// rotations of a panel's columns are found going down its diagonal block,
+// then applied to all the rows below it in parallel.
+constexpr int UPDATE_PANEL = 64;
+
+// Below this many rows under a panel, they are updated on the calling thread
+constexpr int UPDATE_PARALLEL_ROWS = 512;
+
+// Row block ranges per thread, for the parallel part of the update
+constexpr int UPDATE_TASKS_PER_THREAD = 4;
+
+// The rotations of a rank-k update (sign 1) or downdate (sign -1) of an
+// n x n factor. The rotation of column j by vector p, stored at p * n + j,
+// maps an entry l of column j and the matching entry x of the vector to
+//   l' = ic * l + sc * x,  x' = c * x - s * l'
+// with c = r / L(j, j), s = x_j / L(j, j), r^2 = L(j, j)^2 + sign * x_j^2,
+// ic = 1 / c and sc = sign * s / c (a hyperbolic rotation for a downdate).
+template <typename T> struct Rotations {
+  int n, k;
+  T sign;
+  std::vector<T> c, s, ic, sc;
+};
+
+// Apply the rotations of columns [j0, j1) to a block of UPDATE_ROWS rows,
+// held transposed in t (column j at t + (j - j0) * UPDATE_ROWS), and to the
+// rows' vector entries x (vector p at x + p * UPDATE_ROWS). The vector
+// entries carry the dependency from column to column, so each chain of W
+// rows runs its own.
+template <typename V, int W, typename T>
+ULINALG_ALWAYS_INLINE void rotate_variant(const Rotations<T> &rot, int j0,
+                                          int j1, T *t, T *x) {
+  constexpr int CHAINS = UPDATE_ROWS / W;
+  for (int p = 0; p < rot.k; ++p) {
+    std::size_t q = static_cast<std::size_t>(p) * rot.n;
+    T *x_p = x + p * UPDATE_ROWS;
+    V xv[CHAINS];
+    for (int u = 0; u < CHAINS; ++u) {
+      xv[u] = load<V>(x_p + u * W);
+    }
+    for (int j = j0; j < j1; ++j) {
+      V c = splat<V>(rot.c[q + j]), s = splat<V>(rot.s[q + j]);
+      V ic = splat<V>(rot.ic[q + j]), sc = splat<V>(rot.sc[q + j]);
+      T *t_j = t + (j - j0) * UPDATE_ROWS;
+      for (int u = 0; u < CHAINS; ++u) {
+        V l = ic * load<V>(t_j + u * W) + sc * xv[u];
+        xv[u] = c * xv[u] - s * l;
+        store(t_j + u * W, l);
+      }
+    }
+    for (int u = 0; u < CHAINS; ++u) {
+      store(x_p + u * W, xv[u]);
     }
   }
+}
+
+void rotate_scalar(const Rotations<double> &rot, int j0, int j1, double *t,
+                   double *x) {
+  rotate_variant<double, 1>(rot, j0, j1, t, x);
+}
+
+#ifdef ULINALG_SIMD_X86
+__attribute__((target("sse2"))) void rotate_sse2(const Rotations<double> &rot,
+                                                 int j0, int j1, double *t,
+                                                 double *x) {
+  rotate_variant<v2d, 2>(rot, j0, j1, t, x);
+}
+
+__attribute__((target("avx2"))) void rotate_avx2(const Rotations<double> &rot,
+                                                 int j0, int j1, double *t,
+                                                 double *x) {
+  rotate_variant<v4d, 4>(rot, j0, j1, t, x);
+}
+
+__attribute__((target("avx512f"))) void
+rotate_avx512(const Rotations<double> &rot, int j0, int j1, double *t,
+              double *x) {
+  rotate_variant<v8d, 8>(rot, j0, j1, t, x);
+}
+#endif
+
+void rotate(simd::Isa isa, const Rotations<double> &rot, int j0, int j1,
+            double *t, double *x) {
+  switch (isa) {
+#ifdef ULINALG_SIMD_X86
+  case simd::Isa::avx512:
+    rotate_avx512(rot, j0, j1, t, x);
+    return;
+  case simd::Isa::avx2:
+    rotate_avx2(rot, j0, j1, t, x);
+    return;
+  case simd::Isa::sse2:
+    rotate_sse2(rot, j0, j1, t, x);
+    return;
+#endif
+  default:
+    rotate_scalar(rot, j0, j1, t, x);
+  }
+}
+
+// Float rotations take the portable variant, whose UPDATE_ROWS independent
+// chains the compiler vectorizes for the baseline instruction set
+void rotate(simd::Isa, const Rotations<float> &rot, int j0, int j1, float *t,
+            float *x) {
+  rotate_variant<float, 1>(rot, j0, j1, t, x);
+}
 
-  // Then backsolve to finish up
-  x[n - 1][0] /= M[n - 1][n - 1];
-  for (int i = n - 2; i >= 0; --i) {
-    for (int j = n - 1; j > i; --j) {
-      x[i][0] -= M[i][j] * x[j][0];
+// Apply the rotations of columns [j0, j1) to the block of rows of L starting
+// at r0 (rows past the end are zero padding), through the scratch tile t
+template <typename T>
+void rotate_rows(simd::Isa isa, const Rotations<T> &rot, T *L, int r0, int j0,
+                 int j1, T *x, std::vector<T> &t) {
+  int n = rot.n;
+  int m = std::min(UPDATE_ROWS, n - r0);
+  t.resize(static_cast<std::size_t>(j1 - j0) * UPDATE_ROWS);
+  for (int j = j0; j < j1; ++j) {
+    T *t_j = t.data() + (j - j0) * UPDATE_ROWS;
+    for (int r = 0; r < m; ++r) {
+      t_j[r] = L[(r0 + r) * n + j];
+    }
+    std::fill(t_j + m, t_j + UPDATE_ROWS, T(0));
+  }
+  rotate(isa, rot, j0, j1, t.data(), x);
+  for (int j = j0; j < j1; ++j) {
+    const T *t_j = t.data() + (j - j0) * UPDATE_ROWS;
+    for (int r = 0; r < m; ++r) {
+      L[(r0 + r) * n + j] = t_j[r];
     }
-    x[i][0] /= M[i][i];
   }
+}
 
-  return x;
+// The diagonal block of rows starting at r0, whose columns before r0 are
+// already rotated: row i takes the rotations of columns r0 to i - 1, and
+// then its diagonal gives those of column i. Throws std::runtime_error when
+// a downdate leaves a diagonal entry that is not positive.
+template <typename T> void rotate_diag(Rotations<T> &rot, T *L, int r0, T *x) {
+  int n = rot.n;
+  int m = std::min(UPDATE_ROWS, n - r0);
+  for (int r = 0; r < m; ++r) {
+    int i = r0 + r;
+    T *l_i = L + i * n;
+    for (int p = 0; p < rot.k; ++p) {
+      std::size_t q = static_cast<std::size_t>(p) * n;
+      T x_i = x[p * UPDATE_ROWS + r];
+      for (int j = r0; j < i; ++j) {
+        T l = rot.ic[q + j] * l_i[j] + rot.sc[q + j] * x_i;
+        x_i = rot.c[q + j] * x_i - rot.s[q + j] * l;
+        l_i[j] = l;
+      }
+
+      // Also catches NaN, as in chol_diag
+      T d = l_i[i];
+      T r2 = d * d + rot.sign * x_i * x_i;
+      if (!(r2 > 0.0)) {
+        throw std::runtime_error(
+            "Matrix is not positive definite (leading minor of order " +
+            std::to_string(i + 1) + " is not positive)");
+      }
+      T r_i = std::sqrt(r2);
+      rot.c[q + i] = r_i / d;
+      rot.s[q + i] = x_i / d;
+      rot.ic[q + i] = d / r_i;
+      rot.sc[q + i] = rot.sign * x_i / r_i;
+      l_i[i] = r_i;
+    }
+  }
 }
 
-Cholesky::Cholesky(Array &A, int dim) : Decomp(A, dim) {}
+// L L^T += sign * V V^T for the lower triangular n x n factor L, by k rank-1
+// changes fused into one pass over L. Row i only depends on the rotations of
+// the columns before it, so rows are processed a panel of columns at a time:
+// the panel's diagonal block finds the panel's rotations, then the rows
+// below apply them, vectorized across UPDATE_ROWS rows and in parallel.
+template <typename T>
+void chol_rank_update(T *L, int n, const BasicArrayView<const T> &V, T sign) {
+  if (V.get_nrow() != n) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  int k = V.get_ncol();
+  if (n == 0 || k == 0) {
+    return;
+  }
+  ULINALG_PROFILE_SCOPE(profile::Op::chol_update, n, k, 2.0 * n * n * k,
+                        1.0 * sizeof(T) * n * n + 1.0 * sizeof(T) * n * k);
 
-// In-place Cholesky decomposition, returning upper-triangular matrix
-void Cholesky::decompose() {
+  std::size_t nk = static_cast<std::size_t>(n) * k;
+  Rotations<T> rot{n, k, sign, std::vector<T>(nk), std::vector<T>(nk),
+                   std::vector<T>(nk), std::vector<T>(nk)};
+
+  // The vector entries of each row block, vector by vector
+  int n_blocks = (n + UPDATE_ROWS - 1) / UPDATE_ROWS;
+  std::vector<T> x(static_cast<std::size_t>(n_blocks) * k * UPDATE_ROWS, T(0));
+  auto block_x = [&](int b) {
+    return x.data() + static_cast<std::size_t>(b) * k * UPDATE_ROWS;
+  };
   for (int i = 0; i < n; ++i) {
-    for (int j = 0; j <= i; ++j) {
-      double sum = 0;
+    for (int p = 0; p < k; ++p) {
+      block_x(i / UPDATE_ROWS)[p * UPDATE_ROWS + i % UPDATE_ROWS] = V(i, p);
+    }
+  }
+
+  simd::Isa isa = simd::get_isa();
+  int n_threads = parallel::get_num_threads();
+  std::vector<T> t;
+  for (int c0 = 0; c0 < n; c0 += UPDATE_PANEL) {
+    int c1 = std::min(n, c0 + UPDATE_PANEL);
+    for (int r0 = c0; r0 < c1; r0 += UPDATE_ROWS) {
+      rotate_rows(isa, rot, L, r0, c0, r0, block_x(r0 / UPDATE_ROWS), t);
+      rotate_diag(rot, L, r0, block_x(r0 / UPDATE_ROWS));
+    }
 
-      for (int k = 0; k < j; k++) {
-        sum += M[i][k] * M[j][k];
+    // c1 is a multiple of UPDATE_ROWS unless it is n
+    int b0 = (c1 + UPDATE_ROWS - 1) / UPDATE_ROWS;
+    int n_tasks = 1;
+    if (n - c1 >= UPDATE_PARALLEL_ROWS && n_threads > 1) {
+      n_tasks = std::min(n_blocks - b0, UPDATE_TASKS_PER_THREAD * n_threads);
+    }
+    if (n_tasks <= 1) {
+      for (int b = b0; b < n_blocks; ++b) {
+        rotate_rows(isa, rot, L, b * UPDATE_ROWS, c0, c1, block_x(b), t);
+      }
+      continue;
+    }
+    parallel::parallel_for(n_tasks, [&](int task) {
+      std::vector<T> t_task;
+      int b1 = b0 + static_cast<int>(
+                        static_cast<long long>(n_blocks - b0) * task / n_tasks);
+      int b2 = b0 + static_cast<int>(static_cast<long long>(n_blocks - b0) *
+                                     (task + 1) / n_tasks);
+      for (int b = b1; b < b2; ++b) {
+        rotate_rows(isa, rot, L, b * UPDATE_ROWS, c0, c1, block_x(b), t_task);
       }
+    });
+  }
+}
 
-      if (i == j) {
-        M[i][j] = std::sqrt(M[i][i] - sum);
-      } else {
-        M[i][j] = (1.0 / M[j][j] * (M[i][j] - sum));
+} // namespace
+
+template <typename T>
+void BasicCholesky<T>::update(const BasicArrayView<const T> &V) {
+  chol_rank_update(M[0], n, V, T(1));
+}
+
+template <typename T>
+void BasicCholesky<T>::downdate(const BasicArrayView<const T> &V) {
+  chol_rank_update(M[0], n, V, T(-1));
+}
+
+namespace {
+
+// Refinement steps before a mixed precision solve gives up on its factors
+constexpr int MAX_REFINE = 30;
+
+// ||A||, the largest absolute row sum
+double inf_norm(const Array &A) {
+  ConstArrayView a = A.view();
+  double res = 0.0;
+  for (int i = 0; i < a.get_nrow(); ++i) {
+    double sum = 0.0;
+    for (int j = 0; j < a.get_ncol(); ++j) {
+      sum += std::abs(a(i, j));
+    }
+    res = std::max(res, sum);
+  }
+  return res;
+}
+
+// Whether every entry of A is within float range
+bool fits_float(const Array &A) {
+  for (double v : A.span()) {
+    if (!(std::abs(v) <= std::numeric_limits<float>::max())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// R = B - A X for n x n A, with a dot product per row for a single
+// right-hand side (which gemm would pad out to a full micro-tile)
+void residual(int n, int k, const double *A, const ConstArrayView &B,
+              Array &X, Array &R) {
+  if (k == 1) {
+    const double *x = X[0];
+    for (int i = 0; i < n; ++i) {
+      const double *a_i = A + static_cast<std::ptrdiff_t>(i) * n;
+      double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      int j = 0;
+      for (; j + 4 <= n; j += 4) {
+        s0 += a_i[j] * x[j];
+        s1 += a_i[j + 1] * x[j + 1];
+        s2 += a_i[j + 2] * x[j + 2];
+        s3 += a_i[j + 3] * x[j + 3];
+      }
+      for (; j < n; ++j) {
+        s0 += a_i[j] * x[j];
       }
+      R[i][0] = B(i, 0) - ((s0 + s1) + (s2 + s3));
+    }
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < k; ++j) {
+      R[i][j] = B(i, j);
     }
   }
+  kernels::gemm(n, k, n, -1.0, A, n, 1, X[0], k, 1, 1.0, R[0], k);
 }
 
-Array Cholesky::solve(Array &b) {
-  // Initialize output array
-  std::vector<double> b_vals = b.get_vals();
-  Array x(b_vals, n, 1);
+// Solve A X = B by iterative refinement from low, the single precision
+// factors of A: each correction solves low's system for the residual, rounded
+// to float. Returns the refinement steps taken, or -1 if the residuals didn't
+// reach double precision accuracy within MAX_REFINE steps (as dsgesv and
+// dsposv, whose stopping test this is).
+template <typename Low>
+int refine(const Array &A, double a_norm, const Low &low,
+           const ConstArrayView &B, Array &X) {
+  int n = B.get_nrow();
+  int k = B.get_ncol();
+  if (n == 0 || k == 0) {
+    return 0;
+  }
+  double tol = a_norm * std::sqrt(static_cast<double>(n)) *
+               std::numeric_limits<double>::epsilon() / 2;
+  const double *a = A.view().data();
+  Array R(n, k);
+  BasicArray<float> r_low(n, k);
+  auto correction = [&](const ConstArrayView &r) {
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < k; ++j) {
+        r_low[i][j] = static_cast<float>(r(i, j));
+      }
+    }
+    return low.solve(r_low);
+  };
 
-  // First forward solve
-  x[0][0] /= M[0][0];
-  for (int i = 1; i < n; ++i) {
-    for (int j = 0; j < i; ++j) {
-      x[i][0] -= M[i][j] * x[j][0];
+  BasicArray<float> w = correction(B);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < k; ++j) {
+      X[i][j] = w[i][j];
     }
-    x[i][0] /= M[i][i];
   }
+  for (int step = 0;; ++step) {
+    // R = B - A X, in double
+    residual(n, k, a, B, X, R);
+
+    // Converged once every column is; NaN never is
+    std::vector<double> r_norm(k, 0.0), x_norm(k, 0.0);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < k; ++j) {
+        r_norm[j] = std::max(r_norm[j], std::abs(R[i][j]));
+        x_norm[j] = std::max(x_norm[j], std::abs(X[i][j]));
+      }
+    }
+    bool converged = true;
+    for (int j = 0; j < k; ++j) {
+      converged = converged && r_norm[j] <= x_norm[j] * tol;
+    }
+    if (converged) {
+      return step;
+    }
+    if (step == MAX_REFINE) {
+      return -1;
+    }
 
-  // Then backsolve (via transposed M) to finish up
-  x[n - 1][0] /= M[n - 1][n - 1];
-  for (int i = n - 2; i >= 0; --i) {
-    for (int j = n - 1; j > i; --j) {
-      x[i][0] -= M[j][i] * x[j][0];
+    w = correction(R.view());
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < k; ++j) {
+        X[i][j] += w[i][j];
+      }
     }
-    x[i][0] /= M[i][i];
-    std::cout << x[i][0] << std::endl;
   }
+}
 
-  return x;
+// Factor A in single precision into low, keeping the factors only if
+// refinement from them converges for a probe system (A x = 1): otherwise, as
+// when a float pivot fails, the caller factors in double instead
+template <typename Low>
+std::unique_ptr<Low> factor_low(const Array &A, double a_norm) {
+  if (!fits_float(A)) {
+    return nullptr;
+  }
+  auto low = std::make_unique<Low>(BasicArray<float>(A));
+  try {
+    low->decompose();
+  } catch (const std::runtime_error &) {
+    // A pivot lost to rounding in float: decide in double
+    return nullptr;
+  }
+  int n = A.get_nrow();
+  Array probe(n, 1), x(n, 1);
+  probe.set_ones();
+  if (refine(A, a_norm, *low, probe.view(), x) < 0) {
+    return nullptr;
+  }
+  return low;
 }
+
+// The refined solution of A X = B from the single precision factors low, or
+// (if refinement doesn't converge for this B) from double factors of A made
+// for the call. steps receives the refinement steps taken (0 for double).
+template <typename Low, typename High>
+Array solve_mixed(const Array &A, double a_norm, const Low &low,
+                  const ConstArrayView &B, std::atomic<int> &steps) {
+  Array x(B.get_nrow(), B.get_ncol());
+  int taken = refine(A, a_norm, low, B, x);
+  steps.store(std::max(taken, 0), std::memory_order_relaxed);
+  if (taken >= 0) {
+    return x;
+  }
+  High high(A.view());
+  high.decompose();
+  return high.solve(B);
+}
+
+} // namespace
+
+MixedLUDecomp::MixedLUDecomp(const ConstArrayView &A)
+    : n(A.get_nrow()), A(A) {
+  check_square(A.get_nrow(), A.get_ncol());
+}
+
+void MixedLUDecomp::decompose() {
+  decomposed = false;
+  fallback.reset();
+  a_norm = inf_norm(A);
+  low = factor_low<BasicLUDecomp<float>>(A, a_norm);
+  if (!low) {
+    fallback = std::make_unique<LUDecomp>(A.view());
+    fallback->decompose();
+  }
+  decomposed = true;
+}
+
+Array MixedLUDecomp::solve(Array &b) const { return solve(b.view()); }
+
+Array MixedLUDecomp::solve(const ConstArrayView &b) const {
+  check_decomposed(decomposed);
+  if (b.get_nrow() != n) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  if (fallback) {
+    iterations.store(0, std::memory_order_relaxed);
+    return fallback->solve(b);
+  }
+  return solve_mixed<BasicLUDecomp<float>, LUDecomp>(A, a_norm, *low, b,
+                                                      iterations);
+}
+
+bool MixedLUDecomp::is_mixed() const { return !fallback; }
+
+int MixedLUDecomp::get_iterations() const {
+  return iterations.load(std::memory_order_relaxed);
+}
+
+int MixedLUDecomp::get_nrows() const { return n; }
+
+int MixedLUDecomp::get_ncols() const { return n; }
+
+MixedCholesky::MixedCholesky(const ConstArrayView &A)
+    : n(A.get_nrow()), A(A) {
+  check_square(A.get_nrow(), A.get_ncol());
+}
+
+void MixedCholesky::decompose() {
+  decomposed = false;
+  fallback.reset();
+  a_norm = inf_norm(A);
+  low = factor_low<BasicCholesky<float>>(A, a_norm);
+  if (!low) {
+    fallback = std::make_unique<Cholesky>(A.view());
+    fallback->decompose();
+  }
+  decomposed = true;
+}
+
+Array MixedCholesky::solve(Array &b) const { return solve(b.view()); }
+
+Array MixedCholesky::solve(const ConstArrayView &b) const {
+  check_decomposed(decomposed);
+  if (b.get_nrow() != n) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  if (fallback) {
+    iterations.store(0, std::memory_order_relaxed);
+    return fallback->solve(b);
+  }
+  return solve_mixed<BasicCholesky<float>, Cholesky>(A, a_norm, *low, b,
+                                                     iterations);
+}
+
+bool MixedCholesky::is_mixed() const { return !fallback; }
+
+int MixedCholesky::get_iterations() const {
+  return iterations.load(std::memory_order_relaxed);
+}
+
+int MixedCholesky::get_nrows() const { return n; }
+
+int MixedCholesky::get_ncols() const { return n; }
+
+template class BasicDecomp<double>;
+template class BasicDecomp<float>;
+template class BasicLUDecomp<double>;
+template class BasicLUDecomp<float>;
+template class BasicCholesky<double>;
+template class BasicCholesky<float>;
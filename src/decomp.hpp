@@ -2,37 +2,186 @@
 #define DECOMP_HPP
 
 #include "array.hpp"
+#include <atomic>
+#include <memory>
 #include <vector>
 
-class Decomp {
+// Checks and tolerances shared by the factorizations (dense, banded, batched
+// and fixed-size)
+namespace decomp_detail {
+// Pivots smaller than this (in magnitude) are treated as singular: about the
+// square root of the scalar type's epsilon
+template <typename T> inline constexpr T PIVOT_TOL = T(1e-8);
+template <> inline constexpr float PIVOT_TOL<float> = 1e-4f;
+
+// Throws std::invalid_argument unless nrow == ncol
+void check_square(int nrow, int ncol);
+
+// Throws std::logic_error unless decompose() has succeeded
+void check_decomposed(bool decomposed);
+} // namespace decomp_detail
+
+// Dense factorizations of square matrices of double or float values. The
+// float instantiations (BasicLUDecomp<float>, BasicCholesky<float>) store half
+// the bytes and factor on the float kernels; they give single precision
+// accuracy, which the mixed precision classes below refine to double.
+template <typename T> class BasicDecomp {
 protected:
   int n;
-  Array M;
+  BasicArray<T> M;
 
 public:
-  Decomp(Array &, int);
+  BasicDecomp(BasicArray<T> &, int);
+  // Factor a (square) view, e.g. a block of a larger matrix; its values are
+  // copied once into the factorization's own storage
+  BasicDecomp(const BasicArrayView<const T> &);
+  // Take over the storage of a (square) Array, without copying it
+  explicit BasicDecomp(BasicArray<T> &&);
 
   int get_nrows() const;
   int get_ncols() const;
-  std::vector<double> get_vals();
+  std::vector<T> get_vals() const;
 };
 
-class LUDecomp : public Decomp {
+template <typename T> class BasicLUDecomp : public BasicDecomp<T> {
 private:
+  using BasicDecomp<T>::n;
+  using BasicDecomp<T>::M;
   std::vector<int> p;
 
 public:
   // All operations are in-place
-  LUDecomp(Array &, int);
+  BasicLUDecomp(BasicArray<T> &, int);
+  BasicLUDecomp(const BasicArrayView<const T> &);
+  explicit BasicLUDecomp(BasicArray<T> &&);
   void decompose();
-  Array solve(Array &);
+
+  // Tiled, task-parallel variant of decompose() giving the same factors: the
+  // matrix is split into tile_size x tile_size tiles, and the panel, row swap
+  // + triangular solve, and trailing update tasks run on num_threads threads
+  // (parallel::get_num_threads() if < 1) as their dependencies are met
+  void decompose_tiled(int tile_size = 128, int num_threads = 0);
+
+  // Solve A X = B for an n x k B (k right-hand sides at once)
+  BasicArray<T> solve(BasicArray<T> &) const;
+  BasicArray<T> solve(const BasicArrayView<const T> &) const;
+
+  // Row i of the (row-permuted) factored matrix is row p[i] of the input
+  std::vector<int> get_pivots() const;
 };
 
-class Cholesky : public Decomp {
+template <typename T> class BasicCholesky : public BasicDecomp<T> {
+private:
+  using BasicDecomp<T>::n;
+  using BasicDecomp<T>::M;
+
 public:
-  Cholesky(Array &, int);
+  BasicCholesky(BasicArray<T> &, int);
+  BasicCholesky(const BasicArrayView<const T> &);
+  explicit BasicCholesky(BasicArray<T> &&);
+
+  // Blocked, multithreaded factorization A = L L^T, with L in the lower
+  // triangle. Throws std::runtime_error if A is not positive definite.
   void decompose();
-  Array solve(Array &);
+
+  // Modify the factor of A, after decompose(), into that of A + V V^T
+  // (update) or A - V V^T (downdate) for an n x k V, in O(n^2 k) time rather
+  // than the O(n^3) of factoring again; a single column v is a rank-1 change.
+  // Throws std::invalid_argument if V doesn't have n rows.
+  void update(const BasicArrayView<const T> &);
+
+  // Throws std::runtime_error if A - V V^T is not positive definite, after
+  // which the factor is no longer valid
+  void downdate(const BasicArrayView<const T> &);
+
+  // Solve A X = B for an n x k B (k right-hand sides at once)
+  BasicArray<T> solve(BasicArray<T> &) const;
+  BasicArray<T> solve(const BasicArrayView<const T> &) const;
+};
+
+using Decomp = BasicDecomp<double>;
+using LUDecomp = BasicLUDecomp<double>;
+using Cholesky = BasicCholesky<double>;
+
+// Defined in decomp.cpp, for both scalar types
+extern template class BasicDecomp<double>;
+extern template class BasicDecomp<float>;
+extern template class BasicLUDecomp<double>;
+extern template class BasicLUDecomp<float>;
+extern template class BasicCholesky<double>;
+extern template class BasicCholesky<float>;
+
+// Mixed precision solves: A is factored in single precision, which moves half
+// the bytes and fits twice the values per vector of a double factorization,
+// and each solution is then refined in double precision, X += A^{-1} (B - A X)
+// with the residual B - A X computed in double, until every column's residual
+// is within sqrt(n) eps ||A|| ||x|| (infinity norms, eps of double), as from a
+// double precision solve. As in LAPACK's dsgesv, A is factored in double
+// instead when it doesn't fit in float, when its float factorization
+// (BasicLUDecomp<float> or BasicCholesky<float>) fails, or when refinement
+// doesn't converge for a probe system in decompose() (a condition number near
+// 1e7 or more).
+// A double copy of A is kept for the residuals.
+class MixedLUDecomp {
+private:
+  int n;
+  Array A;
+  double a_norm = 0.0;                       // ||A||, for the stopping test
+  std::unique_ptr<BasicLUDecomp<float>> low; // single precision factors
+  std::unique_ptr<LUDecomp> fallback;        // double factors, if needed
+  mutable std::atomic<int> iterations{0};
+  bool decomposed = false;
+
+public:
+  MixedLUDecomp(const ConstArrayView &);
+
+  // Throws std::runtime_error if a pivot is below tolerance (in double)
+  void decompose();
+
+  // Solve A X = B for an n x k B (k right-hand sides at once). Throws
+  // std::logic_error unless decompose() has succeeded. Safe to call
+  // concurrently; should refinement fail for a particular B, it is solved
+  // from double factors made for that call.
+  Array solve(Array &) const;
+  Array solve(const ConstArrayView &) const;
+
+  // Whether solves use the single precision factors, i.e. decompose() didn't
+  // fall back to double
+  bool is_mixed() const;
+
+  // Refinement steps taken by the last solve (0 if double factors were used)
+  int get_iterations() const;
+
+  int get_nrows() const;
+  int get_ncols() const;
+};
+
+// Cholesky counterpart of MixedLUDecomp (as LAPACK's dsposv)
+class MixedCholesky {
+private:
+  int n;
+  Array A;
+  double a_norm = 0.0;
+  std::unique_ptr<BasicCholesky<float>> low;
+  std::unique_ptr<Cholesky> fallback;
+  mutable std::atomic<int> iterations{0};
+  bool decomposed = false;
+
+public:
+  MixedCholesky(const ConstArrayView &);
+
+  // Throws std::runtime_error if A is not positive definite (in double)
+  void decompose();
+
+  // Solve A X = B for an n x k B (k right-hand sides at once)
+  Array solve(Array &) const;
+  Array solve(const ConstArrayView &) const;
+
+  bool is_mixed() const;
+  int get_iterations() const;
+
+  int get_nrows() const;
+  int get_ncols() const;
 };
 
 #endif
@@ -0,0 +1,188 @@
+#include "factor_cache.hpp"
+
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// The primes and rounds of xxHash64
+constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t P3 = 0x165667B19E3779F9ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t hash_round(std::uint64_t acc, std::uint64_t word) {
+  return rotl(acc + word * P2, 31) * P1;
+}
+
+inline std::uint64_t mix(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline std::uint64_t bits(double x) {
+  std::uint64_t w;
+  std::memcpy(&w, &x, sizeof(w));
+  return w;
+}
+
+// Four independent accumulators, with entry j of each row going to lane
+// j % 4, so that consecutive words don't wait on each other's multiplies
+// (hashing then runs at close to memory bandwidth)
+template <bool CONTIGUOUS>
+void hash_rows(const ConstArrayView &A, std::uint64_t acc[4]) {
+  int ncol = A.get_ncol();
+  std::ptrdiff_t cs = CONTIGUOUS ? 1 : A.col_stride();
+  for (int i = 0; i < A.get_nrow(); ++i) {
+    const double *a_i = A.data() + i * A.row_stride();
+    int j = 0;
+    for (; j + 4 <= ncol; j += 4) {
+      acc[0] = hash_round(acc[0], bits(a_i[j * cs]));
+      acc[1] = hash_round(acc[1], bits(a_i[(j + 1) * cs]));
+      acc[2] = hash_round(acc[2], bits(a_i[(j + 2) * cs]));
+      acc[3] = hash_round(acc[3], bits(a_i[(j + 3) * cs]));
+    }
+    for (; j < ncol; ++j) {
+      acc[j % 4] = hash_round(acc[j % 4], bits(a_i[j * cs]));
+    }
+  }
+}
+
+// 128 bits of hash of A's values, by row whatever its strides (so a view
+// hashes as its copy would)
+std::pair<std::uint64_t, std::uint64_t> hash_values(const ConstArrayView &A) {
+  std::uint64_t acc[4] = {P1 + P2, P2, 0, 0 - P1};
+  if (A.col_stride() == 1) {
+    hash_rows<true>(A, acc);
+  } else {
+    hash_rows<false>(A, acc);
+  }
+  std::uint64_t h0 = mix(rotl(acc[0], 1) + rotl(acc[1], 7) +
+                         rotl(acc[2], 12) + rotl(acc[3], 18));
+  std::uint64_t h1 = mix((acc[0] ^ rotl(acc[2], 32)) * P3 +
+                         (acc[1] ^ rotl(acc[3], 32)) * P1);
+  return {h0, h1};
+}
+
+} // namespace
+
+bool FactorCache::Key::operator==(const Key &other) const {
+  return h0 == other.h0 && h1 == other.h1 && nrow == other.nrow &&
+         ncol == other.ncol && kind == other.kind;
+}
+
+FactorCache::FactorCache(std::size_t memory_budget) : budget(memory_budget) {}
+
+std::shared_ptr<const LUDecomp> FactorCache::lu(const ConstArrayView &A) {
+  return std::static_pointer_cast<const LUDecomp>(get(Kind::lu, A));
+}
+
+std::shared_ptr<const Cholesky>
+FactorCache::cholesky(const ConstArrayView &A) {
+  return std::static_pointer_cast<const Cholesky>(get(Kind::cholesky, A));
+}
+
+FactorCache::Stats FactorCache::get_stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats res = stats;
+  res.entries = entries.size();
+  return res;
+}
+
+std::size_t FactorCache::get_memory_budget() const { return budget; }
+
+void FactorCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  lru.clear();
+  stats.bytes = 0;
+}
+
+// The key is hashed before taking the lock, and the factorization runs
+// outside it: a miss inserts a pending entry, which later requests for the
+// same key wait on.
+std::shared_ptr<const Decomp> FactorCache::get(Kind kind,
+                                               const ConstArrayView &A) {
+  decomp_detail::check_square(A.get_nrow(), A.get_ncol());
+  std::pair<std::uint64_t, std::uint64_t> h = hash_values(A);
+  Key key{h.first, h.second, A.get_nrow(), A.get_ncol(), kind};
+  std::size_t n = static_cast<std::size_t>(A.get_nrow());
+  std::size_t bytes = n * n * sizeof(double);
+  if (kind == Kind::lu) {
+    bytes += n * sizeof(int);
+  }
+
+  std::promise<std::shared_ptr<const Decomp>> promise;
+  std::uint64_t id = 0;
+  bool cached = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      ++stats.hits;
+      lru.splice(lru.begin(), lru, it->second.lru);
+      std::shared_future<std::shared_ptr<const Decomp>> factor =
+          it->second.factor;
+      lock.unlock();
+      return factor.get();
+    }
+    ++stats.misses;
+    if (bytes <= budget) {
+      id = next_id++;
+      lru.push_front(key);
+      entries.emplace(key, Entry{promise.get_future().share(), bytes, id,
+                                 lru.begin()});
+      stats.bytes += bytes;
+      cached = true;
+      evict();
+    }
+  }
+
+  try {
+    std::shared_ptr<const Decomp> factor;
+    if (kind == Kind::lu) {
+      auto LU = std::make_shared<LUDecomp>(A);
+      LU->decompose();
+      factor = std::move(LU);
+    } else {
+      auto chol = std::make_shared<Cholesky>(A);
+      chol->decompose();
+      factor = std::move(chol);
+    }
+    if (cached) {
+      promise.set_value(factor);
+    }
+    return factor;
+  } catch (...) {
+    if (cached) {
+      promise.set_exception(std::current_exception());
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = entries.find(key);
+      if (it != entries.end() && it->second.id == id) {
+        stats.bytes -= it->second.bytes;
+        lru.erase(it->second.lru);
+        entries.erase(it);
+      }
+    }
+    throw;
+  }
+}
+
+void FactorCache::evict() {
+  while (stats.bytes > budget && !lru.empty()) {
+    auto it = entries.find(lru.back());
+    stats.bytes -= it->second.bytes;
+    entries.erase(it);
+    lru.pop_back();
+    ++stats.evictions;
+  }
+}
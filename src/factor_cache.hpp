@@ -0,0 +1,87 @@
+#ifndef FACTOR_CACHE_HPP
+#define FACTOR_CACHE_HPP
+
+#include "array.hpp"
+#include "decomp.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// LU and Cholesky factorizations cached by the content of the factored
+// matrix, so that solves against a matrix seen before skip decompose().
+//
+// A matrix is identified by a 128-bit hash of its values together with its
+// shape and the kind of factorization; values are not compared, so distinct
+// matrices share a factor only on a hash collision. Factors are handed out
+// shared and read-only (solve() is const). Once the cached factors exceed the
+// memory budget, the least recently used are dropped from the cache; callers
+// still holding one keep it alive. All member functions are thread-safe, and
+// a factor being computed by one thread is waited for by the others asking
+// for it rather than computed again.
+class FactorCache {
+public:
+  struct Stats {
+    std::size_t hits = 0;      // factors found, or waited for
+    std::size_t misses = 0;    // factors computed
+    std::size_t evictions = 0; // factors dropped for the budget
+    std::size_t entries = 0;   // factors cached now
+    std::size_t bytes = 0;     // and their total size
+  };
+
+  // Factors larger than the budget (in bytes) are computed but not cached
+  explicit FactorCache(std::size_t memory_budget = std::size_t(256) << 20);
+
+  // The factorization of the square matrix A, decomposed on a miss. Throws
+  // as LUDecomp / Cholesky do; failed factorizations are not cached.
+  std::shared_ptr<const LUDecomp> lu(const ConstArrayView &A);
+  std::shared_ptr<const Cholesky> cholesky(const ConstArrayView &A);
+
+  Stats get_stats() const;
+  std::size_t get_memory_budget() const;
+
+  // Drop every cached factor (the hit, miss and eviction counts are kept)
+  void clear();
+
+private:
+  enum class Kind { lu, cholesky };
+
+  struct Key {
+    std::uint64_t h0, h1;
+    int nrow, ncol;
+    Kind kind;
+
+    bool operator==(const Key &) const;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const {
+      return static_cast<std::size_t>(key.h0);
+    }
+  };
+
+  struct Entry {
+    std::shared_future<std::shared_ptr<const Decomp>> factor;
+    std::size_t bytes;
+    std::uint64_t id; // tells a re-inserted key from the one being computed
+    std::list<Key>::iterator lru;
+  };
+
+  std::size_t budget;
+  mutable std::mutex mutex;
+  std::unordered_map<Key, Entry, KeyHash> entries;
+  std::list<Key> lru; // most recently used first
+  std::uint64_t next_id = 0;
+  Stats stats;
+
+  std::shared_ptr<const Decomp> get(Kind, const ConstArrayView &);
+
+  // Drop least recently used entries until within budget (mutex held)
+  void evict();
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef FIXED_HPP
+#define FIXED_HPP
+
+#include "array.hpp"
+#include "array_view.hpp"
+
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace fixed_detail {
+
+// Call f(std::integral_constant<int, I>{}) for I = 0, ..., N - 1. Every
+// iteration is expanded at compile time, so loops written with it are fully
+// unrolled and their indices are constants.
+template <typename F, int... I>
+inline void unroll(F &&f, std::integer_sequence<int, I...>) {
+  (f(std::integral_constant<int, I>{}), ...);
+}
+
+template <int N, typename F> inline void unroll(F &&f) {
+  unroll(std::forward<F>(f), std::make_integer_sequence<int, N>{});
+}
+
+} // namespace fixed_detail
+
+// Row-major R x C arrays with compile-time dimensions, stored in place (no
+// heap allocation). The kernels below are fully unrolled, so small fixed
+// matrices (e.g. the 2x2 to 4x4 of geometric transforms) cost no loop
+// overhead. FixedArrays convert to and from Arrays through views: a
+// FixedArray is a ConstArrayView of itself, so it can be passed to mult, the
+// decompositions or Array's constructor, and it can be built from any view of
+// matching shape.
+template <int R, int C> class FixedArray {
+  static_assert(R > 0 && C > 0, "FixedArray dimensions must be positive");
+
+private:
+  std::array<double, R * C> vals{};
+
+public:
+  // Zero-initialized, as Array
+  FixedArray() = default;
+  explicit FixedArray(const std::array<double, R * C> &values)
+      : vals(values) {}
+
+  // Copy the values seen through a view: throws if its shape isn't R x C
+  explicit FixedArray(const ConstArrayView &v) {
+    if (v.get_nrow() != R || v.get_ncol() != C) {
+      throw std::invalid_argument("Input dimensions incompatible");
+    }
+    fixed_detail::unroll<R>([&](auto i) {
+      fixed_detail::unroll<C>([&](auto j) { (*this)(i, j) = v(i, j); });
+    });
+  }
+
+  // Basic array attributes
+  static constexpr int get_nrow() { return R; }
+  static constexpr int get_ncol() { return C; }
+  const std::array<double, R * C> &get_vals() const { return vals; }
+
+  Span<double> span() { return Span<double>(vals.data(), vals.size()); }
+  Span<const double> span() const {
+    return Span<const double>(vals.data(), vals.size());
+  }
+
+  double &operator()(int i, int j) { return vals[i * C + j]; }
+  double operator()(int i, int j) const { return vals[i * C + j]; }
+  double *operator[](int r) { return vals.data() + r * C; }
+  const double *operator[](int r) const { return vals.data() + r * C; }
+
+  // Views, as Array's (they must not outlive this FixedArray)
+  ArrayView view() { return ArrayView(vals.data(), R, C, C, 1); }
+  ConstArrayView view() const {
+    return ConstArrayView(vals.data(), R, C, C, 1);
+  }
+  operator ConstArrayView() const { return view(); }
+  ArrayView t() { return view().t(); }
+  ConstArrayView t() const { return view().t(); }
+
+  // Standard setters/initializations
+  void set_zeros() { vals.fill(0.0); }
+  void set_ones() { vals.fill(1.0); }
+  void eye() {
+    static_assert(R == C, "eye() needs a square FixedArray");
+    vals.fill(0.0);
+    fixed_detail::unroll<R>([&](auto i) { (*this)(i, i) = 1.0; });
+  }
+
+  // The transpose, as a new FixedArray
+  FixedArray<C, R> transpose() const {
+    FixedArray<C, R> out;
+    fixed_detail::unroll<R>([&](auto i) {
+      fixed_detail::unroll<C>([&](auto j) { out(j, i) = (*this)(i, j); });
+    });
+    return out;
+  }
+
+  // Matrix multiplication (see also the free mult)
+  template <int K> FixedArray<R, K> mult(const FixedArray<C, K> &) const;
+};
+
+template <int R, int C>
+template <int K>
+FixedArray<R, K> FixedArray<R, C>::mult(const FixedArray<C, K> &B) const {
+  FixedArray<R, K> out;
+  fixed_detail::unroll<R>([&](auto i) {
+    fixed_detail::unroll<K>([&](auto j) {
+      double sum = 0.0;
+      fixed_detail::unroll<C>(
+          [&](auto k) { sum += (*this)(i, k) * B(k, j); });
+      out(i, j) = sum;
+    });
+  });
+  return out;
+}
+
+template <int R, int C, int K>
+FixedArray<R, K> mult(const FixedArray<R, C> &A, const FixedArray<C, K> &B) {
+  return A.mult(B);
+}
+
+namespace fixed_detail {
+template <int R, int C, typename Op>
+FixedArray<R, C> elementwise(const FixedArray<R, C> &l,
+                             const FixedArray<R, C> &r, Op op) {
+  FixedArray<R, C> out;
+  Span<double> o = out.span();
+  Span<const double> a = l.span();
+  Span<const double> b = r.span();
+  unroll<R * C>([&](auto i) { o[i] = op(a[i], b[i]); });
+  return out;
+}
+} // namespace fixed_detail
+
+// Elementwise operations on FixedArrays of the same shape. These are
+// evaluated eagerly: for arrays this small an expression tree would cost more
+// than it saves. To mix with Arrays, go through view().
+template <int R, int C>
+FixedArray<R, C> operator+(const FixedArray<R, C> &l,
+                           const FixedArray<R, C> &r) {
+  return fixed_detail::elementwise(l, r,
+                                   [](double a, double b) { return a + b; });
+}
+
+template <int R, int C>
+FixedArray<R, C> operator-(const FixedArray<R, C> &l,
+                           const FixedArray<R, C> &r) {
+  return fixed_detail::elementwise(l, r,
+                                   [](double a, double b) { return a - b; });
+}
+
+template <int R, int C>
+FixedArray<R, C> operator*(const FixedArray<R, C> &l,
+                           const FixedArray<R, C> &r) {
+  return fixed_detail::elementwise(l, r,
+                                   [](double a, double b) { return a * b; });
+}
+
+template <int R, int C>
+FixedArray<R, C> operator/(const FixedArray<R, C> &l,
+                           const FixedArray<R, C> &r) {
+  return fixed_detail::elementwise(l, r,
+                                   [](double a, double b) { return a / b; });
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef FIXED_DECOMP_HPP
+#define FIXED_DECOMP_HPP
+
+#include "decomp.hpp"
+#include "fixed.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// LU decomposition (with partial pivoting) of an N x N FixedArray, as
+// LUDecomp but with stack storage and fully unrolled kernels. The factors are
+// kept in a copy of the input.
+template <int N> class FixedLUDecomp {
+private:
+  FixedArray<N, N> M;
+  std::array<int, N> p{};
+
+public:
+  explicit FixedLUDecomp(const FixedArray<N, N> &A) : M(A) {}
+
+  // Throws std::runtime_error if a pivot is below tolerance
+  void decompose();
+
+  // Solve A X = B for an N x K B (K right-hand sides at once)
+  template <int K> FixedArray<N, K> solve(const FixedArray<N, K> &) const;
+
+  const FixedArray<N, N> &get_factors() const { return M; }
+
+  // Row i of the (row-permuted) factored matrix is row p[i] of the input
+  const std::array<int, N> &get_pivots() const { return p; }
+};
+
+template <int N> void FixedLUDecomp<N>::decompose() {
+  using fixed_detail::unroll;
+  unroll<N>([&](auto i) { p[i] = i; });
+
+  unroll<N>([&](auto k_) {
+    constexpr int k = decltype(k_)::value;
+
+    // Find the pivot row (having the maximal entry)
+    int pivot_row = k;
+    double max_curr = std::abs(M(k, k));
+    unroll<N - k - 1>([&](auto i_) {
+      constexpr int i = k + 1 + decltype(i_)::value;
+      double v = std::abs(M(i, k));
+      if (v > max_curr) {
+        max_curr = v;
+        pivot_row = i;
+      }
+    });
+
+    // Fail if the pivot is less than tolerance (the last pivot is never used
+    // as a divisor here, so as in LUDecomp it isn't checked)
+    if (k < N - 1 && max_curr <= decomp_detail::PIVOT_TOL<double>) {
+      throw std::runtime_error("Not able to proceed as pivot is below tol");
+    }
+
+    if (pivot_row != k) {
+      std::swap(p[k], p[pivot_row]);
+      unroll<N>([&](auto j) { std::swap(M(k, j), M(pivot_row, j)); });
+    }
+
+    // Compute the multipliers, then eliminate
+    unroll<N - k - 1>([&](auto i_) {
+      constexpr int i = k + 1 + decltype(i_)::value;
+      double l_mult = M(i, k) / M(k, k);
+      M(i, k) = l_mult;
+      unroll<N - k - 1>([&](auto j_) {
+        constexpr int j = k + 1 + decltype(j_)::value;
+        M(i, j) -= l_mult * M(k, j);
+      });
+    });
+  });
+}
+
+template <int N>
+template <int K>
+FixedArray<N, K> FixedLUDecomp<N>::solve(const FixedArray<N, K> &b) const {
+  using fixed_detail::unroll;
+
+  // Permute the rows of b, into x
+  FixedArray<N, K> x;
+  unroll<N>([&](auto i) {
+    unroll<K>([&](auto j) { x(i, j) = b(p[i], j); });
+  });
+
+  // Forward solve with the unit lower L
+  unroll<N>([&](auto i_) {
+    constexpr int i = decltype(i_)::value;
+    unroll<i>([&](auto m) {
+      unroll<K>([&](auto j) { x(i, j) -= M(i, m) * x(m, j); });
+    });
+  });
+
+  // Then backsolve with U
+  unroll<N>([&](auto r_) {
+    constexpr int i = N - 1 - decltype(r_)::value;
+    unroll<N - i - 1>([&](auto m_) {
+      constexpr int m = i + 1 + decltype(m_)::value;
+      unroll<K>([&](auto j) { x(i, j) -= M(i, m) * x(m, j); });
+    });
+    double inv = 1.0 / M(i, i);
+    unroll<K>([&](auto j) { x(i, j) *= inv; });
+  });
+
+  return x;
+}
+
+// Cholesky decomposition A = L L^T of an N x N symmetric positive definite
+// FixedArray, as Cholesky but with stack storage and fully unrolled kernels.
+// L is written to the lower triangle of the factors.
+template <int N> class FixedCholesky {
+private:
+  FixedArray<N, N> M;
+
+public:
+  explicit FixedCholesky(const FixedArray<N, N> &A) : M(A) {}
+
+  // Throws std::runtime_error if A is not positive definite
+  void decompose();
+
+  // Solve A X = B for an N x K B (K right-hand sides at once)
+  template <int K> FixedArray<N, K> solve(const FixedArray<N, K> &) const;
+
+  const FixedArray<N, N> &get_factors() const { return M; }
+};
+
+template <int N> void FixedCholesky<N>::decompose() {
+  using fixed_detail::unroll;
+  unroll<N>([&](auto i_) {
+    constexpr int i = decltype(i_)::value;
+    unroll<i + 1>([&](auto j_) {
+      constexpr int j = decltype(j_)::value;
+      double sum = M(i, j);
+      unroll<j>([&](auto k) { sum -= M(i, k) * M(j, k); });
+
+      if (i == j) {
+        // Also catches NaN, which would otherwise spread through the factor
+        if (!(sum > 0.0)) {
+          throw std::runtime_error(
+              "Matrix is not positive definite (leading minor of order " +
+              std::to_string(i + 1) + " is not positive)");
+        }
+        M(i, i) = std::sqrt(sum);
+      } else {
+        M(i, j) = sum / M(j, j);
+      }
+    });
+  });
+}
+
+template <int N>
+template <int K>
+FixedArray<N, K> FixedCholesky<N>::solve(const FixedArray<N, K> &b) const {
+  using fixed_detail::unroll;
+  FixedArray<N, K> x = b;
+
+  // First forward solve with L, then backsolve with L^T
+  unroll<N>([&](auto i_) {
+    constexpr int i = decltype(i_)::value;
+    unroll<i>([&](auto m) {
+      unroll<K>([&](auto j) { x(i, j) -= M(i, m) * x(m, j); });
+    });
+    double inv = 1.0 / M(i, i);
+    unroll<K>([&](auto j) { x(i, j) *= inv; });
+  });
+  unroll<N>([&](auto r_) {
+    constexpr int i = N - 1 - decltype(r_)::value;
+    unroll<N - i - 1>([&](auto m_) {
+      constexpr int m = i + 1 + decltype(m_)::value;
+      unroll<K>([&](auto j) { x(i, j) -= M(m, i) * x(m, j); });
+    });
+    double inv = 1.0 / M(i, i);
+    unroll<K>([&](auto j) { x(i, j) *= inv; });
+  });
+
+  return x;
+}
+
+#endif
@@ -0,0 +1,379 @@
+#include "io.hpp"
+
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'U', 'L', 'I', 'N', 'A', 'L', 'G', '\0'};
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr std::uint32_t DTYPE_FLOAT64 = 1;
+constexpr std::uint32_t LAYOUT_ROW_MAJOR = 0;
+constexpr std::uint64_t ALIGNMENT = 64;
+
+std::runtime_error io_error(const std::string &what, const std::string &path) {
+  return std::runtime_error(what + ": " + path);
+}
+
+// Closes a file descriptor on scope exit
+class Descriptor {
+public:
+  explicit Descriptor(int fd) : fd(fd) {}
+  ~Descriptor() {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  Descriptor(const Descriptor &) = delete;
+  Descriptor &operator=(const Descriptor &) = delete;
+
+  int get() const { return fd; }
+
+private:
+  int fd;
+};
+
+// Read the header of an open file, and check it against the file's size
+io::Header read_checked(int fd, const std::string &path,
+                        std::uint64_t &file_size) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw io_error("Cannot read Array file", path);
+  }
+  file_size = static_cast<std::uint64_t>(st.st_size);
+
+  io::Header h;
+  if (file_size < sizeof(h) || ::pread(fd, &h, sizeof(h), 0) !=
+                                   static_cast<ssize_t>(sizeof(h))) {
+    throw io_error("Truncated Array file header", path);
+  }
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw io_error("Not an Array file", path);
+  }
+  if (h.version == 0 || h.version > io::FORMAT_VERSION) {
+    throw io_error("Unsupported Array file version " +
+                       std::to_string(h.version),
+                   path);
+  }
+  if (h.byte_order != BYTE_ORDER_MARK) {
+    throw io_error("Array file has the wrong byte order", path);
+  }
+  if (h.dtype != DTYPE_FLOAT64 || h.layout != LAYOUT_ROW_MAJOR) {
+    throw io_error("Unsupported Array file dtype or layout", path);
+  }
+  if (h.nrow < 0 || h.ncol < 0 || h.nrow > INT_MAX || h.ncol > INT_MAX) {
+    throw io_error("Invalid Array file dimensions", path);
+  }
+  if (h.alignment == 0 || h.data_offset < sizeof(h) ||
+      h.data_offset % h.alignment != 0 ||
+      h.data_offset % alignof(double) != 0) {
+    throw io_error("Invalid Array file data offset", path);
+  }
+  std::uint64_t bytes = static_cast<std::uint64_t>(h.nrow) *
+                        static_cast<std::uint64_t>(h.ncol) * sizeof(double);
+  if (h.data_offset > file_size || file_size - h.data_offset < bytes) {
+    throw io_error("Truncated Array file data", path);
+  }
+  return h;
+}
+
+io::Header make_header(int nrow, int ncol) {
+  io::Header h{};
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = io::FORMAT_VERSION;
+  h.byte_order = BYTE_ORDER_MARK;
+  h.dtype = DTYPE_FLOAT64;
+  h.layout = LAYOUT_ROW_MAJOR;
+  h.nrow = nrow;
+  h.ncol = ncol;
+  h.alignment = ALIGNMENT;
+  h.data_offset = sizeof(h);
+  return h;
+}
+
+// A Array file open for tile reads (or writes), with its header
+struct TileFile {
+  Descriptor fd;
+  io::Header header;
+
+  TileFile(const std::string &path, int flags)
+      : fd(::open(path.c_str(), flags, 0644)) {
+    if (fd.get() < 0) {
+      throw io_error("Cannot open Array file", path);
+    }
+  }
+
+  // Byte offset of element (i, j)
+  off_t offset(int i, int j) const {
+    return static_cast<off_t>(header.data_offset) +
+           (static_cast<off_t>(i) * header.ncol + j) *
+               static_cast<off_t>(sizeof(double));
+  }
+
+  // The nr x nc tile at (r0, c0), to or from a buffer of rows of nc: one
+  // call per row, or one for the whole tile when it spans full rows
+  void read(int r0, int c0, int nr, int nc, double *buf) const {
+    for_rows(r0, c0, nr, nc, [&](off_t at, std::size_t i, std::size_t n) {
+      transfer_all(::pread, reinterpret_cast<char *>(buf + i), n, at);
+    });
+  }
+
+  void write(int r0, int c0, int nr, int nc, const double *buf) const {
+    for_rows(r0, c0, nr, nc, [&](off_t at, std::size_t i, std::size_t n) {
+      transfer_all(::pwrite, reinterpret_cast<const char *>(buf + i), n, at);
+    });
+  }
+
+private:
+  // Call f(file offset, buffer index, bytes) for each contiguous run
+  template <typename F>
+  void for_rows(int r0, int c0, int nr, int nc, F f) const {
+    std::size_t row_bytes = sizeof(double) * nc;
+    if (nc == header.ncol) {
+      f(offset(r0, c0), 0, row_bytes * nr);
+      return;
+    }
+    for (int r = 0; r < nr; ++r) {
+      f(offset(r0 + r, c0), static_cast<std::size_t>(r) * nc, row_bytes);
+    }
+  }
+
+  // pread/pwrite until every byte is through
+  template <typename IO, typename Ptr>
+  void transfer_all(IO io, Ptr p, std::size_t bytes, off_t at) const {
+    std::size_t done = 0;
+    while (done < bytes) {
+      ssize_t n = io(fd.get(), p + done, bytes - done,
+                     at + static_cast<off_t>(done));
+      if (n <= 0) {
+        throw std::runtime_error("Array file tile I/O failed");
+      }
+      done += static_cast<std::size_t>(n);
+    }
+  }
+};
+
+// Whether two paths name the same file
+bool same_file(const std::string &a, const std::string &b) {
+  std::error_code ec;
+  return a == b || std::filesystem::equivalent(a, b, ec);
+}
+
+} // namespace
+
+void io::save(const std::string &path, const ConstArrayView &a) {
+  Header h = make_header(a.get_nrow(), a.get_ncol());
+
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (f == nullptr) {
+    throw io_error("Cannot open Array file for writing", path);
+  }
+  bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+
+  // Contiguous views go out in one write, strided ones a row at a time
+  std::size_t ncol = static_cast<std::size_t>(a.get_ncol());
+  if (a.is_contiguous()) {
+    std::size_t n = static_cast<std::size_t>(a.get_nrow()) * ncol;
+    ok = ok && std::fwrite(a.data(), sizeof(double), n, f) == n;
+  } else {
+    std::vector<double> row(ncol);
+    for (int i = 0; ok && i < a.get_nrow(); ++i) {
+      for (std::size_t j = 0; j < ncol; ++j) {
+        row[j] = a(i, static_cast<int>(j));
+      }
+      ok = std::fwrite(row.data(), sizeof(double), ncol, f) == ncol;
+    }
+  }
+
+  if (std::fclose(f) != 0 || !ok) {
+    throw io_error("Cannot write Array file", path);
+  }
+}
+
+io::Header io::read_header(const std::string &path) {
+  Descriptor fd(::open(path.c_str(), O_RDONLY));
+  if (fd.get() < 0) {
+    throw io_error("Cannot open Array file", path);
+  }
+  std::uint64_t file_size;
+  return read_checked(fd.get(), path, file_size);
+}
+
+Array io::load(const std::string &path) {
+  MappedArray mapped(path);
+  return Array(mapped.view());
+}
+
+io::MappedArray::MappedArray(const std::string &path, Mode mode) {
+  bool shared = mode == Mode::shared;
+  Descriptor fd(::open(path.c_str(), shared ? O_RDWR : O_RDONLY));
+  if (fd.get() < 0) {
+    throw io_error("Cannot open Array file", path);
+  }
+  std::uint64_t file_size;
+  Header h = read_checked(fd.get(), path, file_size);
+
+  // Map the whole file (the header included, so the mapping is never
+  // empty); the mapping stays valid once the descriptor is closed
+  length = static_cast<std::size_t>(file_size);
+  base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                shared ? MAP_SHARED : MAP_PRIVATE, fd.get(), 0);
+  if (base == MAP_FAILED) {
+    base = nullptr;
+    throw io_error("Cannot map Array file", path);
+  }
+  data = reinterpret_cast<double *>(static_cast<char *>(base) +
+                                    h.data_offset);
+  nrow = static_cast<int>(h.nrow);
+  ncol = static_cast<int>(h.ncol);
+}
+
+io::MappedArray::~MappedArray() { unmap(); }
+
+io::MappedArray::MappedArray(MappedArray &&other) noexcept
+    : base(std::exchange(other.base, nullptr)),
+      length(std::exchange(other.length, 0)),
+      data(std::exchange(other.data, nullptr)),
+      nrow(std::exchange(other.nrow, 0)), ncol(std::exchange(other.ncol, 0)) {}
+
+io::MappedArray &io::MappedArray::operator=(MappedArray &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    base = std::exchange(other.base, nullptr);
+    length = std::exchange(other.length, 0);
+    data = std::exchange(other.data, nullptr);
+    nrow = std::exchange(other.nrow, 0);
+    ncol = std::exchange(other.ncol, 0);
+  }
+  return *this;
+}
+
+void io::MappedArray::unmap() {
+  if (base != nullptr) {
+    ::munmap(base, length);
+    base = nullptr;
+  }
+}
+
+int io::MappedArray::get_nrow() const { return nrow; }
+
+int io::MappedArray::get_ncol() const { return ncol; }
+
+ArrayView io::MappedArray::view() {
+  return ArrayView(data, nrow, ncol, ncol, 1);
+}
+
+ConstArrayView io::MappedArray::view() const {
+  return ConstArrayView(data, nrow, ncol, ncol, 1);
+}
+
+io::MappedArray::operator ConstArrayView() const { return view(); }
+
+// Out-of-core product, one output tile at a time: C(i, j) accumulates
+// A(i, p) B(p, j) over the inner tiles p, and is written once complete.
+// Every (i, j, p) step reads one tile of A and one of B; the next step's pair
+// is read on another thread while the current one is multiplied, so each
+// operand tile is double-buffered. With square tiles of side t that is
+// 5 t^2 doubles, which fixes t from the budget.
+void io::mult(const std::string &out_path, const std::string &a_path,
+              const std::string &b_path, std::size_t memory_budget) {
+  if (same_file(out_path, a_path) || same_file(out_path, b_path)) {
+    throw std::invalid_argument("Output overlaps an input of mult");
+  }
+  TileFile a(a_path, O_RDONLY), b(b_path, O_RDONLY);
+  std::uint64_t file_size;
+  a.header = read_checked(a.fd.get(), a_path, file_size);
+  b.header = read_checked(b.fd.get(), b_path, file_size);
+  int m = static_cast<int>(a.header.nrow);
+  int k = static_cast<int>(a.header.ncol);
+  int n = static_cast<int>(b.header.ncol);
+  if (k != b.header.nrow) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
+  }
+  std::size_t t_max = static_cast<std::size_t>(
+      std::sqrt(static_cast<double>(memory_budget / sizeof(double)) / 5.0));
+  if (t_max < 1) {
+    throw std::invalid_argument("Memory budget too small for mult");
+  }
+  int t = static_cast<int>(std::min<std::size_t>(t_max, INT_MAX));
+  int tm = std::max(1, std::min(t, m));
+  int tn = std::max(1, std::min(t, n));
+  int tk = std::max(1, std::min(t, k));
+
+  // The output file, sized up front so tiles can be written in any order
+  TileFile c(out_path, O_RDWR | O_CREAT | O_TRUNC);
+  c.header = make_header(m, n);
+  off_t c_size = c.offset(m, 0);
+  if (::pwrite(c.fd.get(), &c.header, sizeof(c.header), 0) !=
+          static_cast<ssize_t>(sizeof(c.header)) ||
+      ::ftruncate(c.fd.get(), c_size) != 0) {
+    throw io_error("Cannot write Array file", out_path);
+  }
+
+  // Steps in order: (i, j) output tiles, then p inner tiles within each
+  int mt = (m + tm - 1) / tm, nt = (n + tn - 1) / tn, kt = (k + tk - 1) / tk;
+  long n_steps = (k == 0) ? 0 : static_cast<long>(mt) * nt * kt;
+  struct Step {
+    int i0, j0, p0, mi, nj, kp;
+  };
+  auto step = [&](long s) {
+    int p = static_cast<int>(s % kt);
+    long ij = s / kt;
+    int i = static_cast<int>(ij / nt), j = static_cast<int>(ij % nt);
+    Step st{i * tm, j * tn, p * tk, 0, 0, 0};
+    st.mi = std::min(tm, m - st.i0);
+    st.nj = std::min(tn, n - st.j0);
+    st.kp = std::min(tk, k - st.p0);
+    return st;
+  };
+
+  std::vector<double> a_buf[2], b_buf[2];
+  for (int s = 0; s < 2; ++s) {
+    a_buf[s].resize(static_cast<std::size_t>(tm) * tk);
+    b_buf[s].resize(static_cast<std::size_t>(tk) * tn);
+  }
+  std::vector<double> c_buf(static_cast<std::size_t>(tm) * tn);
+  auto read_step = [&](long s, int slot) {
+    Step st = step(s);
+    a.read(st.i0, st.p0, st.mi, st.kp, a_buf[slot].data());
+    b.read(st.p0, st.j0, st.kp, st.nj, b_buf[slot].data());
+  };
+
+  std::future<void> ahead;
+  if (n_steps > 0) {
+    ahead = std::async(std::launch::async, read_step, 0L, 0);
+  }
+  for (long s = 0; s < n_steps; ++s) {
+    int slot = static_cast<int>(s % 2);
+    ahead.get();
+    if (s + 1 < n_steps) {
+      ahead = std::async(std::launch::async, read_step, s + 1, 1 - slot);
+    }
+
+    Step st = step(s);
+    kernels::gemm(st.mi, st.nj, st.kp, 1.0, a_buf[slot].data(), st.kp, 1,
+                  b_buf[slot].data(), st.nj, 1, st.p0 == 0 ? 0.0 : 1.0,
+                  c_buf.data(), st.nj);
+    if (st.p0 + st.kp == k) {
+      c.write(st.i0, st.j0, st.mi, st.nj, c_buf.data());
+    }
+  }
+  // With k == 0 the product is all zeros, which ftruncate has written
+}
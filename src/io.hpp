@@ -0,0 +1,91 @@
+#ifndef IO_HPP
+#define IO_HPP
+
+#include "array.hpp"
+#include "array_view.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary Array files. A file is a 64-byte header followed by the values as
+// raw row-major float64, starting at data_offset (a multiple of 64). Loading
+// through MappedArray maps the file into memory rather than reading it: a
+// matrix of any size opens in constant time, and its pages are only read in
+// (and only take up memory) as they are touched. Mapping is POSIX only.
+namespace io {
+
+// Version written by save; files of a later version are refused
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+// The file header, as laid out on disk (in native byte order, which
+// byte_order records)
+struct Header {
+  char magic[8];            // "ULINALG\0"
+  std::uint32_t version;    // FORMAT_VERSION
+  std::uint32_t byte_order; // 0x01020304 as written
+  std::uint32_t dtype;      // 1: IEEE float64
+  std::uint32_t layout;     // 0: row-major
+  std::int64_t nrow, ncol;
+  std::uint64_t alignment;   // of data_offset
+  std::uint64_t data_offset; // from the start of the file
+  char reserved[8];
+};
+static_assert(sizeof(Header) == 64, "Header must be 64 bytes");
+
+// Write a (possibly strided) view to path, replacing any existing file.
+// Throws std::runtime_error if the file cannot be written.
+void save(const std::string &path, const ConstArrayView &);
+
+// Read and check a file's header. Throws std::runtime_error if the file
+// cannot be read, or is not a valid Array file of a supported version.
+Header read_header(const std::string &path);
+
+// Read a file into a new Array (a copy: use MappedArray to avoid it)
+Array load(const std::string &path);
+
+// Matrix multiplication of Array files, out of core: out_path is written
+// with a_path @ b_path, working tile by tile in at most about memory_budget
+// bytes of buffers, and reading the next tiles while the current ones are
+// multiplied. The output must not be one of the inputs. Throws
+// std::invalid_argument if the dimensions do not match or the budget cannot
+// hold a single tile, and std::runtime_error on I/O failure.
+void mult(const std::string &out_path, const std::string &a_path,
+          const std::string &b_path,
+          std::size_t memory_budget = std::size_t(256) << 20);
+
+// An Array file mapped into memory, seen through views of the mapping. With
+// Mode::copy_on_write, writes through view() stay private to this mapping;
+// with Mode::shared they are written back to the file. Views must not
+// outlive the MappedArray.
+class MappedArray {
+public:
+  enum class Mode { copy_on_write, shared };
+
+  explicit MappedArray(const std::string &path,
+                       Mode mode = Mode::copy_on_write);
+  ~MappedArray();
+  MappedArray(const MappedArray &) = delete;
+  MappedArray &operator=(const MappedArray &) = delete;
+  MappedArray(MappedArray &&) noexcept;
+  MappedArray &operator=(MappedArray &&) noexcept;
+
+  int get_nrow() const;
+  int get_ncol() const;
+
+  ArrayView view();
+  ConstArrayView view() const;
+  operator ConstArrayView() const;
+
+private:
+  void *base = nullptr;
+  std::size_t length = 0;
+  double *data = nullptr;
+  int nrow = 0, ncol = 0;
+
+  void unmap();
+};
+
+} // namespace io
+
+#endif
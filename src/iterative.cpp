@@ -0,0 +1,341 @@
+#include "iterative.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Dot product of two n x 1 vectors, over four accumulators
+double dot(const ConstArrayView &a, const ConstArrayView &b) {
+  int n = a.get_nrow();
+  const double *pa = a.data();
+  const double *pb = b.data();
+  std::ptrdiff_t sa = a.row_stride(), sb = b.row_stride();
+  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += pa[i * sa] * pb[i * sb];
+    s1 += pa[(i + 1) * sa] * pb[(i + 1) * sb];
+    s2 += pa[(i + 2) * sa] * pb[(i + 2) * sb];
+    s3 += pa[(i + 3) * sa] * pb[(i + 3) * sb];
+  }
+  for (; i < n; ++i) {
+    s0 += pa[i * sa] * pb[i * sb];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+double norm(const ConstArrayView &a) { return std::sqrt(dot(a, a)); }
+
+// Check that b and x are vectors of A's size, returning it
+int check_system(const LinearOperator &A, const ConstArrayView &b,
+                 const Array &x) {
+  int n = A.size();
+  if (b.get_nrow() != n || b.get_ncol() != 1 || x.get_nrow() != n ||
+      x.get_ncol() != 1) {
+    throw std::invalid_argument("Input dimensions incompatible");
+  }
+  return n;
+}
+
+int iteration_limit(const IterativeOptions &opts, int n) {
+  return opts.max_iter > 0 ? opts.max_iter : std::max(n, 1);
+}
+
+// Sum of L(i, j) L(k, j) over the columns j stored in both of the (sorted)
+// ranges [qi, qi_end) and [qk, qk_end) of a factor's CSR arrays
+double sparse_dot(const int *cols, const double *vals, std::size_t qi,
+                  std::size_t qi_end, std::size_t qk, std::size_t qk_end) {
+  double s = 0;
+  while (qi < qi_end && qk < qk_end) {
+    if (cols[qi] < cols[qk]) {
+      ++qi;
+    } else if (cols[qi] > cols[qk]) {
+      ++qk;
+    } else {
+      s += vals[qi++] * vals[qk++];
+    }
+  }
+  return s;
+}
+
+// The lower triangle of a square sparse matrix
+SparseArray lower_triangle(const SparseArray &A) {
+  if (A.get_nrow() != A.get_ncol()) {
+    throw std::invalid_argument("Matrix must be square");
+  }
+  Span<const std::size_t> row_ptr = A.row_ptrs();
+  Span<const int> cols = A.col_indices();
+  Span<const double> vals = A.values();
+  std::vector<Triplet> entries;
+  for (int i = 0; i < A.get_nrow(); ++i) {
+    for (std::size_t q = row_ptr[i]; q < row_ptr[i + 1] && cols[q] <= i; ++q) {
+      entries.push_back({i, cols[q], vals[q]});
+    }
+  }
+  return SparseArray(A.get_nrow(), A.get_ncol(), entries);
+}
+
+// 1 / A(i, i) for a square dense or sparse matrix
+template <typename M> std::vector<double> inverse_diagonal(const M &A) {
+  if (A.get_nrow() != A.get_ncol()) {
+    throw std::invalid_argument("Matrix must be square");
+  }
+  std::vector<double> inv(A.get_nrow());
+  for (int i = 0; i < A.get_nrow(); ++i) {
+    if (A(i, i) == 0.0) {
+      throw std::runtime_error("Zero diagonal entry in Jacobi preconditioner");
+    }
+    inv[i] = 1.0 / A(i, i);
+  }
+  return inv;
+}
+
+} // namespace
+
+LinearOperator::LinearOperator(const Array &A)
+    : LinearOperator(A.view()) {}
+
+LinearOperator::LinearOperator(const ConstArrayView &A) : n(A.get_nrow()) {
+  if (A.get_ncol() != n) {
+    throw std::invalid_argument("Operator must be square");
+  }
+  f = [A](const ConstArrayView &x, Array &y) { mult(y, A, x); };
+}
+
+LinearOperator::LinearOperator(const SparseArray &A) : n(A.get_nrow()) {
+  if (A.get_ncol() != n) {
+    throw std::invalid_argument("Operator must be square");
+  }
+  const SparseArray *S = &A;
+  f = [S](const ConstArrayView &x, Array &y) { mult(y, *S, x); };
+}
+
+LinearOperator::LinearOperator(int n, Apply f) : n(n), f(std::move(f)) {}
+
+int LinearOperator::size() const { return n; }
+
+void LinearOperator::apply(const ConstArrayView &x, Array &y) const {
+  f(x, y);
+}
+
+JacobiPreconditioner::JacobiPreconditioner(const SparseArray &A)
+    : inv_diag(inverse_diagonal(A)) {}
+
+JacobiPreconditioner::JacobiPreconditioner(const ConstArrayView &A)
+    : inv_diag(inverse_diagonal(A)) {}
+
+void JacobiPreconditioner::apply(const ConstArrayView &r, Array &z) const {
+  Span<double> out = z.span();
+  for (std::size_t i = 0; i < inv_diag.size(); ++i) {
+    out[i] = inv_diag[i] * r(static_cast<int>(i), 0);
+  }
+}
+
+// Row by row (left-looking): L(i, k) for the stored k < i subtracts the
+// overlap of rows i and k so far, and divides by L(k, k); L(i, i) is the
+// square root of what remains of A(i, i). The diagonal is each row's last
+// entry, as the columns are sorted.
+IncompleteCholesky::IncompleteCholesky(const SparseArray &A)
+    : L(lower_triangle(A)) {
+  int n = L.get_nrow();
+  Span<const std::size_t> row_ptr = L.row_ptrs();
+  const int *cols = L.col_indices().data();
+  double *vals = L.values().data();
+
+  for (int i = 0; i < n; ++i) {
+    std::size_t start = row_ptr[i], end = row_ptr[i + 1];
+    if (start == end || cols[end - 1] != i) {
+      throw std::runtime_error("Missing diagonal entry in row " +
+                               std::to_string(i));
+    }
+    for (std::size_t q = start; q < end; ++q) {
+      int k = cols[q];
+      double s = vals[q] - sparse_dot(cols, vals, start, q, row_ptr[k],
+                                      row_ptr[k + 1] - 1);
+      if (k < i) {
+        vals[q] = s / vals[row_ptr[k + 1] - 1];
+      } else if (!(s > 0.0)) {
+        throw std::runtime_error(
+            "Incomplete Cholesky pivot is not positive (row " +
+            std::to_string(i) + ")");
+      } else {
+        vals[q] = std::sqrt(s);
+      }
+    }
+  }
+}
+
+void IncompleteCholesky::apply(const ConstArrayView &r, Array &z) const {
+  int n = L.get_nrow();
+  Span<const std::size_t> row_ptr = L.row_ptrs();
+  Span<const int> cols = L.col_indices();
+  Span<const double> vals = L.values();
+  Span<double> out = z.span();
+
+  // Forward solve with L, then back solve with L^T (read by rows of L)
+  for (int i = 0; i < n; ++i) {
+    double s = r(i, 0);
+    std::size_t diag = row_ptr[i + 1] - 1;
+    for (std::size_t q = row_ptr[i]; q < diag; ++q) {
+      s -= vals[q] * out[cols[q]];
+    }
+    out[i] = s / vals[diag];
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    std::size_t diag = row_ptr[i + 1] - 1;
+    out[i] /= vals[diag];
+    for (std::size_t q = row_ptr[i]; q < diag; ++q) {
+      out[cols[q]] -= vals[q] * out[i];
+    }
+  }
+}
+
+const SparseArray &IncompleteCholesky::get_factor() const { return L; }
+
+IterativeResult cg(const LinearOperator &A, const ConstArrayView &b, Array &x,
+                   const IterativeOptions &opts, const Preconditioner *M) {
+  int n = check_system(A, b, x);
+  int max_iter = iteration_limit(opts, n);
+  double b_norm = norm(b);
+  if (b_norm == 0.0) {
+    x.set_zeros();
+    return {true, 0, 0.0};
+  }
+  double target = opts.tol * b_norm;
+
+  // Without a preconditioner z is r itself
+  Array r(n, 1), p(n, 1), Ap(n, 1), z_buf(M != nullptr ? n : 0, 1);
+  Array &z = (M != nullptr) ? z_buf : r;
+
+  A.apply(x, Ap);
+  r = b - Ap;
+  double r_norm = norm(r);
+  if (M != nullptr) {
+    M->apply(r, z);
+  }
+  p = z;
+  double rz = dot(r, z);
+
+  int k = 0;
+  while (r_norm > target && k < max_iter) {
+    A.apply(p, Ap);
+    double alpha = rz / dot(p, Ap);
+    x += alpha * p;
+    r -= alpha * Ap;
+    r_norm = norm(r);
+    ++k;
+    if (r_norm <= target) {
+      break;
+    }
+    if (M != nullptr) {
+      M->apply(r, z);
+    }
+    double rz_next = dot(r, z);
+    p = z + (rz_next / rz) * p;
+    rz = rz_next;
+  }
+  return {r_norm <= target, k, r_norm / b_norm};
+}
+
+// Each cycle builds an orthonormal basis V of the Krylov space of A M^{-1}
+// (Arnoldi, with modified Gram-Schmidt), keeping the Hessenberg matrix H in
+// upper triangular form with Givens rotations so that the residual norm is
+// known after every step without forming x. At the end of a cycle
+// x += M^{-1} V y for the least squares y, and the residual is recomputed.
+IterativeResult gmres(const LinearOperator &A, const ConstArrayView &b,
+                      Array &x, const IterativeOptions &opts,
+                      const Preconditioner *M) {
+  int n = check_system(A, b, x);
+  int max_iter = iteration_limit(opts, n);
+  int m = std::max(1, std::min(opts.restart, max_iter));
+  double b_norm = norm(b);
+  if (b_norm == 0.0) {
+    x.set_zeros();
+    return {true, 0, 0.0};
+  }
+  double target = opts.tol * b_norm;
+
+  std::vector<Array> V(m + 1, Array(n, 1));
+  Array w(n, 1), z(M != nullptr ? n : 0, 1);
+  std::vector<double> H((m + 1) * m), cs(m), sn(m), g(m + 1), y(m);
+  auto h = [&](int i, int j) -> double & { return H[i * m + j]; };
+
+  int k = 0;
+  double r_norm;
+  for (;;) {
+    A.apply(x, w);
+    V[0] = b - w;
+    r_norm = norm(V[0]);
+    if (r_norm <= target || k >= max_iter) {
+      break;
+    }
+    V[0] *= 1.0 / r_norm;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = r_norm;
+
+    int j = 0;
+    while (j < m && k < max_iter) {
+      if (M != nullptr) {
+        M->apply(V[j], z);
+        A.apply(z, w);
+      } else {
+        A.apply(V[j], w);
+      }
+      for (int i = 0; i <= j; ++i) {
+        h(i, j) = dot(w, V[i]);
+        w -= h(i, j) * V[i];
+      }
+      h(j + 1, j) = norm(w);
+      bool breakdown = h(j + 1, j) == 0.0;
+      if (!breakdown) {
+        V[j + 1] = w * (1.0 / h(j + 1, j));
+      }
+
+      // Rotate the new column by the previous rotations, then zero its
+      // subdiagonal entry with a new one
+      for (int i = 0; i < j; ++i) {
+        double t = cs[i] * h(i, j) + sn[i] * h(i + 1, j);
+        h(i + 1, j) = -sn[i] * h(i, j) + cs[i] * h(i + 1, j);
+        h(i, j) = t;
+      }
+      double d = std::hypot(h(j, j), h(j + 1, j));
+      cs[j] = d > 0.0 ? h(j, j) / d : 1.0;
+      sn[j] = d > 0.0 ? h(j + 1, j) / d : 0.0;
+      h(j, j) = d;
+      h(j + 1, j) = 0.0;
+      g[j + 1] = -sn[j] * g[j];
+      g[j] = cs[j] * g[j];
+
+      ++j;
+      ++k;
+      if (std::abs(g[j]) <= target || breakdown) {
+        break;
+      }
+    }
+
+    // Back substitute for y, then x += M^{-1} V y (w holds V y)
+    for (int i = j - 1; i >= 0; --i) {
+      double s = g[i];
+      for (int l = i + 1; l < j; ++l) {
+        s -= h(i, l) * y[l];
+      }
+      y[i] = h(i, i) != 0.0 ? s / h(i, i) : 0.0;
+    }
+    w.set_zeros();
+    for (int i = 0; i < j; ++i) {
+      w += y[i] * V[i];
+    }
+    if (M != nullptr) {
+      M->apply(w, z);
+      x += z;
+    } else {
+      x += w;
+    }
+  }
+  return {r_norm <= target, k, r_norm / b_norm};
+}
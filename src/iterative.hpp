@@ -0,0 +1,103 @@
+#ifndef ITERATIVE_HPP
+#define ITERATIVE_HPP
+
+#include "array.hpp"
+#include "sparse.hpp"
+
+#include <functional>
+#include <vector>
+
+// Iterative solvers for A x = b, for systems too large to factor densely.
+// Vectors are n x 1 Arrays (or views). Each iteration costs one apply of A
+// (and of the preconditioner) plus a few passes over the vectors, which are
+// updated in place: nothing is allocated after setup.
+
+// The matrix of a system, as something that computes y = A x. Dense and
+// sparse matrices convert implicitly, and are referenced rather than copied,
+// so they must outlive the operator; any other operator (e.g. matrix-free)
+// can be given as a callback.
+class LinearOperator {
+public:
+  // Compute y = A x, for x and y of size() x 1 (y does not alias x)
+  using Apply = std::function<void(const ConstArrayView &x, Array &y)>;
+
+  LinearOperator(const Array &);
+  LinearOperator(const ConstArrayView &);
+  LinearOperator(const SparseArray &);
+  LinearOperator(int n, Apply);
+
+  int size() const;
+  void apply(const ConstArrayView &x, Array &y) const;
+
+private:
+  int n;
+  Apply f;
+};
+
+// A preconditioner M, applied as z = M^{-1} r for r and z of size n x 1 (z
+// does not alias r). Subclass this for a custom preconditioner.
+class Preconditioner {
+public:
+  virtual ~Preconditioner() = default;
+  virtual void apply(const ConstArrayView &r, Array &z) const = 0;
+};
+
+// Diagonal (Jacobi) preconditioner. Throws std::runtime_error if a diagonal
+// entry is zero.
+class JacobiPreconditioner : public Preconditioner {
+public:
+  explicit JacobiPreconditioner(const SparseArray &);
+  explicit JacobiPreconditioner(const ConstArrayView &);
+  void apply(const ConstArrayView &r, Array &z) const override;
+
+private:
+  std::vector<double> inv_diag;
+};
+
+// Zero fill-in incomplete Cholesky, IC(0): L L^T ~ A with L restricted to
+// the pattern of A's lower triangle, for symmetric positive definite A (only
+// the lower triangle is read). Throws std::runtime_error if a pivot is not
+// positive or a diagonal entry is missing.
+class IncompleteCholesky : public Preconditioner {
+public:
+  explicit IncompleteCholesky(const SparseArray &);
+  void apply(const ConstArrayView &r, Array &z) const override;
+
+  // The factor L (lower triangular)
+  const SparseArray &get_factor() const;
+
+private:
+  SparseArray L;
+};
+
+struct IterativeOptions {
+  // Stop once ||b - A x|| <= tol * ||b||
+  double tol = 1e-8;
+  // Iteration limit (< 1: the size of the system)
+  int max_iter = 0;
+  // Krylov vectors kept by GMRES before it restarts
+  int restart = 30;
+};
+
+// How a solve ended. Running out of iterations is reported here rather than
+// thrown, and x holds the last iterate.
+struct IterativeResult {
+  bool converged;
+  int iterations;
+  double residual; // ||b - A x|| / ||b||
+};
+
+// Preconditioned conjugate gradients, for symmetric positive definite A (and
+// M). x holds the initial guess (e.g. zeros) and is overwritten with the
+// solution. Throws std::invalid_argument if the dimensions don't match.
+IterativeResult cg(const LinearOperator &A, const ConstArrayView &b, Array &x,
+                   const IterativeOptions & = {},
+                   const Preconditioner *M = nullptr);
+
+// Restarted GMRES(restart), right preconditioned, for general A. Arguments as
+// for cg; the residual tested is that of the unpreconditioned system.
+IterativeResult gmres(const LinearOperator &A, const ConstArrayView &b,
+                      Array &x, const IterativeOptions & = {},
+                      const Preconditioner *M = nullptr);
+
+#endif
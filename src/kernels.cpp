@@ -0,0 +1,354 @@
+#include "kernels.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+// Register block: the micro-kernel keeps an MR x NR tile of C in registers for
+// the whole of its k loop. A float tile takes half the registers of a double
+// one (widening it to fill them spills instead).
+constexpr int MR = 4;
+constexpr int NR = 8;
+
+// Cache blocks: a KC x NR sliver of packed B stays in L1, an MC x KC block of
+// packed A stays in L2, and a KC x NC panel of packed B stays in L3
+constexpr int KC = 256;
+constexpr int MC = 128;
+constexpr int NC = 2048;
+
+// Below this many multiply-adds the packing costs more than it saves
+constexpr long SMALL_GEMM = 32 * 32 * 32;
+
+// Below this many multiply-adds a product stays on the calling thread
+constexpr long PARALLEL_GEMM = 128 * 128 * 128;
+
+// Diagonal block size of the blocked triangular solve
+constexpr int TRSM_BLOCK = 64;
+
+// Narrowest column block of B handed to a thread by the triangular solve
+constexpr int TRSM_MIN_COLS = 64;
+
+// Output tiles handed to each thread start at TILE_M x TILE_N and are shrunk
+// until every thread has a couple of tiles to balance the load with
+constexpr int TILE_M = MC;
+constexpr int TILE_N = 512;
+constexpr int TILES_PER_THREAD = 2;
+
+int round_up(int x, int r) { return (x + r - 1) / r * r; }
+
+// The kernels are templates over the scalar type (double or float)
+
+// Scale C by beta (without reading C if beta is zero)
+template <typename T>
+void scale_c(int m, int n, T beta, T *C, std::ptrdiff_t ldc) {
+  for (int i = 0; i < m; ++i) {
+    T *c = C + i * ldc;
+    for (int j = 0; j < n; ++j) {
+      c[j] = (beta == 0) ? T(0) : beta * c[j];
+    }
+  }
+}
+
+// Pack an mc x kc block of A into MR-row micro-panels: within a panel the MR
+// entries of each column are contiguous. Rows past mc are zero padded so the
+// micro-kernel never needs to special-case the edges.
+template <typename T>
+void pack_a(int mc, int kc, const T *A, std::ptrdiff_t rsa, std::ptrdiff_t csa,
+            T *Ap) {
+  for (int i = 0; i < mc; i += MR) {
+    int mr = std::min(MR, mc - i);
+    const T *a_panel = A + i * rsa;
+    for (int p = 0; p < kc; ++p) {
+      const T *a = a_panel + p * csa;
+      for (int ii = 0; ii < mr; ++ii) {
+        Ap[ii] = a[ii * rsa];
+      }
+      for (int ii = mr; ii < MR; ++ii) {
+        Ap[ii] = 0;
+      }
+      Ap += MR;
+    }
+  }
+}
+
+// Pack a kc x nc panel of B into NR-column micro-panels: within a panel the NR
+// entries of each row are contiguous. Columns past nc are zero padded.
+template <typename T>
+void pack_b(int kc, int nc, const T *B, std::ptrdiff_t rsb, std::ptrdiff_t csb,
+            T *Bp) {
+  for (int j = 0; j < nc; j += NR) {
+    int nr = std::min(NR, nc - j);
+    const T *b_panel = B + j * csb;
+    for (int p = 0; p < kc; ++p) {
+      const T *b = b_panel + p * rsb;
+      for (int jj = 0; jj < nr; ++jj) {
+        Bp[jj] = b[jj * csb];
+      }
+      for (int jj = nr; jj < NR; ++jj) {
+        Bp[jj] = 0;
+      }
+      Bp += NR;
+    }
+  }
+}
+
+// Compute an MR x NR tile of A @ B from packed panels, then write the top-left
+// mr x nr corner of it back into C
+template <typename T>
+void micro_kernel(int kc, const T *Ap, const T *Bp, T alpha, T beta, T *C,
+                  std::ptrdiff_t ldc, int mr, int nr) {
+  T ab[MR][NR] = {};
+
+  for (int p = 0; p < kc; ++p) {
+    for (int i = 0; i < MR; ++i) {
+      T a = Ap[i];
+      for (int j = 0; j < NR; ++j) {
+        ab[i][j] += a * Bp[j];
+      }
+    }
+    Ap += MR;
+    Bp += NR;
+  }
+
+  for (int i = 0; i < mr; ++i) {
+    T *c = C + i * ldc;
+    if (beta == 0) {
+      for (int j = 0; j < nr; ++j) {
+        c[j] = alpha * ab[i][j];
+      }
+    } else {
+      for (int j = 0; j < nr; ++j) {
+        c[j] = beta * c[j] + alpha * ab[i][j];
+      }
+    }
+  }
+}
+
+// Unpacked i-k-j loop for products too small to amortize packing
+template <typename T>
+void gemm_small(int m, int n, int k, T alpha, const T *A, std::ptrdiff_t rsa,
+                std::ptrdiff_t csa, const T *B, std::ptrdiff_t rsb,
+                std::ptrdiff_t csb, T beta, T *C, std::ptrdiff_t ldc) {
+  scale_c(m, n, beta, C, ldc);
+  for (int i = 0; i < m; ++i) {
+    T *c = C + i * ldc;
+    for (int p = 0; p < k; ++p) {
+      T a = alpha * A[i * rsa + p * csa];
+      const T *b = B + p * rsb;
+      for (int j = 0; j < n; ++j) {
+        c[j] += a * b[j * csb];
+      }
+    }
+  }
+}
+
+// Single-threaded packed GEMM (k > 0)
+template <typename T>
+void gemm_serial(int m, int n, int k, T alpha, const T *A, std::ptrdiff_t rsa,
+                 std::ptrdiff_t csa, const T *B, std::ptrdiff_t rsb,
+                 std::ptrdiff_t csb, T beta, T *C, std::ptrdiff_t ldc) {
+  // Packing buffers, sized to the largest block actually used and kept per
+  // thread so repeated calls don't reallocate
+  thread_local std::vector<T> Ap;
+  thread_local std::vector<T> Bp;
+  int kc_max = std::min(KC, k);
+  int mc_max = std::min(MC, round_up(m, MR));
+  int nc_max = std::min(NC, round_up(n, NR));
+  Ap.resize(std::max(Ap.size(), static_cast<size_t>(mc_max) * kc_max));
+  Bp.resize(std::max(Bp.size(), static_cast<size_t>(nc_max) * kc_max));
+
+  for (int jc = 0; jc < n; jc += NC) {
+    int nc = std::min(NC, n - jc);
+
+    for (int pc = 0; pc < k; pc += KC) {
+      int kc = std::min(KC, k - pc);
+
+      // beta only applies to the first rank-kc update; later ones accumulate
+      T beta_p = (pc == 0) ? beta : T(1);
+      pack_b(kc, nc, B + pc * rsb + jc * csb, rsb, csb, Bp.data());
+
+      for (int ic = 0; ic < m; ic += MC) {
+        int mc = std::min(MC, m - ic);
+        pack_a(mc, kc, A + ic * rsa + pc * csa, rsa, csa, Ap.data());
+
+        for (int jr = 0; jr < nc; jr += NR) {
+          for (int ir = 0; ir < mc; ir += MR) {
+            micro_kernel(kc, Ap.data() + ir * kc, Bp.data() + jr * kc, alpha,
+                         beta_p, C + (ic + ir) * ldc + jc + jr, ldc,
+                         std::min(MR, mc - ir), std::min(NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void gemm_impl(int m, int n, int k, T alpha, const T *A, std::ptrdiff_t rsa,
+               std::ptrdiff_t csa, const T *B, std::ptrdiff_t rsb,
+               std::ptrdiff_t csb, T beta, T *C, std::ptrdiff_t ldc) {
+  if (m <= 0 || n <= 0) {
+    return;
+  }
+  if (k <= 0 || alpha == 0) {
+    scale_c(m, n, beta, C, ldc);
+    return;
+  }
+
+  long work = static_cast<long>(m) * n * k;
+  if (work <= SMALL_GEMM) {
+    gemm_small(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+    return;
+  }
+
+  int n_threads = parallel::get_num_threads();
+  if (work <= PARALLEL_GEMM || n_threads == 1 || parallel::in_parallel()) {
+    gemm_serial(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+    return;
+  }
+
+  // Split C into independent output tiles (row blocks x column blocks of C)
+  int tile_m = TILE_M;
+  int tile_n = TILE_N;
+  auto n_tiles = [&]() {
+    return ((m + tile_m - 1) / tile_m) * ((n + tile_n - 1) / tile_n);
+  };
+  while (n_tiles() < TILES_PER_THREAD * n_threads && tile_n > 8 * NR) {
+    tile_n /= 2;
+  }
+  while (n_tiles() < TILES_PER_THREAD * n_threads && tile_m > 8 * MR) {
+    tile_m /= 2;
+  }
+  int tiles_m = (m + tile_m - 1) / tile_m;
+  int tiles_n = (n + tile_n - 1) / tile_n;
+
+  parallel::parallel_for(tiles_m * tiles_n, [&](int t) {
+    int i0 = (t / tiles_n) * tile_m;
+    int j0 = (t % tiles_n) * tile_n;
+    int tm = std::min(tile_m, m - i0);
+    int tn = std::min(tile_n, n - j0);
+    gemm_serial(tm, tn, k, alpha, A + i0 * rsa, rsa, csa, B + j0 * csb, rsb,
+                csb, beta, C + i0 * ldc + j0, ldc);
+  });
+}
+
+// Unblocked triangular solve: row i of X is row i of B minus the combination
+// of the already solved rows, so every update streams contiguous rows of B
+template <typename S>
+void trsm_unblocked(kernels::Uplo uplo, kernels::Diag diag, int m, int n,
+                    const S *T, std::ptrdiff_t rst, std::ptrdiff_t cst, S *B,
+                    std::ptrdiff_t ldb) {
+  bool lower = (uplo == kernels::Uplo::lower);
+  for (int step = 0; step < m; ++step) {
+    int i = lower ? step : m - 1 - step;
+    S *bi = B + i * ldb;
+
+    int k_begin = lower ? 0 : i + 1;
+    int k_end = lower ? i : m;
+    for (int k = k_begin; k < k_end; ++k) {
+      S t = T[i * rst + k * cst];
+      const S *bk = B + k * ldb;
+      for (int j = 0; j < n; ++j) {
+        bi[j] -= t * bk[j];
+      }
+    }
+
+    if (diag == kernels::Diag::non_unit) {
+      S inv = 1 / T[i * rst + i * cst];
+      for (int j = 0; j < n; ++j) {
+        bi[j] *= inv;
+      }
+    }
+  }
+}
+
+// Blocked triangular solve of B on the calling thread (gemm may still use
+// several threads for the off-diagonal updates)
+template <typename S>
+void trsm_blocked(kernels::Uplo uplo, kernels::Diag diag, int m, int n,
+                  const S *T, std::ptrdiff_t rst, std::ptrdiff_t cst, S *B,
+                  std::ptrdiff_t ldb) {
+  // Solve one diagonal block at a time, then remove its contribution from the
+  // rows still to be solved with a single gemm
+  if (uplo == kernels::Uplo::lower) {
+    for (int i0 = 0; i0 < m; i0 += TRSM_BLOCK) {
+      int mb = std::min(TRSM_BLOCK, m - i0);
+      S *b_blk = B + i0 * ldb;
+      trsm_unblocked(uplo, diag, mb, n, T + i0 * rst + i0 * cst, rst, cst,
+                     b_blk, ldb);
+      int rest = m - i0 - mb;
+      gemm_impl<S>(rest, n, mb, -1, T + (i0 + mb) * rst + i0 * cst, rst, cst,
+                   b_blk, ldb, 1, 1, B + (i0 + mb) * ldb, ldb);
+    }
+  } else {
+    for (int i1 = m; i1 > 0; i1 -= TRSM_BLOCK) {
+      int i0 = std::max(0, i1 - TRSM_BLOCK);
+      int mb = i1 - i0;
+      S *b_blk = B + i0 * ldb;
+      trsm_unblocked(uplo, diag, mb, n, T + i0 * rst + i0 * cst, rst, cst,
+                     b_blk, ldb);
+      gemm_impl<S>(i0, n, mb, -1, T + i0 * cst, rst, cst, b_blk, ldb, 1, 1, B,
+                   ldb);
+    }
+  }
+}
+
+template <typename S>
+void trsm_impl(kernels::Uplo uplo, kernels::Diag diag, int m, int n,
+               const S *T, std::ptrdiff_t rst, std::ptrdiff_t cst, S *B,
+               std::ptrdiff_t ldb) {
+  if (m <= 0 || n <= 0) {
+    return;
+  }
+
+  // The columns of B are independent systems: with enough of them, each
+  // thread solves its own column blocks, streaming T once per block
+  int n_threads = parallel::get_num_threads();
+  long work = static_cast<long>(m) * m * n;
+  if (work <= PARALLEL_GEMM || n < 2 * TRSM_MIN_COLS || n_threads == 1 ||
+      parallel::in_parallel()) {
+    trsm_blocked(uplo, diag, m, n, T, rst, cst, B, ldb);
+    return;
+  }
+
+  int cols = (n + TILES_PER_THREAD * n_threads - 1) /
+             (TILES_PER_THREAD * n_threads);
+  cols = std::max(TRSM_MIN_COLS, round_up(cols, NR));
+  int n_blocks = (n + cols - 1) / cols;
+  parallel::parallel_for(n_blocks, [&](int b) {
+    int j0 = b * cols;
+    trsm_blocked(uplo, diag, m, std::min(cols, n - j0), T, rst, cst, B + j0,
+                 ldb);
+  });
+}
+
+} // namespace
+
+void kernels::gemm(int m, int n, int k, double alpha, const double *A,
+                   std::ptrdiff_t rsa, std::ptrdiff_t csa, const double *B,
+                   std::ptrdiff_t rsb, std::ptrdiff_t csb, double beta,
+                   double *C, std::ptrdiff_t ldc) {
+  gemm_impl(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+}
+
+void kernels::gemm(int m, int n, int k, float alpha, const float *A,
+                   std::ptrdiff_t rsa, std::ptrdiff_t csa, const float *B,
+                   std::ptrdiff_t rsb, std::ptrdiff_t csb, float beta,
+                   float *C, std::ptrdiff_t ldc) {
+  gemm_impl(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+}
+
+void kernels::trsm(Uplo uplo, Diag diag, int m, int n, const double *T,
+                   std::ptrdiff_t rst, std::ptrdiff_t cst, double *B,
+                   std::ptrdiff_t ldb) {
+  trsm_impl(uplo, diag, m, n, T, rst, cst, B, ldb);
+}
+
+void kernels::trsm(Uplo uplo, Diag diag, int m, int n, const float *T,
+                   std::ptrdiff_t rst, std::ptrdiff_t cst, float *B,
+                   std::ptrdiff_t ldb) {
+  trsm_impl(uplo, diag, m, n, T, rst, cst, B, ldb);
+}
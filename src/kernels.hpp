@@ -0,0 +1,48 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+
+// Low-level dense kernels operating on raw (strided) double or float buffers.
+// These are the building blocks used by Array and the decompositions; they do
+// no dimension checking of their own. The float overloads (used by the mixed
+// precision decompositions) move half the bytes and fit twice the values in
+// each vector register.
+namespace kernels {
+
+// General matrix multiply: C = alpha * A @ B + beta * C
+//
+// A is m x k and B is k x n, both addressed through a row stride and a column
+// stride (so transposed or sliced operands need no copies), and C is m x n
+// row-major with leading dimension ldc. When beta == 0, C is not read.
+//
+// Large products are split into output tiles computed on
+// parallel::get_num_threads() threads; small ones stay on the calling thread.
+void gemm(int m, int n, int k, double alpha, const double *A,
+          std::ptrdiff_t rsa, std::ptrdiff_t csa, const double *B,
+          std::ptrdiff_t rsb, std::ptrdiff_t csb, double beta, double *C,
+          std::ptrdiff_t ldc);
+void gemm(int m, int n, int k, float alpha, const float *A,
+          std::ptrdiff_t rsa, std::ptrdiff_t csa, const float *B,
+          std::ptrdiff_t rsb, std::ptrdiff_t csb, float beta, float *C,
+          std::ptrdiff_t ldc);
+
+// Triangular solve with multiple right-hand sides: overwrite B with
+// X = T^{-1} B, where T is an m x m lower or upper triangular matrix and B is
+// m x n row-major with leading dimension ldb. T is addressed through row and
+// column strides (so a transposed factor needs no copy) and, with a unit
+// diagonal, its diagonal entries are not read. Large systems are solved in
+// blocks, with the off-diagonal updates done by gemm, and wide B are split
+// into column blocks solved on parallel::get_num_threads() threads.
+enum class Uplo { lower, upper };
+enum class Diag { unit, non_unit };
+
+void trsm(Uplo uplo, Diag diag, int m, int n, const double *T,
+          std::ptrdiff_t rst, std::ptrdiff_t cst, double *B,
+          std::ptrdiff_t ldb);
+void trsm(Uplo uplo, Diag diag, int m, int n, const float *T,
+          std::ptrdiff_t rst, std::ptrdiff_t cst, float *B, std::ptrdiff_t ldb);
+
+} // namespace kernels
+
+#endif
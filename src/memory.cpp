@@ -0,0 +1,199 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+using memory::ALIGNMENT;
+
+std::atomic<std::size_t> n_allocations{0};
+std::atomic<std::size_t> n_heap_allocations{0};
+std::atomic<std::size_t> n_heap_deallocations{0};
+std::atomic<std::size_t> n_heap_bytes{0};
+
+thread_local memory::Allocator *current = nullptr;
+thread_local std::size_t n_thread_allocations = 0;
+
+std::size_t round_up(std::size_t bytes) {
+  return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+void *heap_allocate(std::size_t bytes) {
+  void *p = ::operator new(bytes, std::align_val_t(ALIGNMENT));
+  n_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  n_heap_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return p;
+}
+
+void heap_deallocate(void *p, std::size_t bytes) {
+  ::operator delete(p, std::align_val_t(ALIGNMENT));
+  n_heap_deallocations.fetch_add(1, std::memory_order_relaxed);
+  n_heap_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void count_allocation() {
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  ++n_thread_allocations;
+}
+
+class Heap : public memory::Allocator {
+public:
+  void *allocate(std::size_t bytes) override {
+    count_allocation();
+    return heap_allocate(bytes);
+  }
+
+  void deallocate(void *p, std::size_t bytes) override {
+    heap_deallocate(p, bytes);
+  }
+};
+
+// Size class of a pool request: class c holds blocks of 64 << c bytes
+int size_class(std::size_t bytes) {
+  int c = 0;
+  while ((ALIGNMENT << c) < bytes) {
+    ++c;
+  }
+  return c;
+}
+
+} // namespace
+
+memory::Allocator &memory::heap() {
+  static Heap instance;
+  return instance;
+}
+
+memory::Arena::Arena(std::size_t chunk_bytes)
+    : chunk_bytes(round_up(std::max<std::size_t>(chunk_bytes, 1))) {}
+
+memory::Arena::~Arena() {
+  for (Chunk &c : chunks) {
+    heap_deallocate(c.ptr, c.size);
+  }
+}
+
+void *memory::Arena::allocate(std::size_t bytes) {
+  count_allocation();
+  bytes = round_up(bytes);
+
+  // Bump within the current chunk, moving on to (reused) later chunks when
+  // it is full
+  while (cur < chunks.size()) {
+    if (offset + bytes <= chunks[cur].size) {
+      void *p = chunks[cur].ptr + offset;
+      offset += bytes;
+      return p;
+    }
+    ++cur;
+    offset = 0;
+  }
+
+  std::size_t size = std::max(chunk_bytes, bytes);
+  chunks.push_back({static_cast<char *>(heap_allocate(size)), size});
+  cur = chunks.size() - 1;
+  offset = bytes;
+  return chunks[cur].ptr;
+}
+
+void memory::Arena::deallocate(void *, std::size_t) {}
+
+memory::Arena::Mark memory::Arena::mark() const { return {cur, offset}; }
+
+void memory::Arena::rewind(Mark m) {
+  cur = m.chunk;
+  offset = m.offset;
+}
+
+void memory::Arena::reset() { rewind({0, 0}); }
+
+std::size_t memory::Arena::used() const {
+  std::size_t n = 0;
+  for (std::size_t c = 0; c < cur && c < chunks.size(); ++c) {
+    n += chunks[c].size;
+  }
+  return n + offset;
+}
+
+std::size_t memory::Arena::capacity() const {
+  std::size_t n = 0;
+  for (const Chunk &c : chunks) {
+    n += c.size;
+  }
+  return n;
+}
+
+memory::Pool::~Pool() { release(); }
+
+void *memory::Pool::allocate(std::size_t bytes) {
+  count_allocation();
+  if (bytes > MAX_BYTES) {
+    return heap_allocate(bytes);
+  }
+  int c = size_class(bytes);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free_lists[c].empty()) {
+      void *p = free_lists[c].back();
+      free_lists[c].pop_back();
+      return p;
+    }
+  }
+  return heap_allocate(ALIGNMENT << c);
+}
+
+void memory::Pool::deallocate(void *p, std::size_t bytes) {
+  if (bytes > MAX_BYTES) {
+    heap_deallocate(p, bytes);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  free_lists[size_class(bytes)].push_back(p);
+}
+
+void memory::Pool::release() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (int c = 0; c < N_CLASSES; ++c) {
+    for (void *p : free_lists[c]) {
+      heap_deallocate(p, ALIGNMENT << c);
+    }
+    free_lists[c].clear();
+    free_lists[c].shrink_to_fit();
+  }
+}
+
+memory::Allocator &memory::get_allocator() {
+  return current != nullptr ? *current : heap();
+}
+
+void memory::set_allocator(Allocator &a) { current = &a; }
+
+memory::ScopedAllocator::ScopedAllocator(Allocator &a)
+    : previous(&get_allocator()) {
+  set_allocator(a);
+}
+
+memory::ScopedAllocator::~ScopedAllocator() { set_allocator(*previous); }
+
+memory::ArenaScope::ArenaScope(Arena &a)
+    : arena(a), start(a.mark()), scope(a) {}
+
+memory::ArenaScope::~ArenaScope() { arena.rewind(start); }
+
+memory::Counters memory::get_counters() {
+  return {n_allocations.load(), n_heap_allocations.load(),
+          n_heap_deallocations.load(), n_heap_bytes.load()};
+}
+
+void memory::reset_counters() {
+  n_allocations = 0;
+  n_heap_allocations = 0;
+  n_heap_deallocations = 0;
+}
+
+std::size_t memory::thread_allocations() { return n_thread_allocations; }
@@ -0,0 +1,191 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Pluggable allocation of Array storage. Every Array takes its storage from
+// the allocator installed on the constructing thread (the heap by default),
+// and returns it to that same allocator. Installing an Arena or a Pool around
+// a hot loop lets it run without touching the heap at all, which the
+// counters below can confirm.
+namespace memory {
+
+// Alignment of every allocation (a cache line, and a full AVX-512 vector)
+constexpr std::size_t ALIGNMENT = 64;
+
+class Allocator {
+public:
+  virtual ~Allocator() = default;
+
+  // At least `bytes` bytes, aligned to ALIGNMENT
+  virtual void *allocate(std::size_t bytes) = 0;
+
+  // Give back memory from allocate(bytes) on this allocator
+  virtual void deallocate(void *p, std::size_t bytes) = 0;
+};
+
+// The default allocator: every request goes to the heap
+Allocator &heap();
+
+// Bump allocator over a list of heap chunks. Allocating is a pointer bump and
+// deallocating does nothing: memory is only reclaimed, all at once, by
+// rewinding to a mark or resetting. Chunks are kept for reuse, so after the
+// first pass a loop that resets the arena makes no heap allocations. Arrays
+// allocated from an Arena must not be used after it is rewound past them. An
+// Arena must only be used by one thread at a time.
+class Arena : public Allocator {
+public:
+  // Position in the arena, to rewind to
+  struct Mark {
+    std::size_t chunk;
+    std::size_t offset;
+  };
+
+  explicit Arena(std::size_t chunk_bytes = std::size_t(1) << 20);
+  ~Arena() override;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(std::size_t bytes) override;
+  void deallocate(void *, std::size_t) override;
+
+  Mark mark() const;
+  void rewind(Mark);
+  void reset();
+
+  // Bytes handed out since the last reset, and bytes held in chunks
+  std::size_t used() const;
+  std::size_t capacity() const;
+
+private:
+  struct Chunk {
+    char *ptr;
+    std::size_t size;
+  };
+  std::size_t chunk_bytes;
+  std::vector<Chunk> chunks;
+  std::size_t cur = 0, offset = 0;
+};
+
+// Size-class pool: requests are rounded up to a power of two between 64 bytes
+// and MAX_BYTES, and freed blocks are cached per class to be handed out
+// again. Larger requests go straight to the heap. Pools are thread safe, so
+// Arrays allocated from one may be freed on any thread; the Pool must outlive
+// them.
+class Pool : public Allocator {
+public:
+  static constexpr std::size_t MAX_BYTES = std::size_t(1) << 20;
+
+  Pool() = default;
+  ~Pool() override;
+  Pool(const Pool &) = delete;
+  Pool &operator=(const Pool &) = delete;
+
+  void *allocate(std::size_t bytes) override;
+  void deallocate(void *, std::size_t) override;
+
+  // Return every cached block to the heap
+  void release();
+
+private:
+  static constexpr int N_CLASSES = 15; // 64 bytes to MAX_BYTES
+  std::mutex mutex;
+  std::vector<void *> free_lists[N_CLASSES];
+};
+
+// The allocator used for new Array storage on the calling thread
+Allocator &get_allocator();
+void set_allocator(Allocator &);
+
+// Install an allocator on the calling thread for the current scope, restoring
+// the previous one on exit
+class ScopedAllocator {
+public:
+  explicit ScopedAllocator(Allocator &);
+  ~ScopedAllocator();
+  ScopedAllocator(const ScopedAllocator &) = delete;
+  ScopedAllocator &operator=(const ScopedAllocator &) = delete;
+
+private:
+  Allocator *previous;
+};
+
+// Install an arena for the current scope, and rewind it on exit to where it
+// was on entry: every Array allocated in the scope must be gone by then
+class ArenaScope {
+public:
+  explicit ArenaScope(Arena &);
+  ~ArenaScope();
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+  Arena &arena;
+  Arena::Mark start;
+  ScopedAllocator scope;
+};
+
+// Process-wide allocation counters. `allocations` counts Array storage
+// requests to any allocator; the heap_* counters count the requests that
+// reached the heap (directly, or for an arena chunk or a pool block), and
+// heap_bytes is the heap memory currently held through them.
+struct Counters {
+  std::size_t allocations;
+  std::size_t heap_allocations;
+  std::size_t heap_deallocations;
+  std::size_t heap_bytes;
+};
+
+Counters get_counters();
+void reset_counters();
+
+// Array storage requests made by the calling thread, to any allocator, since
+// it started (not affected by reset_counters)
+std::size_t thread_allocations();
+
+// Standard allocator adaptor over the above, used for Array's storage. A
+// default-constructed (or container-copied) adaptor captures the calling
+// thread's allocator, and a moved-into container keeps the storage along with
+// its allocator. Move assignment keeps the target's allocator instead, copying
+// the values when the allocators differ, so that e.g. assigning an Array built
+// inside an ArenaScope to one declared outside it doesn't leave the outer Array
+// on arena memory once the scope rewinds.
+template <typename T> class StlAllocator {
+private:
+  Allocator *alloc;
+
+public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::true_type;
+
+  StlAllocator() : alloc(&get_allocator()) {}
+  explicit StlAllocator(Allocator &a) : alloc(&a) {}
+  template <typename U>
+  StlAllocator(const StlAllocator<U> &other) : alloc(other.get()) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(alloc->allocate(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t n) { alloc->deallocate(p, n * sizeof(T)); }
+
+  StlAllocator select_on_container_copy_construction() const {
+    return StlAllocator();
+  }
+
+  Allocator *get() const { return alloc; }
+
+  template <typename U> bool operator==(const StlAllocator<U> &other) const {
+    return alloc == other.get();
+  }
+  template <typename U> bool operator!=(const StlAllocator<U> &other) const {
+    return alloc != other.get();
+  }
+};
+
+} // namespace memory
+
+#endif
@@ -0,0 +1,299 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int default_num_threads() {
+  const char *env = std::getenv("ULINALG_NUM_THREADS");
+  if (env != nullptr) {
+    int n = std::atoi(env);
+    if (n > 0) {
+      return n;
+    }
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::atomic<int> num_threads{default_num_threads()};
+
+thread_local bool inside_task = false;
+
+// One parallel_for call: its tasks are handed out from `next` to the calling
+// thread and to up to max_helpers pool workers
+struct Job {
+  const std::function<void(int)> *body;
+  int n_tasks;
+  std::atomic<int> next{0};
+  int max_helpers;
+  int helpers = 0; // workers that have joined (pool mutex held)
+  int active = 0;  // workers still running its tasks (pool mutex held)
+  std::exception_ptr error;
+  std::mutex error_mutex;
+};
+
+void run_tasks(Job &job) {
+  bool was_inside = inside_task;
+  inside_task = true;
+  for (int t = job.next++; t < job.n_tasks; t = job.next++) {
+    try {
+      (*job.body)(t);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.error_mutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+      // Stop handing out further tasks
+      job.next = job.n_tasks;
+    }
+  }
+  inside_task = was_inside;
+}
+
+// Persistent worker threads, started on the first parallel_for that needs
+// them rather than once per call. Workers take jobs in the order they were
+// posted, so concurrent parallel_for calls (from different threads) share the
+// pool; a job's caller runs its tasks too, so every job finishes even if no
+// worker is free to help.
+class Pool {
+public:
+  // Run job on the calling thread and up to job.max_helpers workers, and
+  // return once all of its tasks have finished
+  void run(Job &job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (static_cast<int>(workers.size()) < job.max_helpers) {
+        workers.push_back(std::make_unique<Worker>());
+        Worker *w = workers.back().get();
+        w->thread = std::thread([this, w] { work(*w); });
+      }
+      jobs.push_back(&job);
+    }
+    for (int i = 0; i < job.max_helpers; ++i) {
+      work_cv.notify_one();
+    }
+
+    run_tasks(job);
+
+    // Every task has been handed out: wait for workers still running some
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = std::find(jobs.begin(), jobs.end(), &job);
+    if (it != jobs.end()) {
+      jobs.erase(it);
+    }
+    done_cv.wait(lock, [&] { return job.active == 0; });
+  }
+
+  // Stop workers beyond the first n (once they finish their current job)
+  void shrink(int n) {
+    std::vector<std::unique_ptr<Worker>> retired;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (static_cast<int>(workers.size()) > std::max(n, 0)) {
+        workers.back()->retire = true;
+        retired.push_back(std::move(workers.back()));
+        workers.pop_back();
+      }
+    }
+    work_cv.notify_all();
+    for (auto &w : retired) {
+      w->thread.join();
+    }
+  }
+
+private:
+  struct Worker {
+    std::thread thread;
+    bool retire = false; // pool mutex held
+  };
+
+  std::mutex mutex;
+  std::condition_variable work_cv, done_cv;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::deque<Job *> jobs; // jobs with room for another worker
+
+  void work(Worker &w) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      work_cv.wait(lock, [&] { return w.retire || !jobs.empty(); });
+      if (w.retire) {
+        return;
+      }
+      Job &job = *jobs.front();
+      job.helpers += 1;
+      job.active += 1;
+      if (job.helpers == job.max_helpers) {
+        jobs.pop_front();
+      }
+
+      lock.unlock();
+      run_tasks(job);
+      lock.lock();
+
+      job.active -= 1;
+      if (job.active == 0) {
+        done_cv.notify_all();
+      }
+    }
+  }
+};
+
+// Never destroyed, so that parallel_for stays usable from static destructors
+// (idle workers are left waiting at exit)
+Pool &pool() {
+  static Pool *p = new Pool;
+  return *p;
+}
+
+std::atomic<bool> pool_started{false};
+
+} // namespace
+
+void parallel::set_num_threads(int n) {
+  num_threads = (n < 1) ? default_num_threads() : n;
+  // (not from within a task, which may be running on a worker to be stopped)
+  if (pool_started && !inside_task) {
+    pool().shrink(num_threads - 1);
+  }
+}
+
+int parallel::get_num_threads() { return num_threads; }
+
+bool parallel::in_parallel() { return inside_task; }
+
+void parallel::parallel_for(int n_tasks, const std::function<void(int)> &body,
+                            int max_threads) {
+  if (max_threads < 1) {
+    max_threads = get_num_threads();
+  }
+  int n_workers = std::min(max_threads, n_tasks);
+
+  // Serial fallback: a single task, a single thread, or already nested
+  if (n_workers <= 1 || inside_task) {
+    for (int t = 0; t < n_tasks; ++t) {
+      body(t);
+    }
+    return;
+  }
+
+  Job job;
+  job.body = &body;
+  job.n_tasks = n_tasks;
+  job.max_helpers = n_workers - 1;
+  pool_started = true;
+  pool().run(job);
+
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+int parallel::TaskGraph::add(std::function<void()> fn, int priority) {
+  tasks.push_back({std::move(fn), priority, 0, {}});
+  return static_cast<int>(tasks.size()) - 1;
+}
+
+void parallel::TaskGraph::depend(int before, int after) {
+  tasks[before].successors.push_back(after);
+  tasks[after].n_deps += 1;
+}
+
+int parallel::TaskGraph::size() const {
+  return static_cast<int>(tasks.size());
+}
+
+void parallel::TaskGraph::run(int n_threads) {
+  if (n_threads < 1) {
+    n_threads = get_num_threads();
+  }
+  if (inside_task) {
+    n_threads = 1;
+  }
+  int n_tasks = size();
+
+  // Ready queue ordered by priority, then by insertion order
+  auto later = [this](int a, int b) {
+    if (tasks[a].priority != tasks[b].priority) {
+      return tasks[a].priority < tasks[b].priority;
+    }
+    return a > b;
+  };
+  std::priority_queue<int, std::vector<int>, decltype(later)> ready(later);
+
+  std::vector<int> remaining(n_tasks);
+  for (int t = 0; t < n_tasks; ++t) {
+    remaining[t] = tasks[t].n_deps;
+    if (remaining[t] == 0) {
+      ready.push(t);
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  int n_done = 0;
+  int n_running = 0;
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    bool was_inside = inside_task;
+    inside_task = true;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() {
+        return !ready.empty() || n_done == n_tasks ||
+               (error && n_running == 0);
+      });
+      if (n_done == n_tasks || error) {
+        break;
+      }
+      int t = ready.top();
+      ready.pop();
+      n_running += 1;
+
+      lock.unlock();
+      try {
+        tasks[t].fn();
+      } catch (...) {
+        lock.lock();
+        if (!error) {
+          error = std::current_exception();
+        }
+        n_running -= 1;
+        cv.notify_all();
+        continue;
+      }
+      lock.lock();
+
+      n_running -= 1;
+      n_done += 1;
+      for (int s : tasks[t].successors) {
+        if (--remaining[s] == 0) {
+          ready.push(s);
+        }
+      }
+      cv.notify_all();
+    }
+    inside_task = was_inside;
+  };
+
+  // Each pool thread runs the worker loop; should fewer be free, those that
+  // are simply run more of the graph
+  parallel_for(
+      n_threads, [&](int) { worker(); }, n_threads);
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
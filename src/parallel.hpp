@@ -0,0 +1,64 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <functional>
+#include <vector>
+
+// Minimal shared-memory parallelism used by the kernels
+namespace parallel {
+
+// Number of threads used by parallel kernels. Defaults to the value of the
+// ULINALG_NUM_THREADS environment variable if set, otherwise to the hardware
+// concurrency. Setting a value < 1 restores that default. Setting a smaller
+// value also stops the pool's surplus threads.
+void set_num_threads(int);
+int get_num_threads();
+
+// True on a thread currently running a parallel_for task
+bool in_parallel();
+
+// Run body(t) for every t in [0, n_tasks) using up to max_threads threads
+// (get_num_threads() if max_threads < 1), the calling thread included. The
+// other threads come from a pool of persistent workers, started on first use
+// and grown as needed, so a call costs a wake-up rather than thread creation;
+// calls from several threads at once share the pool. Tasks are handed out
+// dynamically, so they need not be of equal cost. Nested calls run serially
+// on the calling thread. The first exception thrown by a task is rethrown once
+// all threads have finished.
+void parallel_for(int n_tasks, const std::function<void(int)> &body,
+                  int max_threads = 0);
+
+// Dependency-driven task scheduler: tasks are added with a priority, edges
+// say which tasks must finish before another may start, and run() executes
+// the whole graph. Among the tasks that are ready, those with the highest
+// priority run first (ties go to the task added first), which lets callers
+// keep critical-path work moving ahead of bulk updates.
+class TaskGraph {
+public:
+  // Add a task, returning its id
+  int add(std::function<void()> fn, int priority = 0);
+
+  // Task `after` may only start once task `before` has finished. The edges
+  // must not form a cycle.
+  void depend(int before, int after);
+
+  // Run every task on up to n_threads threads (get_num_threads() if < 1), the
+  // calling thread included. The first exception thrown by a task stops any
+  // further tasks from starting, and is rethrown once running ones finish.
+  void run(int n_threads = 0);
+
+  int size() const;
+
+private:
+  struct Task {
+    std::function<void()> fn;
+    int priority;
+    int n_deps;
+    std::vector<int> successors;
+  };
+  std::vector<Task> tasks;
+};
+
+} // namespace parallel
+
+#endif
@@ -0,0 +1,217 @@
+#include "profile.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using profile::Op;
+
+constexpr int N_OPS = static_cast<int>(Op::count);
+
+// Shape buckets: bucket b holds largest dimensions in (2^(b-1), 2^b]
+constexpr int N_BUCKETS = 32;
+
+int bucket(int nrow, int ncol) {
+  int dim = std::max(nrow, ncol);
+  int b = 0;
+  while (b + 1 < N_BUCKETS && (1 << b) < dim) {
+    ++b;
+  }
+  return b;
+}
+
+// Counters of one thread. Only the owning thread writes them, so the atomics
+// are never contended; they let snapshot() read them from another thread.
+struct Counters {
+  std::atomic<std::size_t> calls{0};
+  std::atomic<double> seconds{0};
+  std::atomic<double> flops{0};
+  std::atomic<double> bytes{0};
+  std::atomic<std::size_t> allocations{0};
+};
+
+template <typename T> void add(std::atomic<T> &counter, T value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+struct Table {
+  Counters counters[N_OPS][N_BUCKETS];
+
+  void add_to(std::vector<profile::Stats> &totals) const {
+    for (int op = 0; op < N_OPS; ++op) {
+      for (int b = 0; b < N_BUCKETS; ++b) {
+        const Counters &c = counters[op][b];
+        profile::Stats &t = totals[op * N_BUCKETS + b];
+        t.calls += c.calls.load(std::memory_order_relaxed);
+        t.seconds += c.seconds.load(std::memory_order_relaxed);
+        t.flops += c.flops.load(std::memory_order_relaxed);
+        t.bytes += c.bytes.load(std::memory_order_relaxed);
+        t.allocations += c.allocations.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto &row : counters) {
+      for (Counters &c : row) {
+        c.calls = 0;
+        c.seconds = 0;
+        c.flops = 0;
+        c.bytes = 0;
+        c.allocations = 0;
+      }
+    }
+  }
+};
+
+// The tables of live threads, and the totals of threads that have exited
+struct Registry {
+  std::mutex mutex;
+  std::vector<Table *> live;
+  std::vector<profile::Stats> retired =
+      std::vector<profile::Stats>(N_OPS * N_BUCKETS, profile::Stats{});
+};
+
+Registry &registry() {
+  static Registry *r = new Registry(); // outlives every thread's table
+  return *r;
+}
+
+// A thread's table, registered on its first recording
+struct ThreadTable {
+  Table table;
+
+  ThreadTable() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(&table);
+  }
+
+  ~ThreadTable() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    table.add_to(r.retired);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), &table));
+  }
+};
+
+Table &thread_table() {
+  thread_local ThreadTable t;
+  return t.table;
+}
+
+std::string format(const char *fmt, double value) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), fmt, value);
+  return buf;
+}
+
+} // namespace
+
+const char *profile::name(Op op) {
+  static const char *names[N_OPS] = {
+      "mult",      "add",       "sub",          "mul",      "div",
+      "add_bcast", "sub_bcast", "mul_bcast",    "div_bcast", "bcast",
+      "lu_decompose", "lu_solve", "chol_decompose", "chol_solve",
+      "chol_update", "sparse_mult"};
+  return names[static_cast<int>(op)];
+}
+
+void profile::record(Op op, int nrow, int ncol, double seconds, double flops,
+                     double bytes, std::size_t allocations) {
+  Counters &c =
+      thread_table().counters[static_cast<int>(op)][bucket(nrow, ncol)];
+  add<std::size_t>(c.calls, 1);
+  add(c.seconds, seconds);
+  add(c.flops, flops);
+  add(c.bytes, bytes);
+  add(c.allocations, allocations);
+}
+
+profile::Scope::Scope(Op op, int nrow, int ncol, double flops, double bytes)
+    : op(op), nrow(nrow), ncol(ncol), flops(flops), bytes(bytes),
+      allocations(memory::thread_allocations()),
+      start(std::chrono::steady_clock::now()) {}
+
+profile::Scope::~Scope() {
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  record(op, nrow, ncol, seconds, flops, bytes,
+         memory::thread_allocations() - allocations);
+}
+
+std::vector<profile::Entry> profile::snapshot() {
+  Registry &r = registry();
+  std::vector<Stats> totals;
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    totals = r.retired;
+    for (const Table *t : r.live) {
+      t->add_to(totals);
+    }
+  }
+
+  std::vector<Entry> entries;
+  for (int op = 0; op < N_OPS; ++op) {
+    for (int b = 0; b < N_BUCKETS; ++b) {
+      const Stats &s = totals[op * N_BUCKETS + b];
+      if (s.calls > 0) {
+        entries.push_back({static_cast<Op>(op), 1 << b, s});
+      }
+    }
+  }
+  return entries;
+}
+
+void profile::reset() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::fill(r.retired.begin(), r.retired.end(), Stats{});
+  for (Table *t : r.live) {
+    t->clear();
+  }
+}
+
+std::string profile::to_text(const std::vector<Entry> &entries) {
+  std::string out;
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-15s %8s %10s %12s %12s %12s %8s\n",
+                "op", "max_dim", "calls", "seconds", "flops", "bytes",
+                "allocs");
+  out += line;
+  for (const Entry &e : entries) {
+    std::snprintf(line, sizeof(line),
+                  "%-15s %8d %10zu %12.4e %12.4e %12.4e %8zu\n", name(e.op),
+                  e.max_dim, e.stats.calls, e.stats.seconds, e.stats.flops,
+                  e.stats.bytes, e.stats.allocations);
+    out += line;
+  }
+  return out;
+}
+
+std::string profile::to_json(const std::vector<Entry> &entries) {
+  std::string out = "[";
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const Entry &e = entries[i];
+    out += (i == 0) ? "\n" : ",\n";
+    out += "  {\"op\": \"" + std::string(name(e.op)) +
+           "\", \"max_dim\": " + std::to_string(e.max_dim) +
+           ", \"calls\": " + std::to_string(e.stats.calls) +
+           ", \"seconds\": " + format("%.6e", e.stats.seconds) +
+           ", \"flops\": " + format("%.6e", e.stats.flops) +
+           ", \"bytes\": " + format("%.6e", e.stats.bytes) +
+           ", \"allocations\": " + std::to_string(e.stats.allocations) + "}";
+  }
+  out += entries.empty() ? "]" : "\n]";
+  return out;
+}
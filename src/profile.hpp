@@ -0,0 +1,118 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Opt-in instrumentation of the library's hot paths. When built with
+// ULINALG_PROFILE defined (the ULINALG_PROFILE CMake option), mult (dense and
+// sparse), the elementwise operators, broadcasting and the decompositions and
+// solves each record their call count, wall time, estimated FLOPs and bytes
+// moved, and the Array allocations they make, per operation and shape bucket.
+// Counters are kept per thread, so recording takes no locks; snapshot() sums
+// them over all threads. Without ULINALG_PROFILE the recording sites compile
+// to nothing and snapshot() is always empty.
+//
+// Time spent in a recorded operation that calls another (e.g. the solve of a
+// decomposition allocating its result) is counted by both.
+namespace profile {
+
+// Elementwise operators whose operands broadcast are recorded separately from
+// same-shape ones; bcast is an explicit array_detail::bcast
+enum class Op {
+  mult,
+  add,
+  sub,
+  mul,
+  div,
+  add_bcast,
+  sub_bcast,
+  mul_bcast,
+  div_bcast,
+  bcast,
+  lu_decompose,
+  lu_solve,
+  chol_decompose,
+  chol_solve,
+  chol_update,
+  sparse_mult,
+  count
+};
+
+const char *name(Op);
+
+// Whether the recording sites are compiled in
+constexpr bool enabled() {
+#ifdef ULINALG_PROFILE
+  return true;
+#else
+  return false;
+#endif
+}
+
+struct Stats {
+  std::size_t calls;
+  double seconds;
+  double flops;
+  double bytes;
+  std::size_t allocations;
+};
+
+// Totals for an operation on shapes whose largest dimension is at most
+// max_dim (a power of two) and more than half of it
+struct Entry {
+  Op op;
+  int max_dim;
+  Stats stats;
+};
+
+// The non-zero totals, over all threads (past and present), ordered by
+// operation then shape bucket
+std::vector<Entry> snapshot();
+
+// Zero every thread's counters. Operations recorded concurrently with a reset
+// may be lost.
+void reset();
+
+// One line per entry, or a JSON array of objects
+std::string to_text(const std::vector<Entry> &);
+std::string to_json(const std::vector<Entry> &);
+
+// Add one call to the calling thread's counters
+void record(Op, int nrow, int ncol, double seconds, double flops, double bytes,
+            std::size_t allocations);
+
+// Records one call of op, timed from construction to destruction
+class Scope {
+public:
+  Scope(Op op, int nrow, int ncol, double flops, double bytes);
+  ~Scope();
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  Op op;
+  int nrow, ncol;
+  double flops, bytes;
+  std::size_t allocations;
+  std::chrono::steady_clock::time_point start;
+};
+
+} // namespace profile
+
+// Record the enclosing scope as one call of op on an nrow x ncol shape
+#ifdef ULINALG_PROFILE
+#define ULINALG_PROFILE_CAT2(a, b) a##b
+#define ULINALG_PROFILE_CAT(a, b) ULINALG_PROFILE_CAT2(a, b)
+#define ULINALG_PROFILE_SCOPE(op, nrow, ncol, flops, bytes)                    \
+  ::profile::Scope ULINALG_PROFILE_CAT(profile_scope_, __LINE__)(              \
+      op, nrow, ncol, flops, bytes)
+#else
+#define ULINALG_PROFILE_SCOPE(op, nrow, ncol, flops, bytes)                    \
+  do {                                                                         \
+  } while (false)
+#endif
+
+#endif
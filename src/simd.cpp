@@ -0,0 +1,279 @@
+#include "simd.hpp"
+#include "simd_detail.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+namespace {
+
+using simd::Isa;
+using simd::Op;
+using namespace simd_detail;
+
+template <Op op, typename V>
+ULINALG_ALWAYS_INLINE V apply(const V &a, const V &b) {
+  if (op == Op::add) {
+    return a + b;
+  } else if (op == Op::sub) {
+    return a - b;
+  } else if (op == Op::mul) {
+    return a * b;
+  } else {
+    return a / b;
+  }
+}
+
+template <Op op, typename V, int W, typename S>
+ULINALG_ALWAYS_INLINE void binary_kernel(std::size_t n, const S *l,
+                                         std::ptrdiff_t ls, const S *r,
+                                         std::ptrdiff_t rs, S *out) {
+  std::size_t j = 0;
+  if (ls != 0 && rs != 0) {
+    for (; j + W <= n; j += W) {
+      store(out + j, apply<op>(load<V>(l + j), load<V>(r + j)));
+    }
+  } else if (ls != 0) {
+    V rv = splat<V>(r[0]);
+    for (; j + W <= n; j += W) {
+      store(out + j, apply<op>(load<V>(l + j), rv));
+    }
+  } else if (rs != 0) {
+    V lv = splat<V>(l[0]);
+    for (; j + W <= n; j += W) {
+      store(out + j, apply<op>(lv, load<V>(r + j)));
+    }
+  } else {
+    V v = splat<V>(apply<op>(l[0], r[0]));
+    for (; j + W <= n; j += W) {
+      store(out + j, v);
+    }
+  }
+
+  // Remainder that doesn't fill a whole vector
+  for (; j < n; ++j) {
+    out[j] = apply<op>(l[j * ls], r[j * rs]);
+  }
+}
+
+template <typename V, int W, typename S>
+ULINALG_ALWAYS_INLINE void binary_variant(Op op, std::size_t n, const S *l,
+                                          std::ptrdiff_t ls, const S *r,
+                                          std::ptrdiff_t rs, S *out) {
+  switch (op) {
+  case Op::add:
+    binary_kernel<Op::add, V, W>(n, l, ls, r, rs, out);
+    break;
+  case Op::sub:
+    binary_kernel<Op::sub, V, W>(n, l, ls, r, rs, out);
+    break;
+  case Op::mul:
+    binary_kernel<Op::mul, V, W>(n, l, ls, r, rs, out);
+    break;
+  case Op::div:
+    binary_kernel<Op::div, V, W>(n, l, ls, r, rs, out);
+    break;
+  }
+}
+
+template <typename V, int W, typename S>
+ULINALG_ALWAYS_INLINE void fill_variant(std::size_t n, S value, S *out) {
+  V v = splat<V>(value);
+  std::size_t j = 0;
+  for (; j + W <= n; j += W) {
+    store(out + j, v);
+  }
+  for (; j < n; ++j) {
+    out[j] = value;
+  }
+}
+
+void binary_scalar(Op op, std::size_t n, const double *l, std::ptrdiff_t ls,
+                   const double *r, std::ptrdiff_t rs, double *out) {
+  binary_variant<double, 1>(op, n, l, ls, r, rs, out);
+}
+
+void fill_scalar(std::size_t n, double value, double *out) {
+  fill_variant<double, 1>(n, value, out);
+}
+
+void binary_scalar(Op op, std::size_t n, const float *l, std::ptrdiff_t ls,
+                   const float *r, std::ptrdiff_t rs, float *out) {
+  binary_variant<float, 1>(op, n, l, ls, r, rs, out);
+}
+
+void fill_scalar(std::size_t n, float value, float *out) {
+  fill_variant<float, 1>(n, value, out);
+}
+
+#ifdef ULINALG_SIMD_X86
+__attribute__((target("sse2"))) void
+binary_sse2(Op op, std::size_t n, const double *l, std::ptrdiff_t ls,
+            const double *r, std::ptrdiff_t rs, double *out) {
+  binary_variant<v2d, 2>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("avx2"))) void
+binary_avx2(Op op, std::size_t n, const double *l, std::ptrdiff_t ls,
+            const double *r, std::ptrdiff_t rs, double *out) {
+  binary_variant<v4d, 4>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("avx512f"))) void
+binary_avx512(Op op, std::size_t n, const double *l, std::ptrdiff_t ls,
+              const double *r, std::ptrdiff_t rs, double *out) {
+  binary_variant<v8d, 8>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("sse2"))) void fill_sse2(std::size_t n, double value,
+                                               double *out) {
+  fill_variant<v2d, 2>(n, value, out);
+}
+
+__attribute__((target("avx2"))) void fill_avx2(std::size_t n, double value,
+                                               double *out) {
+  fill_variant<v4d, 4>(n, value, out);
+}
+
+__attribute__((target("avx512f"))) void
+fill_avx512(std::size_t n, double value, double *out) {
+  fill_variant<v8d, 8>(n, value, out);
+}
+
+// Float variants: twice the lanes per register
+__attribute__((target("sse2"))) void
+binary_sse2(Op op, std::size_t n, const float *l, std::ptrdiff_t ls,
+            const float *r, std::ptrdiff_t rs, float *out) {
+  binary_variant<v4f, 4>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("avx2"))) void
+binary_avx2(Op op, std::size_t n, const float *l, std::ptrdiff_t ls,
+            const float *r, std::ptrdiff_t rs, float *out) {
+  binary_variant<v8f, 8>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("avx512f"))) void
+binary_avx512(Op op, std::size_t n, const float *l, std::ptrdiff_t ls,
+              const float *r, std::ptrdiff_t rs, float *out) {
+  binary_variant<v16f, 16>(op, n, l, ls, r, rs, out);
+}
+
+__attribute__((target("sse2"))) void fill_sse2(std::size_t n, float value,
+                                               float *out) {
+  fill_variant<v4f, 4>(n, value, out);
+}
+
+__attribute__((target("avx2"))) void fill_avx2(std::size_t n, float value,
+                                               float *out) {
+  fill_variant<v8f, 8>(n, value, out);
+}
+
+__attribute__((target("avx512f"))) void fill_avx512(std::size_t n, float value,
+                                                    float *out) {
+  fill_variant<v16f, 16>(n, value, out);
+}
+#endif
+
+std::atomic<Isa> &active_isa() {
+  static std::atomic<Isa> isa{simd::detected_isa()};
+  return isa;
+}
+
+// Dispatch to the variant for the active instruction set (the overload for S)
+template <typename S>
+void binary_dispatch(Op op, std::size_t n, const S *l, std::ptrdiff_t l_stride,
+                     const S *r, std::ptrdiff_t r_stride, S *out) {
+  switch (active_isa().load(std::memory_order_relaxed)) {
+#ifdef ULINALG_SIMD_X86
+  case Isa::avx512:
+    binary_avx512(op, n, l, l_stride, r, r_stride, out);
+    return;
+  case Isa::avx2:
+    binary_avx2(op, n, l, l_stride, r, r_stride, out);
+    return;
+  case Isa::sse2:
+    binary_sse2(op, n, l, l_stride, r, r_stride, out);
+    return;
+#endif
+  default:
+    binary_scalar(op, n, l, l_stride, r, r_stride, out);
+  }
+}
+
+template <typename S> void fill_dispatch(std::size_t n, S value, S *out) {
+  switch (active_isa().load(std::memory_order_relaxed)) {
+#ifdef ULINALG_SIMD_X86
+  case Isa::avx512:
+    fill_avx512(n, value, out);
+    return;
+  case Isa::avx2:
+    fill_avx2(n, value, out);
+    return;
+  case Isa::sse2:
+    fill_sse2(n, value, out);
+    return;
+#endif
+  default:
+    fill_scalar(n, value, out);
+  }
+}
+
+} // namespace
+
+bool simd::supported(Isa isa) {
+#ifdef ULINALG_SIMD_X86
+  __builtin_cpu_init();
+  switch (isa) {
+  case Isa::scalar:
+    return true;
+  case Isa::sse2:
+    return __builtin_cpu_supports("sse2");
+  case Isa::avx2:
+    return __builtin_cpu_supports("avx2");
+  case Isa::avx512:
+    return __builtin_cpu_supports("avx512f");
+  }
+  return false;
+#else
+  return isa == Isa::scalar;
+#endif
+}
+
+Isa simd::detected_isa() {
+  for (Isa isa : {Isa::avx512, Isa::avx2, Isa::sse2}) {
+    if (supported(isa)) {
+      return isa;
+    }
+  }
+  return Isa::scalar;
+}
+
+Isa simd::get_isa() { return active_isa(); }
+
+void simd::set_isa(Isa isa) {
+  if (!supported(isa)) {
+    throw std::invalid_argument("Instruction set not supported by this CPU");
+  }
+  active_isa() = isa;
+}
+
+void simd::binary(Op op, std::size_t n, const double *l,
+                  std::ptrdiff_t l_stride, const double *r,
+                  std::ptrdiff_t r_stride, double *out) {
+  binary_dispatch(op, n, l, l_stride, r, r_stride, out);
+}
+
+void simd::binary(Op op, std::size_t n, const float *l,
+                  std::ptrdiff_t l_stride, const float *r,
+                  std::ptrdiff_t r_stride, float *out) {
+  binary_dispatch(op, n, l, l_stride, r, r_stride, out);
+}
+
+void simd::fill(std::size_t n, double value, double *out) {
+  fill_dispatch(n, value, out);
+}
+
+void simd::fill(std::size_t n, float value, float *out) {
+  fill_dispatch(n, value, out);
+}
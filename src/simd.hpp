@@ -0,0 +1,43 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+
+// Vectorized elementwise kernels. Each kernel is compiled once per instruction
+// set (SSE2, AVX2 and AVX-512 on x86, plus a portable scalar version), and the
+// best variant supported by the running CPU is picked at startup.
+namespace simd {
+
+enum class Op { add, sub, mul, div };
+
+enum class Isa { scalar, sse2, avx2, avx512 };
+
+// out[j] = l[j] op r[j] for j in [0, n). A stride of 0 broadcasts the single
+// value at l (or r), a stride of 1 reads contiguous values; this covers the
+// same-shape, scalar, row and column broadcasting cases. out may alias l or r
+// when their stride is 1. The float overload fits twice the values in each
+// vector.
+void binary(Op op, std::size_t n, const double *l, std::ptrdiff_t l_stride,
+            const double *r, std::ptrdiff_t r_stride, double *out);
+void binary(Op op, std::size_t n, const float *l, std::ptrdiff_t l_stride,
+            const float *r, std::ptrdiff_t r_stride, float *out);
+
+// out[j] = value for j in [0, n)
+void fill(std::size_t n, double value, double *out);
+void fill(std::size_t n, float value, float *out);
+
+// Whether the running CPU (and OS) support an instruction set
+bool supported(Isa);
+
+// The best supported instruction set, detected via CPUID
+Isa detected_isa();
+
+// The instruction set currently used by the kernels. set_isa overrides the
+// detected choice (e.g. to compare variants), and throws
+// std::invalid_argument if the CPU doesn't support it.
+Isa get_isa();
+void set_isa(Isa);
+
+} // namespace simd
+
+#endif
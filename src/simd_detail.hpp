@@ -0,0 +1,89 @@
+#ifndef SIMD_DETAIL_HPP
+#define SIMD_DETAIL_HPP
+
+// Building blocks shared by the vectorized kernels (simd.cpp, batch.cpp,
+// sparse.cpp).
+// Internal to the library: only include this from source files.
+
+#include <cstring>
+
+// The vector variants use GCC/Clang vector extensions and per-function target
+// attributes, so they are only built for x86 with those compilers
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define ULINALG_SIMD_X86 1
+#define ULINALG_ALWAYS_INLINE inline __attribute__((always_inline))
+// Unroll the loop that follows (completely, if its trip count is a constant
+// of at most 16)
+#define ULINALG_UNROLL _Pragma("GCC unroll 16")
+#else
+#define ULINALG_ALWAYS_INLINE inline
+#define ULINALG_UNROLL
+#endif
+
+// The generic helpers pass vectors by value but are always inlined into a
+// wrapper of matching width, so GCC's ABI notes about them don't apply
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace simd_detail {
+
+#ifdef ULINALG_SIMD_X86
+typedef double v2d __attribute__((vector_size(16)));
+typedef double v4d __attribute__((vector_size(32)));
+typedef double v8d __attribute__((vector_size(64)));
+typedef float v4f __attribute__((vector_size(16)));
+typedef float v8f __attribute__((vector_size(32)));
+typedef float v16f __attribute__((vector_size(64)));
+#endif
+
+// Kernels are written once, generically over V: either a plain double or
+// float (the scalar variant) or a vector of doubles or floats. They are always
+// inlined into a wrapper compiled for a given instruction set, which is what
+// decides the instructions they are lowered to.
+
+// The scalar type of V's lanes (V itself for the scalar variants)
+template <typename V> struct lane {
+  using type = V;
+};
+#ifdef ULINALG_SIMD_X86
+template <> struct lane<v2d> {
+  using type = double;
+};
+template <> struct lane<v4d> {
+  using type = double;
+};
+template <> struct lane<v8d> {
+  using type = double;
+};
+template <> struct lane<v4f> {
+  using type = float;
+};
+template <> struct lane<v8f> {
+  using type = float;
+};
+template <> struct lane<v16f> {
+  using type = float;
+};
+#endif
+
+template <typename V, typename S>
+ULINALG_ALWAYS_INLINE V load(const S *p) {
+  V v;
+  std::memcpy(&v, p, sizeof(V));
+  return v;
+}
+
+template <typename V, typename S>
+ULINALG_ALWAYS_INLINE void store(S *p, const V &v) {
+  std::memcpy(p, &v, sizeof(V));
+}
+
+template <typename V> ULINALG_ALWAYS_INLINE V splat(double x) {
+  return V{} + static_cast<typename lane<V>::type>(x);
+}
+
+} // namespace simd_detail
+
+#endif
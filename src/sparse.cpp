@@ -0,0 +1,293 @@
+#include "sparse.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+#include "simd.hpp"
+#include "simd_detail.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace simd_detail;
+
+// Products with fewer multiply-adds than this stay on the calling thread
+constexpr double PARALLEL_WORK = 1 << 15;
+
+// Row chunks per thread, so that uneven rows still balance
+constexpr int TASKS_PER_THREAD = 4;
+
+// y = A x, for the rows of A in a task's range
+struct Product {
+  const std::size_t *row_ptr;
+  const int *col_idx;
+  const double *vals;
+  const double *x;
+  std::ptrdiff_t rs, cs; // strides of x
+  int k;                 // columns of x and y
+  double *y;             // row-major, rows of k
+};
+
+// y[0:k] += a * x[0:k]
+template <typename V, int W>
+ULINALG_ALWAYS_INLINE void axpy(int k, double a, const double *x, double *y) {
+  V av = splat<V>(a);
+  int j = 0;
+  for (; j + W <= k; j += W) {
+    store(y + j, load<V>(y + j) + av * load<V>(x + j));
+  }
+  for (; j < k; ++j) {
+    y[j] += a * x[j];
+  }
+}
+
+template <typename V, int W>
+ULINALG_ALWAYS_INLINE void rows_variant(const Product &p, int r0, int r1) {
+  if (p.k == 1) {
+    // SpMV: a dot product per row, over four accumulators so consecutive
+    // multiply-adds don't wait on each other
+    for (int i = r0; i < r1; ++i) {
+      std::size_t q = p.row_ptr[i], end = p.row_ptr[i + 1];
+      double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      for (; q + 4 <= end; q += 4) {
+        s0 += p.vals[q] * p.x[p.col_idx[q] * p.rs];
+        s1 += p.vals[q + 1] * p.x[p.col_idx[q + 1] * p.rs];
+        s2 += p.vals[q + 2] * p.x[p.col_idx[q + 2] * p.rs];
+        s3 += p.vals[q + 3] * p.x[p.col_idx[q + 3] * p.rs];
+      }
+      for (; q < end; ++q) {
+        s0 += p.vals[q] * p.x[p.col_idx[q] * p.rs];
+      }
+      p.y[i] = (s0 + s1) + (s2 + s3);
+    }
+    return;
+  }
+
+  // SpMM: each nonzero scales a row of x into the row of y, a vector at a
+  // time when x's rows are contiguous
+  for (int i = r0; i < r1; ++i) {
+    double *y_i = p.y + static_cast<std::ptrdiff_t>(i) * p.k;
+    std::fill(y_i, y_i + p.k, 0.0);
+    for (std::size_t q = p.row_ptr[i]; q < p.row_ptr[i + 1]; ++q) {
+      const double *x_j = p.x + p.col_idx[q] * p.rs;
+      if (p.cs == 1) {
+        axpy<V, W>(p.k, p.vals[q], x_j, y_i);
+      } else {
+        for (int j = 0; j < p.k; ++j) {
+          y_i[j] += p.vals[q] * x_j[j * p.cs];
+        }
+      }
+    }
+  }
+}
+
+void rows_scalar(const Product &p, int r0, int r1) {
+  rows_variant<double, 1>(p, r0, r1);
+}
+
+#ifdef ULINALG_SIMD_X86
+__attribute__((target("sse2"))) void rows_sse2(const Product &p, int r0,
+                                               int r1) {
+  rows_variant<v2d, 2>(p, r0, r1);
+}
+
+__attribute__((target("avx2"))) void rows_avx2(const Product &p, int r0,
+                                               int r1) {
+  rows_variant<v4d, 4>(p, r0, r1);
+}
+
+__attribute__((target("avx512f"))) void rows_avx512(const Product &p, int r0,
+                                                   int r1) {
+  rows_variant<v8d, 8>(p, r0, r1);
+}
+#endif
+
+void rows(simd::Isa isa, const Product &p, int r0, int r1) {
+  switch (isa) {
+#ifdef ULINALG_SIMD_X86
+  case simd::Isa::avx512:
+    rows_avx512(p, r0, r1);
+    return;
+  case simd::Isa::avx2:
+    rows_avx2(p, r0, r1);
+    return;
+  case simd::Isa::sse2:
+    rows_sse2(p, r0, r1);
+    return;
+#endif
+  default:
+    rows_scalar(p, r0, r1);
+  }
+}
+
+// The first row at which (nonzeros + rows) before it reaches target
+int row_at(const std::size_t *row_ptr, int nrow, double target) {
+  int lo = 0, hi = nrow;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (static_cast<double>(row_ptr[mid] + mid) < target) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+} // namespace
+
+SparseArray::SparseArray(int nrows, int ncols)
+    : nrow(nrows), ncol(ncols), row_ptr(static_cast<std::size_t>(nrows) + 1) {
+  if (nrows < 0 || ncols < 0) {
+    throw std::invalid_argument("Dimensions must be non-negative");
+  }
+}
+
+SparseArray::SparseArray(int nrows, int ncols,
+                         const std::vector<Triplet> &entries)
+    : SparseArray(nrows, ncols) {
+  for (const Triplet &e : entries) {
+    if (e.row < 0 || e.row >= nrow || e.col < 0 || e.col >= ncol) {
+      throw std::out_of_range("Entry index out of range");
+    }
+  }
+
+  // Sort by (row, col), then sum each run of duplicates into one entry
+  std::vector<Triplet> sorted(entries);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Triplet &a, const Triplet &b) {
+              return a.row != b.row ? a.row < b.row : a.col < b.col;
+            });
+  col_idx.reserve(sorted.size());
+  vals.reserve(sorted.size());
+  for (std::size_t q = 0; q < sorted.size(); ++q) {
+    const Triplet &e = sorted[q];
+    if (q > 0 && e.row == sorted[q - 1].row && e.col == sorted[q - 1].col) {
+      vals.back() += e.value;
+    } else {
+      col_idx.push_back(e.col);
+      vals.push_back(e.value);
+      ++row_ptr[e.row + 1];
+    }
+  }
+  for (int i = 0; i < nrow; ++i) {
+    row_ptr[i + 1] += row_ptr[i];
+  }
+}
+
+SparseArray::SparseArray(const ConstArrayView &a, double drop_tol)
+    : SparseArray(a.get_nrow(), a.get_ncol()) {
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      double v = a(i, j);
+      if (std::abs(v) > drop_tol) {
+        col_idx.push_back(j);
+        vals.push_back(v);
+      }
+    }
+    row_ptr[i + 1] = vals.size();
+  }
+}
+
+int SparseArray::get_nrow() const { return nrow; }
+
+int SparseArray::get_ncol() const { return ncol; }
+
+std::size_t SparseArray::get_nnz() const { return vals.size(); }
+
+Span<const std::size_t> SparseArray::row_ptrs() const {
+  return Span<const std::size_t>(row_ptr.data(), row_ptr.size());
+}
+
+Span<const int> SparseArray::col_indices() const {
+  return Span<const int>(col_idx.data(), col_idx.size());
+}
+
+Span<const double> SparseArray::values() const {
+  return Span<const double>(vals.data(), vals.size());
+}
+
+Span<double> SparseArray::values() {
+  return Span<double>(vals.data(), vals.size());
+}
+
+double SparseArray::operator()(int i, int j) const {
+  if (i < 0 || i >= nrow || j < 0 || j >= ncol) {
+    throw std::out_of_range("Index out of range");
+  }
+  auto first = col_idx.begin() + row_ptr[i];
+  auto last = col_idx.begin() + row_ptr[i + 1];
+  auto it = std::lower_bound(first, last, j);
+  return (it != last && *it == j) ? vals[it - col_idx.begin()] : 0.0;
+}
+
+Array SparseArray::to_dense() const {
+  Array res(nrow, ncol);
+  for (int i = 0; i < nrow; ++i) {
+    double *res_i = res[i];
+    for (std::size_t q = row_ptr[i]; q < row_ptr[i + 1]; ++q) {
+      res_i[col_idx[q]] = vals[q];
+    }
+  }
+  return res;
+}
+
+Array SparseArray::mult(const ConstArrayView &x) const {
+  return ::mult(*this, x);
+}
+
+Array mult(const SparseArray &A, const ConstArrayView &x) {
+  if (A.get_ncol() != x.get_nrow()) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
+  }
+  Array res(A.get_nrow(), x.get_ncol());
+  mult(res, A, x);
+  return res;
+}
+
+void mult(Array &out, const SparseArray &A, const ConstArrayView &x) {
+  int nrow = A.get_nrow();
+  int k = x.get_ncol();
+  if (A.get_ncol() != x.get_nrow()) {
+    throw std::invalid_argument("Dimensions prohibit matrix multiplication");
+  }
+  if (out.get_nrow() != nrow || out.get_ncol() != k) {
+    throw std::invalid_argument("Output dimensions incompatible");
+  }
+  Span<double> y = out.span();
+  if (x.get_nrow() > 0 && k > 0) {
+    const double *first = x.data();
+    const double *last = first + (x.get_nrow() - 1) * x.row_stride() +
+                         (k - 1) * x.col_stride();
+    if (std::min(first, last) < y.end() && std::max(first, last) >= y.begin()) {
+      throw std::invalid_argument("Output overlaps an input of mult");
+    }
+  }
+  double nnz = static_cast<double>(A.get_nnz());
+  ULINALG_PROFILE_SCOPE(profile::Op::sparse_mult, nrow, k, 2.0 * nnz * k,
+                        12.0 * nnz + 8.0 * (nrow + 1) +
+                            8.0 * x.get_nrow() * k + 8.0 * nrow * k);
+
+  Product p{A.row_ptrs().data(), A.col_indices().data(), A.values().data(),
+            x.data(),           x.row_stride(),         x.col_stride(),
+            k,                  y.data()};
+  simd::Isa isa = simd::get_isa();
+
+  // Split the rows into chunks of about equal nonzeros plus rows
+  int n_tasks = 1;
+  if (nnz * k >= PARALLEL_WORK && parallel::get_num_threads() > 1) {
+    n_tasks = std::min(nrow, TASKS_PER_THREAD * parallel::get_num_threads());
+  }
+  if (n_tasks <= 1) {
+    rows(isa, p, 0, nrow);
+    return;
+  }
+  double cost = nnz + nrow;
+  parallel::parallel_for(n_tasks, [&](int t) {
+    int r0 = row_at(p.row_ptr, nrow, cost * t / n_tasks);
+    int r1 = row_at(p.row_ptr, nrow, cost * (t + 1) / n_tasks);
+    rows(isa, p, r0, r1);
+  });
+}
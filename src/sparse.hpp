@@ -0,0 +1,68 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include "array.hpp"
+#include "array_view.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A nonzero entry (row, col, value) of a sparse matrix
+struct Triplet {
+  int row, col;
+  double value;
+};
+
+// Sparse matrices in compressed sparse row (CSR) form: the nonzeros of row i
+// are values()[p] in columns col_indices()[p], for p in
+// [row_ptrs()[i], row_ptrs()[i + 1]), with columns increasing along each row.
+// Only the nonzeros are stored, and dense Arrays (or views) are the vectors
+// they multiply.
+class SparseArray {
+private:
+  int nrow, ncol;
+  std::vector<std::size_t> row_ptr;
+  std::vector<int> col_idx;
+  std::vector<double> vals;
+
+public:
+  // An all-zero nrows x ncols matrix
+  SparseArray(int nrows, int ncols);
+
+  // From (row, col, value) entries in any order; duplicates are summed.
+  // Throws std::out_of_range if an entry lies outside nrows x ncols.
+  SparseArray(int nrows, int ncols, const std::vector<Triplet> &);
+
+  // The entries of a dense matrix with magnitude above drop_tol
+  explicit SparseArray(const ConstArrayView &, double drop_tol = 0.0);
+
+  int get_nrow() const;
+  int get_ncol() const;
+  std::size_t get_nnz() const;
+
+  // The CSR arrays (see above)
+  Span<const std::size_t> row_ptrs() const;
+  Span<const int> col_indices() const;
+  Span<const double> values() const;
+  Span<double> values();
+
+  // Entry (i, j), zero if it isn't stored
+  double operator()(int i, int j) const;
+
+  Array to_dense() const;
+
+  // Sparse x dense product (see the free mult)
+  Array mult(const ConstArrayView &) const;
+};
+
+// Sparse x dense matrix multiplication (SpMV when x is a vector, SpMM when it
+// has several columns). x may be any view, e.g. a column of an Array. Rows
+// are split across parallel::get_num_threads() threads in chunks of similar
+// numbers of nonzeros.
+Array mult(const SparseArray &, const ConstArrayView &x);
+
+// Sparse x dense multiplication into out, which must already have the
+// product's shape and must not overlap x
+void mult(Array &out, const SparseArray &, const ConstArrayView &x);
+
+#endif
@@ -1,4 +1,7 @@
 #include "../src/array.hpp"
+#include "../src/kernels.hpp"
+#include "../src/memory.hpp"
+#include "../src/parallel.hpp"
 
 #include <catch2/catch_test_macros.hpp>
 #include <cstddef>
@@ -344,3 +347,312 @@ TEST_CASE("Array::eye() works for Nx1 matrix", "[array][eye]") {
   std::vector<double> expected = {1, 0, 0, 0};
   REQUIRE(arr.get_vals() == expected);
 }
+
+TEST_CASE("Packed matrix multiplication matches the naive kernel",
+          "[array][mult]") {
+  // sizes straddle the micro-tile and cache-block edges of kernels::gemm
+  std::vector<int> dims = {1, 5, 33, 131, 300};
+  for (int m : dims) {
+    for (int k : {3, 67, 257}) {
+      int n = (m * 7) % 90 + 1;
+
+      // integer-valued entries keep every partial sum exact
+      Array A(m, k);
+      Array B(k, n);
+      for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < k; ++j) {
+          A[i][j] = (i * 7 + j * 3) % 11 - 5;
+        }
+      }
+      for (int i = 0; i < k; ++i) {
+        for (int j = 0; j < n; ++j) {
+          B[i][j] = (i * 5 + j * 2) % 13 - 6;
+        }
+      }
+
+      Array naive(m, n);
+      naive.set_zeros();
+      for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+          for (int p = 0; p < k; ++p) {
+            naive[i][j] += A[i][p] * B[p][j];
+          }
+        }
+      }
+
+      Array C = A.mult(B);
+      REQUIRE(C.get_nrow() == m);
+      REQUIRE(C.get_ncol() == n);
+      REQUIRE(C.get_vals() == naive.get_vals());
+    }
+  }
+}
+
+TEST_CASE("Multithreaded matrix multiplication matches a single thread",
+          "[array][mult][parallel]") {
+  int m = 301;
+  int k = 203;
+  int n = 517;
+  Array A(m, k);
+  Array B(k, n);
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < k; ++j) {
+      A[i][j] = (i * 3 + j * 5) % 17 - 8;
+    }
+  }
+  for (int i = 0; i < k; ++i) {
+    for (int j = 0; j < n; ++j) {
+      B[i][j] = (i * 11 + j) % 7 - 3;
+    }
+  }
+
+  parallel::set_num_threads(1);
+  Array C_serial = A.mult(B);
+
+  for (int n_threads : {2, 3, 8}) {
+    parallel::set_num_threads(n_threads);
+    Array C = A.mult(B);
+    REQUIRE(C.get_vals() == C_serial.get_vals());
+  }
+  parallel::set_num_threads(0);
+}
+
+TEST_CASE("Chained elementwise expressions match step-by-step evaluation",
+          "[array][expr]") {
+  std::vector<double> a_vals = {1, 2, 3, 4, 5, 6};
+  std::vector<double> b_vals = {2, 4, 6, 8, 10, 12};
+  std::vector<double> c_vals = {3, 1, 4, 1, 5, 9};
+  std::vector<double> d_vals = {2, 7, 1, 8, 2, 8};
+  Array a(a_vals, 2, 3);
+  Array b(b_vals, 2, 3);
+  Array c(c_vals, 2, 3);
+  Array d(d_vals, 2, 3);
+  Array e(std::vector<double>{1, 2, 3}, 1, 3);
+
+  Array fused = a * b + c / d - e;
+
+  Array ab = a * b;
+  Array cd = c / d;
+  Array sum = ab + cd;
+  Array stepwise = sum - e;
+  REQUIRE(fused.get_nrow() == 2);
+  REQUIRE(fused.get_ncol() == 3);
+  REQUIRE(fused.get_vals() == stepwise.get_vals());
+}
+
+TEST_CASE("Expressions broadcast through nested operations", "[array][expr]") {
+  Array row(std::vector<double>{1, 2, 3}, 1, 3);
+  Array col(std::vector<double>{10, 20}, 2, 1);
+  Array scalar(std::vector<double>{2}, 1, 1);
+
+  Array out = (row + col) * scalar;
+  std::vector<double> vals_true = {22, 24, 26, 42, 44, 46};
+  REQUIRE(out.get_vals() == vals_true);
+
+  // Shapes are checked as soon as the expression is built
+  Array bad(2, 2);
+  REQUIRE_THROWS_AS(row + bad, std::invalid_argument);
+}
+
+TEST_CASE("Assigning an expression into one of its operands", "[array][expr]") {
+  Array a(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  Array b(std::vector<double>{1, 1, 1, 1}, 2, 2);
+
+  // Same shape: written in place
+  a = a + b * a;
+  std::vector<double> a_true = {2, 4, 6, 8};
+  REQUIRE(a.get_vals() == a_true);
+
+  // Shape grows through broadcasting: the result is reallocated
+  Array s(std::vector<double>{1}, 1, 1);
+  s = s + a;
+  REQUIRE(s.get_nrow() == 2);
+  REQUIRE(s.get_ncol() == 2);
+  std::vector<double> s_true = {3, 5, 7, 9};
+  REQUIRE(s.get_vals() == s_true);
+}
+
+TEST_CASE("Scalars enter expressions on either side", "[array][expr]") {
+  Array a(std::vector<double>{1, 2, 3, 4}, 2, 2);
+
+  Array b = 2.0 * a + 1;
+  REQUIRE(b.get_vals() == std::vector<double>({3, 5, 7, 9}));
+  Array c = 12 / a - a / 2.0;
+  REQUIRE(c.get_vals() == std::vector<double>({11.5, 5, 2.5, 1}));
+}
+
+TEST_CASE("Compound assignment updates in place", "[array][expr]") {
+  Array a(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  Array row(std::vector<double>{1, 2}, 1, 2);
+  const double *data = a.span().data();
+
+  a += row;
+  a *= 2.0;
+  a /= row + 1;
+  a -= 1;
+  REQUIRE(a.span().data() == data);
+  REQUIRE(a.get_vals() == std::vector<double>({1, 8.0 / 3 - 1, 3, 3}));
+
+  // A view into the left-hand side is read before it is overwritten
+  a -= a.t();
+  REQUIRE(a.get_vals() ==
+          std::vector<double>({0, 8.0 / 3 - 1 - 3, 3 - (8.0 / 3 - 1), 0}));
+
+  // The left-hand side can't grow through broadcasting
+  REQUIRE_THROWS_AS(row += a, std::invalid_argument);
+}
+
+TEST_CASE("Output-parameter operations run without allocating",
+          "[array][expr]") {
+  Array x(std::vector<double>{1, 2, 3, 4, 5, 6}, 3, 2);
+  Array A(std::vector<double>{2, 0, 1, 1, 0, 3, 1, 0, 0}, 3, 3);
+  Array w(std::vector<double>{2, 4}, 1, 2);
+  Array y(3, 2), z(3, 2);
+
+  memory::reset_counters();
+  for (int it = 0; it < 10; ++it) {
+    mult(y, A, x);
+    add(z, y, 1.0);
+    subtract(z, z, x);
+    multiply(z, z, 0.5);
+    divide(x, z, w);
+    x *= 2;
+  }
+  REQUIRE(memory::get_counters().allocations == 0);
+
+  Array x_ref(std::vector<double>{1, 2, 3, 4, 5, 6}, 3, 2);
+  for (int it = 0; it < 10; ++it) {
+    Array y_ref = A.mult(x_ref);
+    Array z_ref = (y_ref + 1.0 - x_ref) * 0.5;
+    x_ref = z_ref / w;
+    x_ref = x_ref * 2;
+  }
+  REQUIRE(x.get_vals() == x_ref.get_vals());
+
+  Array small(2, 2);
+  REQUIRE_THROWS_AS(add(small, x, x), std::invalid_argument);
+  REQUIRE_THROWS_AS(add(y, x, Array(1, 3)), std::invalid_argument);
+  REQUIRE_THROWS_AS(mult(y, A, y), std::invalid_argument);
+  REQUIRE_THROWS_AS(mult(z, A, x.t()), std::invalid_argument);
+}
+
+TEST_CASE("Broadcasting rejects incompatible shapes", "[array][bcast]") {
+  Array y(2, 3);
+  REQUIRE_THROWS_AS(array_detail::bcast(y, 4, 3), std::invalid_argument);
+  REQUIRE_THROWS_AS(array_detail::bcast(y, 2, 6), std::invalid_argument);
+}
+
+TEST_CASE("Broadcast cases agree with elementwise reference on wide rows",
+          "[array][bcast]") {
+  // wider than one evaluation block, so rows are processed in chunks
+  int nrow = 3;
+  int ncol = 600;
+  Array m(nrow, ncol);
+  Array row(1, ncol);
+  Array col(nrow, 1);
+  Array scalar(std::vector<double>{0.5}, 1, 1);
+  for (int j = 0; j < ncol; ++j) {
+    row[0][j] = j % 7;
+    for (int i = 0; i < nrow; ++i) {
+      m[i][j] = i * ncol + j;
+    }
+  }
+  for (int i = 0; i < nrow; ++i) {
+    col[i][0] = i + 1;
+  }
+
+  // col * col is itself a column vector, broadcast along each row
+  Array out = (m - row) / (col * col) + scalar * row;
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      double expected = (m[i][j] - row[0][j]) / (col[i][0] * col[i][0]) +
+                        0.5 * row[0][j];
+      REQUIRE(out[i][j] == expected);
+    }
+  }
+}
+
+TEST_CASE("Single precision gemm matches the double kernel",
+          "[array][mult]") {
+  // integer-valued entries keep every partial sum exact in float too
+  int m = 131, k = 257, n = 75;
+  std::vector<double> A(m * k), B(k * n), C(m * n);
+  std::vector<float> Af(m * k), Bf(k * n), Cf(m * n);
+  for (int i = 0; i < m * k; ++i) {
+    Af[i] = A[i] = (i * 7) % 11 - 5;
+  }
+  for (int i = 0; i < k * n; ++i) {
+    Bf[i] = B[i] = (i * 5) % 13 - 6;
+  }
+  kernels::gemm(m, n, k, 1.0, A.data(), k, 1, B.data(), n, 1, 0.0, C.data(),
+                n);
+  kernels::gemm(m, n, k, 1.0f, Af.data(), k, 1, Bf.data(), n, 1, 0.0f,
+                Cf.data(), n);
+  REQUIRE(std::vector<double>(Cf.begin(), Cf.end()) == C);
+}
+
+TEST_CASE("Float arrays convert to and from double and multiply",
+          "[array][mult][float]") {
+  std::vector<double> vals = {1, 2, 3, 4, 5, 6};
+  Array A(vals, 2, 3);
+  BasicArray<float> Af(A);
+  REQUIRE(Af.get_nrow() == 2);
+  REQUIRE(Af.get_ncol() == 3);
+  REQUIRE(Af.get_vals() == std::vector<float>{1, 2, 3, 4, 5, 6});
+  REQUIRE(Array(Af).get_vals() == vals);
+
+  // small integers are exact in float, so the products match exactly
+  BasicArray<float> Cf = Af.mult(Af.t());
+  Array C = A.mult(A.t());
+  REQUIRE(Cf.get_nrow() == 2);
+  REQUIRE(Cf.get_ncol() == 2);
+  REQUIRE(Array(Cf).get_vals() == C.get_vals());
+
+  BasicArray<float> out(2, 2);
+  mult(out, Af.view(), Af.t());
+  REQUIRE(out.get_vals() == Cf.get_vals());
+}
+
+TEST_CASE("Float elementwise expressions match double evaluation",
+          "[array][expr][float]") {
+  // Quarter-integers stay exact in float through these operations
+  int m = 7, n = 300;
+  Array a(m, n), b(m, n), row(1, n), col(m, 1);
+  for (int i = 0; i < m; ++i) {
+    col[i][0] = 1 << (i % 3); // exact divisors
+    for (int j = 0; j < n; ++j) {
+      a[i][j] = 0.25 * ((i * n + j) % 37) - 4;
+      b[i][j] = 0.5 * ((i + 3 * j) % 11) + 1;
+      row[0][j] = j % 5 + 1;
+    }
+  }
+  BasicArray<float> af(a), bf(b), rowf(row), colf(col);
+
+  BasicArray<float> cf = (af + bf * rowf) / colf - 0.5f;
+  Array c = (a + b * row) / col - 0.5;
+  REQUIRE(Array(cf).get_vals() == c.get_vals());
+
+  // Transposed views are gathered, as for double
+  BasicArray<float> square(n, n);
+  square.set_ones();
+  BasicArray<float> tf = 2 * square.t() + square.row(0);
+  REQUIRE(tf.get_vals() == std::vector<float>(n * n, 3.0f));
+
+  // Compound assignment and output parameters, in place
+  BasicArray<float> df(af);
+  Array d(a);
+  df += bf;
+  df *= 2.0f;
+  df -= rowf;
+  df /= colf;
+  d += b;
+  d *= 2.0;
+  d -= row;
+  d /= col;
+  REQUIRE(Array(df).get_vals() == d.get_vals());
+
+  BasicArray<float> out(m, n);
+  add(out, af, bf);
+  multiply(out, out, rowf);
+  REQUIRE(Array(out).get_vals() == Array((a + b) * row).get_vals());
+}
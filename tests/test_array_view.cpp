@@ -0,0 +1,154 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+namespace {
+
+// 3x4 array with a[i][j] = 10 * i + j
+Array make_grid() {
+  Array a(3, 4);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      a[i][j] = 10 * i + j;
+    }
+  }
+  return a;
+}
+
+} // namespace
+
+TEST_CASE("Views slice rows, columns, blocks and transposes", "[view]") {
+  Array a = make_grid();
+
+  ConstArrayView r = a.row(1);
+  REQUIRE(r.get_nrow() == 1);
+  REQUIRE(r.get_ncol() == 4);
+  REQUIRE(r(0, 2) == 12);
+
+  ConstArrayView c = a.col(3);
+  REQUIRE(c.get_nrow() == 3);
+  REQUIRE(c.get_ncol() == 1);
+  REQUIRE(c(2, 0) == 23);
+
+  ConstArrayView b = a.block(1, 1, 2, 3);
+  REQUIRE(b(0, 0) == 11);
+  REQUIRE(b(1, 2) == 23);
+  REQUIRE_FALSE(b.is_contiguous());
+  REQUIRE(a.view().is_contiguous());
+
+  ConstArrayView t = a.t();
+  REQUIRE(t.get_nrow() == 4);
+  REQUIRE(t.get_ncol() == 3);
+  REQUIRE(t(3, 1) == 13);
+
+  // slices of slices
+  REQUIRE(a.t().block(1, 1, 2, 2)(1, 0) == 12);
+
+  REQUIRE_THROWS_AS(a.row(3), std::out_of_range);
+  REQUIRE_THROWS_AS(a.block(2, 2, 2, 2), std::out_of_range);
+}
+
+TEST_CASE("Views write through to the Array and span avoids copies",
+          "[view]") {
+  Array a = make_grid();
+  ArrayView col = a.col(0);
+  col(2, 0) = -1;
+  REQUIRE(a[2][0] == -1);
+
+  Span<double> s = a.span();
+  REQUIRE(s.size() == 12);
+  REQUIRE(s.data() == a[0]);
+  s[1] = 100;
+  REQUIRE(a[0][1] == 100);
+
+  const Array &ca = a;
+  Span<const double> cs = ca.span();
+  REQUIRE(cs[1] == 100);
+}
+
+TEST_CASE("Matrix multiplication accepts views", "[view][mult]") {
+  Array a = make_grid();
+
+  // a^T a, computed from the transposed view and from an explicit transpose
+  Array at(a.t());
+  Array expected = at.mult(a);
+  Array res = mult(a.t(), a);
+  REQUIRE(res.get_vals() == expected.get_vals());
+
+  // block @ column
+  Array blk(a.block(0, 1, 2, 2));
+  Array cl(a.col(0).block(0, 0, 2, 1));
+  Array expected_blk = blk.mult(cl);
+  Array res_blk = mult(a.block(0, 1, 2, 2), a.col(0).block(0, 0, 2, 1));
+  REQUIRE(res_blk.get_vals() == expected_blk.get_vals());
+
+  Array res_member = a.mult(a.t());
+  REQUIRE(res_member.get_nrow() == 3);
+  REQUIRE(res_member[1][2] == 10 * 20 + 11 * 21 + 12 * 22 + 13 * 23);
+}
+
+TEST_CASE("Elementwise operators accept views", "[view][expr]") {
+  Array a = make_grid();
+
+  // a row view broadcast against a block
+  Array out = a.block(1, 0, 2, 4) - a.row(0);
+  std::vector<double> expected = {10, 10, 10, 10, 20, 20, 20, 20};
+  REQUIRE(out.get_vals() == expected);
+
+  // a transposed (strided) view against an Array
+  Array sq(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  Array sum = sq + sq.t();
+  std::vector<double> sum_true = {2, 5, 5, 8};
+  REQUIRE(sum.get_vals() == sum_true);
+
+  // assigning into an Array that a view operand points into
+  Array m(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  m = m + m.row(0);
+  std::vector<double> m_true = {2, 4, 4, 6};
+  REQUIRE(m.get_vals() == m_true);
+
+  m = m * m.t();
+  std::vector<double> mt_true = {4, 16, 16, 36};
+  REQUIRE(m.get_vals() == mt_true);
+}
+
+TEST_CASE("Decompositions factor and solve from views", "[view][LUDecomp]") {
+  // the 4x4 system from test_decomp, embedded in a larger array
+  std::vector<double> vals = {2, 1, 1, 0, 4, 3, 3, 1, 8, 7, 9, 5, 6, 7, 9, 8};
+  Array big(6, 6);
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      big[i + 1][j + 2] = vals[i * 4 + j];
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    big[i + 1][0] = i + 1;
+  }
+
+  LUDecomp LU(big.block(1, 2, 4, 4));
+  LU.decompose();
+  Array x = LU.solve(big.block(1, 0, 4, 1));
+  std::vector<double> x_true = {1.0, 0.5, -1.5, 1.0};
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE_THAT(x[i][0], WithinAbs(x_true[i], 1e-6));
+  }
+
+  Array spd(std::vector<double>{4, 6, 2, 6, 13, 5, 2, 5, 6}, 3, 3);
+  Cholesky chol(spd.t());
+  chol.decompose();
+  Array ones(3, 1);
+  ones.set_ones();
+  Array y = chol.solve(ones.view());
+  std::vector<double> y_true = {0.484375, -0.21875, 0.1875};
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE_THAT(y[i][0], WithinAbs(y_true[i], 1e-6));
+  }
+
+  REQUIRE_THROWS_AS(LUDecomp(big.block(0, 0, 2, 3)), std::invalid_argument);
+}
@@ -0,0 +1,188 @@
+#include "../src/array.hpp"
+#include "../src/banded.hpp"
+#include "../src/decomp.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+namespace {
+
+// n x n band with kl and ku off-diagonals, entries from a fixed pattern; the
+// diagonal is scaled by diag_scale (small values force row swaps in LU)
+BandedArray make_band(int n, int kl, int ku, double diag_scale) {
+  BandedArray A(n, kl, ku);
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + ku); ++j) {
+      A.set(i, j, std::sin(1.0 + 0.7 * i + 1.9 * j));
+    }
+    A.set(i, i, diag_scale * (2.0 + std::cos(0.3 * i)));
+  }
+  return A;
+}
+
+Array make_rhs(int n, int k) {
+  Array b(n, k);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < k; ++j) {
+      b[i][j] = std::cos(0.5 * i + j);
+    }
+  }
+  return b;
+}
+
+void require_close(const Array &x, const Array &y, double tol) {
+  REQUIRE(x.get_nrow() == y.get_nrow());
+  REQUIRE(x.get_ncol() == y.get_ncol());
+  std::vector<double> xv = x.get_vals(), yv = y.get_vals();
+  for (std::size_t i = 0; i < xv.size(); ++i) {
+    REQUIRE_THAT(xv[i], WithinAbs(yv[i], tol));
+  }
+}
+
+} // namespace
+
+TEST_CASE("Banded arrays store only the band", "[banded]") {
+  BandedArray A(4, 1, 2);
+  A.set(0, 2, 3.0);
+  A.set(3, 2, 4.0);
+  REQUIRE(A(0, 2) == 3.0);
+  REQUIRE(A(3, 0) == 0.0);
+  REQUIRE_THROWS_AS(A.set(3, 0, 1.0), std::out_of_range);
+  REQUIRE_THROWS_AS(A(4, 0), std::out_of_range);
+
+  Array dense = make_band(6, 2, 1, 1.0).to_dense();
+  BandedArray B(dense.view(), 2, 1);
+  require_close(B.to_dense(), dense, 0.0);
+  REQUIRE(dense[0][2] == 0.0);
+  REQUIRE(dense[3][0] == 0.0);
+
+  Array x = make_rhs(6, 2);
+  require_close(B.mult(x), dense.mult(x), 1e-14);
+}
+
+TEST_CASE("Banded LU matches dense LU", "[banded]") {
+  // A small diagonal makes most steps swap rows (when there are rows below)
+  for (double diag_scale : {1.0, 0.01}) {
+    for (int kl : {0, 1, 3}) {
+      for (int ku : {0, 2}) {
+        if ((kl == 0 || ku == 0) && diag_scale < 1.0) {
+          continue; // triangular: the determinant is below the pivot tol
+        }
+        BandedArray A = make_band(40, kl, ku, diag_scale);
+        Array dense = A.to_dense();
+        Array b = make_rhs(40, 3);
+
+        BandedLUDecomp banded(A);
+        banded.decompose();
+        LUDecomp LU(dense.view());
+        LU.decompose();
+        Array x = banded.solve(b);
+        require_close(x, LU.solve(b), 1e-8);
+        require_close(dense.mult(x), b, 1e-9);
+      }
+    }
+  }
+
+  BandedArray singular(3, 1, 1);
+  singular.set(0, 0, 1.0);
+  singular.set(1, 1, 1.0);
+  BandedLUDecomp LU(singular);
+  REQUIRE_THROWS_AS(LU.decompose(), std::runtime_error);
+}
+
+TEST_CASE("Banded Cholesky matches dense Cholesky", "[banded]") {
+  int n = 30, kd = 3;
+  BandedArray A(n, kd, kd);
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - kd); j < i; ++j) {
+      A.set(i, j, std::sin(0.3 * i + 1.1 * j));
+      A.set(j, i, A(i, j));
+    }
+    A.set(i, i, 2.0 * kd + 1.0);
+  }
+  Array dense = A.to_dense();
+  Array b = make_rhs(n, 2);
+
+  BandedCholesky banded(A);
+  banded.decompose();
+  Cholesky chol(dense.view());
+  chol.decompose();
+  require_close(banded.solve(b), chol.solve(b), 1e-10);
+
+  BandedArray indefinite(2, 1, 1);
+  indefinite.set(0, 0, 1.0);
+  indefinite.set(1, 1, 1.0);
+  indefinite.set(0, 1, 2.0);
+  indefinite.set(1, 0, 2.0);
+  BandedCholesky bad(indefinite);
+  REQUIRE_THROWS_AS(bad.decompose(), std::runtime_error);
+  REQUIRE_THROWS_AS(BandedCholesky(BandedArray(3, 1, 2)),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Tridiagonal solves match dense LU", "[banded]") {
+  int n = 50;
+  std::vector<double> lower(n - 1), diag(n), upper(n - 1);
+  BandedArray A(n, 1, 1);
+  for (int i = 0; i < n; ++i) {
+    diag[i] = 4.0 + std::sin(i);
+    A.set(i, i, diag[i]);
+    if (i + 1 < n) {
+      lower[i] = -1.0 + 0.1 * std::cos(i);
+      upper[i] = -1.5;
+      A.set(i + 1, i, lower[i]);
+      A.set(i, i + 1, upper[i]);
+    }
+  }
+  Array dense = A.to_dense();
+  Array b = make_rhs(n, 2);
+  LUDecomp LU(dense.view());
+  LU.decompose();
+  Array expected = LU.solve(b);
+
+  TridiagonalDecomp from_vectors(lower, diag, upper);
+  from_vectors.decompose();
+  require_close(from_vectors.solve(b), expected, 1e-10);
+
+  TridiagonalDecomp from_band(A);
+  from_band.decompose();
+  require_close(from_band.solve(b.view()), expected, 1e-10);
+
+  REQUIRE_THROWS_AS(TridiagonalDecomp(lower, diag, diag),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(TridiagonalDecomp(BandedArray(3, 2, 1)),
+                    std::invalid_argument);
+  Array wrong(n + 1, 1);
+  REQUIRE_THROWS_AS(from_band.solve(wrong), std::invalid_argument);
+}
+
+TEST_CASE("Banded solves throw before decompose", "[banded]") {
+  BandedArray A = make_band(5, 1, 1, 4.0);
+  Array b = make_rhs(5, 1);
+
+  BandedLUDecomp LU(A);
+  BandedCholesky chol(A);
+  TridiagonalDecomp thomas(A);
+  REQUIRE_THROWS_AS(LU.solve(b), std::logic_error);
+  REQUIRE_THROWS_AS(chol.solve(b.view()), std::logic_error);
+  REQUIRE_THROWS_AS(thomas.solve(b), std::logic_error);
+
+  // Solves are const, like LUDecomp's
+  LU.decompose();
+  thomas.decompose();
+  const BandedLUDecomp &const_LU = LU;
+  const TridiagonalDecomp &const_thomas = thomas;
+  require_close(const_LU.solve(b), const_thomas.solve(b), 1e-12);
+
+  // A failed decompose() leaves no factors to solve with
+  BandedArray singular(3, 1, 1);
+  singular.set(0, 0, 1.0);
+  TridiagonalDecomp bad(singular);
+  REQUIRE_THROWS_AS(bad.decompose(), std::runtime_error);
+  REQUIRE_THROWS_AS(bad.solve(make_rhs(3, 1)), std::logic_error);
+}
@@ -0,0 +1,226 @@
+#include "../src/array.hpp"
+#include "../src/batch.hpp"
+#include "../src/decomp.hpp"
+#include "../src/simd.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cfenv>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+namespace {
+
+std::vector<simd::Isa> supported_isas() {
+  std::vector<simd::Isa> isas;
+  for (simd::Isa isa : {simd::Isa::scalar, simd::Isa::sse2, simd::Isa::avx2,
+                        simd::Isa::avx512}) {
+    if (simd::supported(isa)) {
+      isas.push_back(isa);
+    }
+  }
+  return isas;
+}
+
+// Matrix b of a batch of well-conditioned, non-symmetric n x n matrices
+Array general(int b, int n) {
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = std::sin(0.37 * i * n + 1.3 * j + 0.71 * b);
+    }
+    A[i][i] += 2.0;
+  }
+  return A;
+}
+
+// Matrix b of a batch of symmetric positive definite n x n matrices
+Array spd(int b, int n) {
+  Array B = general(b, n);
+  Array A = B.mult(B.t());
+  for (int i = 0; i < n; ++i) {
+    A[i][i] += 1.0;
+  }
+  return A;
+}
+
+} // namespace
+
+TEST_CASE("Batch arrays store matrices interleaved", "[batch]") {
+  BatchArray batch(11, 2, 2);
+  REQUIRE(batch.get_count() == 11);
+  REQUIRE(batch.get_groups() == 2);
+
+  std::vector<double> vals = {1, 2, 3, 4};
+  batch.set(9, Array(vals, 2, 2));
+  REQUIRE(batch(9, 1, 0) == 3);
+  int lanes = BatchArray::LANES;
+  REQUIRE(batch.data()[(4 + 1 * 2 + 0) * lanes + 9 - lanes] == 3);
+  REQUIRE(batch.get(9).get_vals() == vals);
+  REQUIRE(batch.get(0).get_vals() == std::vector<double>(4, 0.0));
+
+  REQUIRE_THROWS_AS(batch.set(11, Array(vals, 2, 2)), std::out_of_range);
+  REQUIRE_THROWS_AS(batch.set(0, Array(vals, 4, 1)), std::invalid_argument);
+  REQUIRE_THROWS_AS(BatchLUDecomp(BatchArray(2, 2, 3)), std::invalid_argument);
+}
+
+TEST_CASE("Batched LU matches LUDecomp for every variant", "[batch][LU]") {
+  simd::Isa detected = simd::get_isa();
+
+  for (simd::Isa isa : supported_isas()) {
+    simd::set_isa(isa);
+    for (int n : {1, 3, 4, 7, 8, 9, 32}) {
+      for (int count : {1, 13, 1100}) {
+        BatchArray A(count, n, n);
+        BatchArray B(count, n, 2);
+        for (int b = 0; b < count; ++b) {
+          A.set(b, general(b, n));
+          for (int i = 0; i < n; ++i) {
+            B(b, i, 0) = 1.0;
+            B(b, i, 1) = std::cos(0.3 * i + b);
+          }
+        }
+
+        BatchLUDecomp LU(A);
+        LU.decompose();
+        BatchArray X = LU.solve(B);
+        REQUIRE(LU.get_info() == std::vector<int>(count, 0));
+
+        // Moved in right-hand sides are solved in place
+        BatchArray B_moved = B;
+        const double *storage = B_moved.data();
+        BatchArray X_moved = LU.solve(std::move(B_moved));
+        REQUIRE(X_moved.data() == storage);
+        REQUIRE(X_moved.get(count - 1).get_vals() ==
+                X.get(count - 1).get_vals());
+
+        // Spot check a few matrices against the unbatched class
+        for (int b : {0, count / 2, count - 1}) {
+          LUDecomp ref(A.get(b));
+          ref.decompose();
+          REQUIRE(LU.get_pivots(b) == ref.get_pivots());
+
+          std::vector<double> ref_vals = ref.get_vals();
+          std::vector<double> vals = LU.get_factors().get(b).get_vals();
+          for (std::size_t i = 0; i < vals.size(); ++i) {
+            REQUIRE_THAT(vals[i], WithinAbs(ref_vals[i], 1e-12));
+          }
+
+          Array x = ref.solve(B.get(b));
+          for (int i = 0; i < n; ++i) {
+            REQUIRE_THAT(X(b, i, 0), WithinAbs(x[i][0], 1e-10));
+          }
+          Array Ax = A.get(b).mult(X.get(b));
+          for (int i = 0; i < n; ++i) {
+            REQUIRE_THAT(Ax[i][1], WithinAbs(B(b, i, 1), 1e-10));
+          }
+        }
+      }
+    }
+  }
+
+  simd::set_isa(detected);
+}
+
+TEST_CASE("Batched Cholesky matches Cholesky for every variant",
+          "[batch][Cholesky]") {
+  simd::Isa detected = simd::get_isa();
+
+  for (simd::Isa isa : supported_isas()) {
+    simd::set_isa(isa);
+    for (int n : {1, 3, 4, 7, 32}) {
+      int count = 37;
+      BatchArray A(count, n, n);
+      BatchArray B(count, n, 1);
+      for (int b = 0; b < count; ++b) {
+        A.set(b, spd(b, n));
+        for (int i = 0; i < n; ++i) {
+          B(b, i, 0) = 1.0 + i;
+        }
+      }
+
+      BatchCholesky chol(A);
+      chol.decompose();
+      BatchArray X = chol.solve(B);
+      REQUIRE(chol.get_info() == std::vector<int>(count, 0));
+
+      for (int b = 0; b < count; ++b) {
+        Cholesky ref(A.get(b));
+        ref.decompose();
+        std::vector<double> ref_vals = ref.get_vals();
+        std::vector<double> vals = chol.get_factors().get(b).get_vals();
+        for (std::size_t i = 0; i < vals.size(); ++i) {
+          REQUIRE_THAT(vals[i], WithinAbs(ref_vals[i], 1e-12));
+        }
+
+        Array x = ref.solve(B.get(b));
+        for (int i = 0; i < n; ++i) {
+          REQUIRE_THAT(X(b, i, 0), WithinAbs(x[i][0], 1e-10));
+        }
+      }
+    }
+  }
+
+  simd::set_isa(detected);
+}
+
+TEST_CASE("Batched failures are reported per matrix", "[batch]") {
+  int n = 4;
+  int count = 10;
+  BatchArray A(count, n, n);
+  for (int b = 0; b < count; ++b) {
+    A.set(b, spd(b, n));
+  }
+  // Matrix 3 is singular (rank one); matrix 6 is indefinite
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A(3, i, j) = (i + 1.0) * (j + 1.0);
+    }
+  }
+  A(6, 2, 2) = -5.0;
+
+  BatchLUDecomp LU(A);
+  BatchCholesky chol(A);
+  BatchArray B(count, n, 1);
+  REQUIRE_THROWS_AS(LU.solve(B), std::logic_error);
+  REQUIRE_THROWS_AS(LU.get_pivots(0), std::logic_error);
+  REQUIRE_THROWS_AS(chol.solve(B), std::logic_error);
+
+  LU.decompose();
+  std::vector<int> info = LU.get_info();
+  for (int b = 0; b < count; ++b) {
+    if (b == 3) {
+      REQUIRE(info[b] == 2);
+    } else {
+      REQUIRE(info[b] == 0);
+    }
+  }
+
+  chol.decompose();
+  info = chol.get_info();
+  for (int b = 0; b < count; ++b) {
+    if (b == 3) {
+      REQUIRE(info[b] == 2);
+    } else if (b == 6) {
+      REQUIRE(info[b] == 3);
+    } else {
+      REQUIRE(info[b] == 0);
+    }
+  }
+
+  // Failed matrices, and the zero padding of the last group, are solved
+  // without dividing by zero
+  std::feclearexcept(FE_ALL_EXCEPT);
+  LU.solve(B);
+  chol.solve(B);
+  REQUIRE_FALSE(std::fetestexcept(FE_DIVBYZERO));
+
+  REQUIRE_THROWS_AS(chol.solve(BatchArray(count + 1, n, 1)),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(LU.solve(BatchArray(count, n + 1, 1)),
+                    std::invalid_argument);
+}
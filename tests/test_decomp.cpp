@@ -1,6 +1,9 @@
 #include "../src/array.hpp"
 #include "../src/decomp.hpp"
+#include "../src/parallel.hpp"
+#include "../src/simd.hpp"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <cmath>
@@ -10,6 +13,32 @@
 
 using namespace Catch::Matchers;
 
+namespace {
+
+// A dense n x n matrix with entries spread over [-1, 1]
+Array general(int n) {
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = std::sin(0.37 * i * n + 1.3 * j);
+    }
+  }
+  return A;
+}
+
+// B B^T + n I for B = general(n): symmetric positive definite and well
+// conditioned, so every factorization applies
+Array spd(int n) {
+  Array B = general(n);
+  Array A = B.mult(B.t());
+  for (int i = 0; i < n; ++i) {
+    A[i][i] += n;
+  }
+  return A;
+}
+
+} // namespace
+
 TEST_CASE("Decomposition initialization works as expected", "[LUDecomp]") {
   Array A(4, 4);
   std::vector<double> vals = {2, 1, 1, 0, 4, 3, 3, 1, 8, 7, 9, 5, 6, 7, 9, 8};
@@ -159,3 +188,445 @@ TEST_CASE("Cholesky solve works: 3x3 totally nonnegative",
     REQUIRE_THAT(x_vals[i], WithinAbs(x_vals_true[i], 1e-6));
   }
 }
+
+TEST_CASE("Blocked LU reconstructs PA = LU across several blocks",
+          "[LUDecomp][decompose]") {
+  for (int n : {63, 64, 65, 150}) {
+    Array A = general(n);
+    for (int i = 0; i < n; ++i) {
+      A[i][i] += 0.5;
+    }
+
+    LUDecomp LU(A);
+    LU.decompose();
+    Array LU_vals(LU.get_vals(), n, n);
+    std::vector<int> p = LU.get_pivots();
+
+    // L is unit lower triangular, U upper triangular, packed together
+    Array L(n, n);
+    Array U(n, n);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        if (j < i) {
+          L[i][j] = LU_vals[i][j];
+        } else {
+          U[i][j] = LU_vals[i][j];
+        }
+      }
+      L[i][i] = 1;
+    }
+
+    Array LU_prod = L.mult(U);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        REQUIRE_THAT(LU_prod[i][j], WithinAbs(A[p[i]][j], 1e-10));
+      }
+      // partial pivoting keeps every multiplier bounded by one
+      for (int j = 0; j < i; ++j) {
+        REQUIRE(std::abs(L[i][j]) <= 1.0);
+      }
+    }
+
+    // and the factorization solves the system
+    Array x_true(n, 1);
+    for (int i = 0; i < n; ++i) {
+      x_true[i][0] = i % 5 - 2;
+    }
+    Array b = A.mult(x_true);
+    Array x = LU.solve(b);
+    for (int i = 0; i < n; ++i) {
+      REQUIRE_THAT(x[i][0], WithinAbs(x_true[i][0], 1e-8));
+    }
+  }
+}
+
+TEST_CASE("LU decomposition throws on a singular matrix",
+          "[LUDecomp][decompose]") {
+  int n = 80;
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = i + j;
+    }
+  }
+  LUDecomp LU(A);
+  REQUIRE_THROWS_AS(LU.decompose(), std::runtime_error);
+
+  // The pivot tolerance follows the scalar type: 1e-6 is a usable pivot in
+  // double but not in float
+  std::vector<double> vals = {1, 0, 0, 0, 1e-6, 0, 0, 0, 1};
+  Array D(vals, 3, 3);
+  LUDecomp LU_double(D);
+  REQUIRE_NOTHROW(LU_double.decompose());
+  BasicArray<float> Df(D);
+  BasicLUDecomp<float> LU_float(Df.view());
+  REQUIRE_THROWS_AS(LU_float.decompose(), std::runtime_error);
+}
+
+TEST_CASE("Tiled LU matches the blocked LU", "[LUDecomp][decompose][tiled]") {
+  int n = 150;
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = std::cos(0.91 * i * n + 0.7 * j) + (i == j ? 0.25 : 0.0);
+    }
+  }
+
+  LUDecomp reference(A);
+  reference.decompose();
+  std::vector<double> ref_vals = reference.get_vals();
+
+  for (int tile_size : {16, 50, 64, 150, 400}) {
+    for (int n_threads : {1, 3}) {
+      LUDecomp tiled(A);
+      tiled.decompose_tiled(tile_size, n_threads);
+      REQUIRE(tiled.get_pivots() == reference.get_pivots());
+
+      std::vector<double> vals = tiled.get_vals();
+      for (size_t i = 0; i < vals.size(); ++i) {
+        REQUIRE_THAT(vals[i], WithinAbs(ref_vals[i], 1e-10));
+      }
+    }
+  }
+}
+
+TEST_CASE("Tiled LU throws on a singular matrix",
+          "[LUDecomp][decompose][tiled]") {
+  int n = 40;
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = i * j;
+    }
+  }
+  LUDecomp LU(A);
+  REQUIRE_THROWS_AS(LU.decompose_tiled(8, 2), std::runtime_error);
+  REQUIRE_THROWS_AS(LU.decompose_tiled(0), std::invalid_argument);
+}
+
+TEST_CASE("Blocked Cholesky reconstructs A = LL^T across several blocks",
+          "[Cholesky][decompose]") {
+  for (int n_threads : {1, 3}) {
+    parallel::set_num_threads(n_threads);
+    for (int n : {63, 64, 65, 300}) {
+      Array A = spd(n);
+
+      Cholesky chol(A);
+      chol.decompose();
+      Array C(chol.get_vals(), n, n);
+
+      Array L(n, n);
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j <= i; ++j) {
+          L[i][j] = C[i][j];
+        }
+        // the strictly upper triangle is left untouched
+        for (int j = i + 1; j < n; ++j) {
+          REQUIRE(C[i][j] == A[i][j]);
+        }
+      }
+
+      Array LLt = L.mult(L.t());
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+          REQUIRE_THAT(LLt[i][j], WithinAbs(A[i][j], 1e-8 * n));
+        }
+      }
+    }
+  }
+  parallel::set_num_threads(0);
+}
+
+TEST_CASE("Cholesky throws on a matrix that is not positive definite",
+          "[Cholesky][decompose]") {
+  // indefinite in the last block column only
+  int n = 100;
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    A[i][i] = (i == n - 1) ? -1.0 : 2.0;
+  }
+  Cholesky chol(A);
+  REQUIRE_THROWS_AS(chol.decompose(), std::runtime_error);
+
+  std::vector<double> vals = {1, 2, 2, 1};
+  Cholesky chol_small(Array(vals, 2, 2));
+  REQUIRE_THROWS_AS(chol_small.decompose(), std::runtime_error);
+}
+
+TEST_CASE("Cholesky updates and downdates match refactoring",
+          "[Cholesky][update]") {
+  // Lower triangle of the factor, from its stored values
+  auto factor = [](Cholesky &chol) {
+    int n = chol.get_nrows();
+    Array C(chol.get_vals(), n, n);
+    for (int i = 0; i < n; ++i) {
+      for (int j = i + 1; j < n; ++j) {
+        C[i][j] = 0.0;
+      }
+    }
+    return C;
+  };
+  auto max_diff = [](const Array &X, const Array &Y) {
+    std::vector<double> x = X.get_vals(), y = Y.get_vals();
+    double diff = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      diff = std::max(diff, std::abs(x[i] - y[i]));
+    }
+    return diff;
+  };
+
+  // 700 rows leave enough below the first panels for the parallel path
+  for (int n : {1, 17, 100, 700}) {
+    for (int k : {1, 3}) {
+      Array A = spd(n);
+      Array V(n, k);
+      for (int i = 0; i < n; ++i) {
+        for (int p = 0; p < k; ++p) {
+          V[i][p] = std::cos(0.3 * i + 2.1 * p);
+        }
+      }
+      Array A_plus = A + V.mult(V.t());
+      Cholesky expected(A_plus);
+      expected.decompose();
+
+      for (int n_threads : {1, 3}) {
+        parallel::set_num_threads(n_threads);
+        for (simd::Isa isa : {simd::Isa::scalar, simd::Isa::sse2,
+                              simd::Isa::avx2, simd::Isa::avx512}) {
+          if (!simd::supported(isa)) {
+            continue;
+          }
+          simd::set_isa(isa);
+          Cholesky chol(A);
+          chol.decompose();
+          Array L = factor(chol);
+
+          chol.update(V);
+          REQUIRE(max_diff(factor(chol), factor(expected)) <= 1e-10 * n);
+          chol.downdate(V);
+          REQUIRE(max_diff(factor(chol), L) <= 1e-10 * n);
+        }
+      }
+    }
+  }
+  simd::set_isa(simd::detected_isa());
+  parallel::set_num_threads(0);
+
+  // A - v v^T loses positive definiteness at its second leading minor
+  Array I(3, 3);
+  I.set_zeros();
+  for (int i = 0; i < 3; ++i) {
+    I[i][i] = 1.0;
+  }
+  Cholesky chol(I);
+  chol.decompose();
+  std::vector<double> v = {0.6, 0.9, 0.0};
+  REQUIRE_THROWS_AS(chol.downdate(Array(v, 3, 1)), std::runtime_error);
+
+  Array wrong(4, 1);
+  wrong.set_ones();
+  REQUIRE_THROWS_AS(chol.update(wrong), std::invalid_argument);
+}
+
+TEST_CASE("Solves with many right-hand sides match A X = B",
+          "[LUDecomp][Cholesky][solve]") {
+  int n = 150;
+  // Symmetric positive definite, so both factorizations apply
+  Array A = spd(n);
+
+  LUDecomp LU(A);
+  LU.decompose();
+  Cholesky chol(A);
+  chol.decompose();
+
+  for (int n_threads : {1, 3}) {
+    parallel::set_num_threads(n_threads);
+    for (int k : {1, 7, 300}) {
+      Array rhs(n, k);
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < k; ++j) {
+          rhs[i][j] = std::cos(0.11 * i + 0.7 * j);
+        }
+      }
+
+      for (Array x : {LU.solve(rhs), chol.solve(rhs)}) {
+        REQUIRE(x.get_nrow() == n);
+        REQUIRE(x.get_ncol() == k);
+        Array Ax = A.mult(x);
+        for (int i = 0; i < n; ++i) {
+          for (int j = 0; j < k; ++j) {
+            REQUIRE_THAT(Ax[i][j], WithinAbs(rhs[i][j], 1e-9));
+          }
+        }
+      }
+
+      // Each column is solved as if on its own
+      Array col = LU.solve(rhs.col(k - 1));
+      Array x = LU.solve(rhs);
+      for (int i = 0; i < n; ++i) {
+        REQUIRE_THAT(x[i][k - 1], WithinAbs(col[i][0], 1e-12));
+      }
+    }
+  }
+  parallel::set_num_threads(0);
+
+  Array wrong(n - 1, 2);
+  REQUIRE_THROWS_AS(LU.solve(wrong), std::invalid_argument);
+  REQUIRE_THROWS_AS(chol.solve(wrong), std::invalid_argument);
+}
+
+TEST_CASE("Mixed precision solves reach double precision accuracy",
+          "[LUDecomp][Cholesky][mixed]") {
+  int n = 300, k = 3;
+  Array A = spd(n);
+  Array rhs(n, k);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < k; ++j) {
+      rhs[i][j] = std::cos(0.11 * i + 0.7 * j);
+    }
+  }
+  LUDecomp LU(A);
+  LU.decompose();
+  Array expected = LU.solve(rhs);
+
+  MixedLUDecomp mixed_lu(A);
+  mixed_lu.decompose();
+  MixedCholesky mixed_chol(A);
+  mixed_chol.decompose();
+  // Solves are const, as for LUDecomp and Cholesky
+  const MixedLUDecomp &lu_ref = mixed_lu;
+  const MixedCholesky &chol_ref = mixed_chol;
+  for (Array x : {lu_ref.solve(rhs), chol_ref.solve(rhs)}) {
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < k; ++j) {
+        REQUIRE_THAT(x[i][j], WithinAbs(expected[i][j], 1e-13));
+      }
+    }
+  }
+  // A float solve alone is only good to about 1e-7
+  REQUIRE(mixed_lu.is_mixed());
+  REQUIRE(mixed_lu.get_iterations() >= 1);
+  REQUIRE(mixed_lu.get_iterations() <= 5);
+  REQUIRE(mixed_chol.is_mixed());
+  REQUIRE(mixed_chol.get_iterations() >= 1);
+
+  Array wrong(n - 1, 2);
+  REQUIRE_THROWS_AS(mixed_lu.solve(wrong), std::invalid_argument);
+  REQUIRE_THROWS_AS(MixedCholesky(Array(2, 3)), std::invalid_argument);
+}
+
+TEST_CASE("Mixed precision solves fall back to double factors",
+          "[LUDecomp][Cholesky][mixed]") {
+  // The Hilbert matrix of order 8 has a condition number near 1e10, beyond
+  // what refinement from float factors can recover from: decompose() factors
+  // it in double instead
+  int n = 8;
+  Array H(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      H[i][j] = 1.0 / (i + j + 1);
+    }
+  }
+  Array rhs(n, 1);
+  rhs.set_ones();
+  LUDecomp LU(H);
+  LU.decompose();
+  Cholesky chol(H);
+  chol.decompose();
+
+  MixedLUDecomp mixed_lu(H);
+  mixed_lu.decompose();
+  REQUIRE(!mixed_lu.is_mixed());
+  Array x = mixed_lu.solve(rhs);
+  REQUIRE(mixed_lu.get_iterations() == 0);
+  REQUIRE(x.get_vals() == LU.solve(rhs).get_vals());
+
+  MixedCholesky mixed_chol(H);
+  mixed_chol.decompose();
+  REQUIRE(!mixed_chol.is_mixed());
+  x = mixed_chol.solve(rhs);
+  REQUIRE(x.get_vals() == chol.solve(rhs).get_vals());
+
+  // Out of float range
+  Array big(2, 2);
+  big.set_zeros();
+  big[0][0] = 1e300;
+  big[1][1] = 2e300;
+  MixedLUDecomp big_lu(big);
+  big_lu.decompose();
+  REQUIRE(!big_lu.is_mixed());
+  REQUIRE_THAT(big_lu.solve(rhs.block(0, 0, 2, 1))[1][0],
+               WithinRel(0.5e-300, 1e-15));
+
+  // Singular, or not positive definite, in double too; there is then nothing
+  // to solve with, as before decompose()
+  Array singular(2, 2);
+  singular.set_zeros();
+  singular[0][1] = singular[1][1] = 1.0;
+  MixedLUDecomp singular_lu(singular);
+  REQUIRE_THROWS_AS(singular_lu.solve(rhs.block(0, 0, 2, 1)),
+                    std::logic_error);
+  REQUIRE_THROWS_AS(singular_lu.decompose(), std::runtime_error);
+  REQUIRE_THROWS_AS(singular_lu.solve(rhs.block(0, 0, 2, 1)),
+                    std::logic_error);
+  std::vector<double> vals = {1, 2, 2, 1};
+  MixedCholesky indefinite(Array(vals, 2, 2));
+  REQUIRE_THROWS_AS(indefinite.solve(rhs.block(0, 0, 2, 1)),
+                    std::logic_error);
+  REQUIRE_THROWS_AS(indefinite.decompose(), std::runtime_error);
+  REQUIRE_THROWS_AS(indefinite.solve(rhs.block(0, 0, 2, 1)),
+                    std::logic_error);
+}
+
+TEST_CASE("Single precision factorizations match double to float accuracy",
+          "[LUDecomp][Cholesky][float]") {
+  int n = 150;
+  Array A = spd(n);
+  Array rhs(n, 2);
+  for (int i = 0; i < n; ++i) {
+    rhs[i][0] = std::cos(0.11 * i);
+    rhs[i][1] = std::sin(0.7 * i);
+  }
+  BasicArray<float> Af(A), rhsf(rhs);
+
+  LUDecomp LU(A);
+  LU.decompose();
+  BasicLUDecomp<float> LUf(Af.view());
+  LUf.decompose();
+  REQUIRE(LUf.get_pivots() == LU.get_pivots());
+
+  Cholesky chol(A);
+  chol.decompose();
+  BasicCholesky<float> cholf(Af.view());
+  cholf.decompose();
+
+  Array x = LU.solve(rhs);
+  for (BasicArray<float> xf : {LUf.solve(rhsf), cholf.solve(rhsf)}) {
+    REQUIRE(xf.get_nrow() == n);
+    REQUIRE(xf.get_ncol() == 2);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < 2; ++j) {
+        REQUIRE_THAT(xf[i][j], WithinAbs(x[i][j], 1e-5));
+      }
+    }
+  }
+
+  // Rank updates of the float factor follow the double ones
+  Array V(n, 1);
+  for (int i = 0; i < n; ++i) {
+    V[i][0] = std::cos(0.3 * i);
+  }
+  BasicArray<float> Vf(V);
+  chol.update(V);
+  cholf.update(Vf.view());
+  std::vector<double> vals = chol.get_vals();
+  std::vector<float> valsf = cholf.get_vals();
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      REQUIRE_THAT(valsf[i * n + j], WithinAbs(vals[i * n + j], 1e-4));
+    }
+  }
+
+  BasicArray<float> wrong(n - 1, 1);
+  REQUIRE_THROWS_AS(LUf.solve(wrong), std::invalid_argument);
+}
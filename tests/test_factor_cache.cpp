@@ -0,0 +1,127 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/factor_cache.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+namespace {
+
+// Symmetric positive definite, and different for each seed
+Array spd(int n, double seed) {
+  Array A(n, n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      A[i][j] = std::sin(seed + 0.3 * (i + j)) + (i == j ? n : 0.0);
+    }
+  }
+  return A;
+}
+
+} // namespace
+
+TEST_CASE("Cached factors are reused for equal matrices", "[FactorCache]") {
+  FactorCache cache;
+  Array A = spd(40, 1.0);
+  Array b(40, 2);
+  b.set_ones();
+
+  std::shared_ptr<const LUDecomp> LU = cache.lu(A);
+  LUDecomp fresh(A);
+  fresh.decompose();
+  Array x = LU->solve(b), expected = fresh.solve(b);
+  for (int i = 0; i < 40; ++i) {
+    REQUIRE_THAT(x[i][0], WithinAbs(expected[i][0], 1e-14));
+  }
+
+  // An equal copy, and a transposed view of the (symmetric) matrix, hit
+  Array copy(A.get_vals(), 40, 40);
+  REQUIRE(cache.lu(copy) == LU);
+  REQUIRE(cache.lu(A.t()) == LU);
+
+  // Another kind of factorization, or other values, miss
+  std::shared_ptr<const Cholesky> chol = cache.cholesky(A);
+  REQUIRE(cache.cholesky(A) == chol);
+  copy[3][5] += 1e-12;
+  REQUIRE(cache.lu(copy) != LU);
+
+  FactorCache::Stats stats = cache.get_stats();
+  REQUIRE(stats.hits == 3);
+  REQUIRE(stats.misses == 3);
+  REQUIRE(stats.entries == 3);
+  REQUIRE(stats.bytes == 3 * 40 * 40 * sizeof(double) + 2 * 40 * sizeof(int));
+
+  cache.clear();
+  REQUIRE(cache.get_stats().entries == 0);
+  REQUIRE(cache.get_stats().bytes == 0);
+  REQUIRE(cache.lu(A) != LU);
+}
+
+TEST_CASE("The least recently used factors are evicted", "[FactorCache]") {
+  int n = 20;
+  std::size_t factor_bytes = n * n * sizeof(double);
+  FactorCache cache(3 * factor_bytes);
+  std::vector<Array> matrices;
+  for (int s = 0; s < 4; ++s) {
+    matrices.push_back(spd(n, s));
+  }
+
+  std::shared_ptr<const Cholesky> first = cache.cholesky(matrices[0]);
+  cache.cholesky(matrices[1]);
+  cache.cholesky(matrices[2]);
+  cache.cholesky(matrices[0]); // now matrices[1] is the least recent
+  cache.cholesky(matrices[3]);
+  FactorCache::Stats stats = cache.get_stats();
+  REQUIRE(stats.evictions == 1);
+  REQUIRE(stats.entries == 3);
+  REQUIRE(stats.bytes == 3 * factor_bytes);
+
+  REQUIRE(cache.cholesky(matrices[0]) == first);
+  cache.cholesky(matrices[1]);
+  REQUIRE(cache.get_stats().misses == 5);
+
+  // Too large to cache at all, but still factored
+  FactorCache tiny(factor_bytes - 1);
+  REQUIRE(tiny.cholesky(matrices[0]) != nullptr);
+  REQUIRE(tiny.get_stats().entries == 0);
+  REQUIRE(tiny.get_stats().misses == 1);
+}
+
+TEST_CASE("Failed factorizations are not cached", "[FactorCache]") {
+  FactorCache cache;
+  std::vector<double> vals = {1, 2, 2, 1};
+  Array indefinite(vals, 2, 2);
+  REQUIRE_THROWS_AS(cache.cholesky(indefinite), std::runtime_error);
+  REQUIRE_THROWS_AS(cache.cholesky(indefinite), std::runtime_error);
+  REQUIRE(cache.get_stats().misses == 2);
+  REQUIRE(cache.get_stats().entries == 0);
+  REQUIRE(cache.get_stats().bytes == 0);
+  REQUIRE(cache.lu(indefinite) != nullptr);
+
+  REQUIRE_THROWS_AS(cache.lu(Array(2, 3)), std::invalid_argument);
+}
+
+TEST_CASE("Concurrent requests factor a matrix once", "[FactorCache]") {
+  FactorCache cache;
+  Array A = spd(200, 2.0);
+  std::vector<std::shared_ptr<const LUDecomp>> factors(8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] { factors[t] = cache.lu(A); });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (int t = 1; t < 8; ++t) {
+    REQUIRE(factors[t] == factors[0]);
+  }
+  REQUIRE(cache.get_stats().misses == 1);
+  REQUIRE(cache.get_stats().hits == 7);
+}
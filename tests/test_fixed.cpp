@@ -0,0 +1,147 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/fixed.hpp"
+#include "../src/fixed_decomp.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+TEST_CASE("Fixed arrays convert to and from Arrays", "[fixed]") {
+  static_assert(FixedArray<2, 3>::get_nrow() == 2, "rows are constexpr");
+  static_assert(FixedArray<2, 3>::get_ncol() == 3, "cols are constexpr");
+
+  FixedArray<2, 3> f({1, 2, 3, 4, 5, 6});
+  REQUIRE(f(1, 0) == 4);
+  REQUIRE(f[0][2] == 3);
+  REQUIRE(FixedArray<2, 2>()(1, 1) == 0);
+
+  // into an Array (through its view), and back from any view
+  Array a(f);
+  REQUIRE(a.get_vals() == std::vector<double>({1, 2, 3, 4, 5, 6}));
+  FixedArray<3, 2> t(a.t());
+  REQUIRE(t.get_vals() == f.transpose().get_vals());
+  REQUIRE(t(2, 1) == 6);
+  using Fixed3x3 = FixedArray<3, 3>;
+  REQUIRE_THROWS_AS(Fixed3x3(a.view()), std::invalid_argument);
+
+  // views write through
+  f.view()(0, 0) = 10;
+  REQUIRE(f(0, 0) == 10);
+
+  FixedArray<3, 3> I;
+  I.eye();
+  REQUIRE(I(1, 1) == 1);
+  REQUIRE(I(1, 2) == 0);
+}
+
+TEST_CASE("Fixed mult and elementwise operators match Array", "[fixed]") {
+  FixedArray<3, 4> A;
+  FixedArray<4, 2> B;
+  FixedArray<3, 4> C;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      A(i, j) = std::sin(1.0 + i + 3.0 * j);
+      C(i, j) = 2.0 + std::cos(i - 2.0 * j);
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      B(i, j) = std::cos(2.0 * i + j);
+    }
+  }
+
+  FixedArray<3, 2> AB = mult(A, B);
+  Array AB_ref = mult(A, B.view());
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      REQUIRE_THAT(AB(i, j), WithinAbs(AB_ref[i][j], 1e-14));
+    }
+  }
+
+  Array a(A), c(C);
+  FixedArray<3, 4> sum = A + C, diff = A - C, prod = A * C, quot = A / C;
+  Array sum_ref = a + c, diff_ref = a - c, prod_ref = a * c, quot_ref = a / c;
+  REQUIRE(sum.span()[5] == sum_ref.span()[5]);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      REQUIRE(sum(i, j) == sum_ref[i][j]);
+      REQUIRE(diff(i, j) == diff_ref[i][j]);
+      REQUIRE(prod(i, j) == prod_ref[i][j]);
+      REQUIRE(quot(i, j) == quot_ref[i][j]);
+    }
+  }
+}
+
+TEST_CASE("Fixed LU matches LUDecomp and solves", "[fixed][LU]") {
+  std::vector<double> vals = {2, 1, 1, 0, 4, 3, 3, 1, 8, 7, 9, 5, 6, 7, 9, 8};
+  FixedArray<4, 4> A;
+  for (int i = 0; i < 16; ++i) {
+    A.span()[i] = vals[i];
+  }
+  Array A_ref(vals, 4, 4);
+
+  FixedLUDecomp<4> LU(A);
+  LU.decompose();
+  LUDecomp LU_ref(A_ref, 4);
+  LU_ref.decompose();
+
+  std::vector<double> factors = LU_ref.get_vals();
+  for (int i = 0; i < 16; ++i) {
+    REQUIRE_THAT(LU.get_factors().span()[i], WithinAbs(factors[i], 1e-14));
+  }
+  std::vector<int> p = LU_ref.get_pivots();
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(LU.get_pivots()[i] == p[i]);
+  }
+
+  // A X = B, for two right-hand sides
+  FixedArray<4, 2> B;
+  for (int i = 0; i < 4; ++i) {
+    B(i, 0) = i + 1.0;
+    B(i, 1) = 1.0 - i;
+  }
+  FixedArray<4, 2> X = LU.solve(B);
+  FixedArray<4, 2> AX = A.mult(X);
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      REQUIRE_THAT(AX(i, j), WithinAbs(B(i, j), 1e-12));
+    }
+  }
+
+  FixedArray<3, 3> S({1, 2, 3, 2, 4, 6, 3, 6, 9});
+  FixedLUDecomp<3> LU_sing(S);
+  REQUIRE_THROWS_AS(LU_sing.decompose(), std::runtime_error);
+}
+
+TEST_CASE("Fixed Cholesky matches Cholesky and solves", "[fixed][Cholesky]") {
+  FixedArray<3, 3> A({4, 2, 0.4, 2, 5, 1, 0.4, 1, 3});
+  Array A_ref(A);
+
+  FixedCholesky<3> chol(A);
+  chol.decompose();
+  Cholesky chol_ref(A_ref, 3);
+  chol_ref.decompose();
+
+  std::vector<double> factors = chol_ref.get_vals();
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      REQUIRE_THAT(chol.get_factors()(i, j),
+                   WithinAbs(factors[i * 3 + j], 1e-14));
+    }
+  }
+
+  FixedArray<3, 1> b({1, -2, 3});
+  FixedArray<3, 1> x = chol.solve(b);
+  FixedArray<3, 1> Ax = A.mult(x);
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE_THAT(Ax(i, 0), WithinAbs(b(i, 0), 1e-12));
+  }
+
+  FixedCholesky<2> not_spd(FixedArray<2, 2>({1, 2, 2, 1}));
+  REQUIRE_THROWS_AS(not_spd.decompose(), std::runtime_error);
+}
@@ -0,0 +1,140 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/io.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A path in the temporary directory, removed on scope exit
+class TempFile {
+public:
+  explicit TempFile(const std::string &name)
+      : path((std::filesystem::temp_directory_path() / name).string()) {}
+  ~TempFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+} // namespace
+
+TEST_CASE("Arrays round-trip through a mapped file", "[io]") {
+  TempFile file("ulinalg_test_round_trip.bin");
+  Array a(std::vector<double>{1, 2, 3, 4, 5, 6}, 2, 3);
+  io::save(file.path, a);
+
+  io::Header h = io::read_header(file.path);
+  REQUIRE(h.version == io::FORMAT_VERSION);
+  REQUIRE(h.nrow == 2);
+  REQUIRE(h.ncol == 3);
+  REQUIRE(h.data_offset % 64 == 0);
+
+  io::MappedArray m(file.path);
+  REQUIRE(m.get_nrow() == 2);
+  REQUIRE(m.get_ncol() == 3);
+  auto address = reinterpret_cast<std::uintptr_t>(m.view().data());
+  REQUIRE(address % 64 == 0);
+  REQUIRE(Array(m.view()).get_vals() == a.get_vals());
+  REQUIRE(io::load(file.path).get_vals() == a.get_vals());
+
+  // Mapped views work wherever views do
+  Array b = m.view() + a;
+  REQUIRE(b.get_vals() == std::vector<double>{2, 4, 6, 8, 10, 12});
+  Array c = mult(m, a.t());
+  REQUIRE(c.get_vals() == std::vector<double>{14, 32, 32, 77});
+}
+
+TEST_CASE("Strided views are saved as their values", "[io]") {
+  TempFile file("ulinalg_test_strided.bin");
+  Array a(std::vector<double>{1, 2, 3, 4, 5, 6}, 2, 3);
+  io::save(file.path, a.t());
+  REQUIRE(io::load(file.path).get_vals() ==
+          std::vector<double>{1, 4, 2, 5, 3, 6});
+
+  io::save(file.path, a.block(0, 1, 2, 1));
+  Array col = io::load(file.path);
+  REQUIRE(col.get_nrow() == 2);
+  REQUIRE(col.get_vals() == std::vector<double>{2, 5});
+
+  io::save(file.path, Array(0, 4));
+  io::MappedArray empty(file.path);
+  REQUIRE(empty.get_nrow() == 0);
+  REQUIRE(empty.get_ncol() == 4);
+}
+
+TEST_CASE("Writes to a mapping reach the file only when shared", "[io]") {
+  TempFile file("ulinalg_test_shared.bin");
+  io::save(file.path, Array(std::vector<double>{1, 2, 3, 4}, 2, 2));
+  {
+    io::MappedArray m(file.path);
+    m.view()(0, 0) = 10;
+    REQUIRE(m.view()(0, 0) == 10);
+  }
+  REQUIRE(io::load(file.path).get_vals() == std::vector<double>{1, 2, 3, 4});
+  {
+    io::MappedArray m(file.path, io::MappedArray::Mode::shared);
+    m.view()(1, 1) = 40;
+    io::MappedArray moved(std::move(m));
+    REQUIRE(m.get_nrow() == 0);
+    REQUIRE(moved.view()(1, 1) == 40);
+  }
+  REQUIRE(io::load(file.path).get_vals() == std::vector<double>{1, 2, 3, 40});
+}
+
+TEST_CASE("Invalid Array files are refused", "[io]") {
+  TempFile file("ulinalg_test_invalid.bin");
+  REQUIRE_THROWS_AS(io::MappedArray(file.path), std::runtime_error);
+
+  std::FILE *f = std::fopen(file.path.c_str(), "wb");
+  std::fputs("not an array file, but long enough to hold a header......", f);
+  std::fputs("........", f);
+  std::fclose(f);
+  REQUIRE_THROWS_AS(io::read_header(file.path), std::runtime_error);
+
+  // A valid header with its data cut short
+  io::save(file.path, Array(4, 4));
+  std::filesystem::resize_file(file.path, 64 + 8 * 15);
+  REQUIRE_THROWS_AS(io::load(file.path), std::runtime_error);
+}
+
+TEST_CASE("Out-of-core mult matches the in-core product", "[io]") {
+  TempFile a_file("ulinalg_test_ooc_a.bin"), b_file("ulinalg_test_ooc_b.bin"),
+      c_file("ulinalg_test_ooc_c.bin");
+  Array a(37, 23), b(23, 29);
+  for (int i = 0; i < 37; ++i) {
+    for (int j = 0; j < 23; ++j) {
+      a[i][j] = (i * 7 + j * 3) % 11 - 5.0;
+    }
+  }
+  for (int i = 0; i < 23; ++i) {
+    for (int j = 0; j < 29; ++j) {
+      b[i][j] = (i * 5 + j * 2) % 13 - 6.0;
+    }
+  }
+  io::save(a_file.path, a);
+  io::save(b_file.path, b);
+  Array expected = a.mult(b);
+
+  // Budgets for 8x8 tiles (ragged at every edge), 1x1 tiles, and one tile
+  for (std::size_t budget : {5 * 8 * 64, 5 * 8, 1 << 20}) {
+    io::mult(c_file.path, a_file.path, b_file.path, budget);
+    Array c = io::load(c_file.path);
+    REQUIRE(c.get_nrow() == 37);
+    REQUIRE(c.get_ncol() == 29);
+    REQUIRE(c.get_vals() == expected.get_vals());
+  }
+
+  REQUIRE_THROWS_AS(io::mult(c_file.path, a_file.path, b_file.path, 8),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(io::mult(c_file.path, a_file.path, a_file.path),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(io::mult(a_file.path, a_file.path, b_file.path),
+                    std::invalid_argument);
+}
@@ -0,0 +1,218 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/iterative.hpp"
+#include "../src/memory.hpp"
+#include "../src/sparse.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace Catch::Matchers;
+
+namespace {
+
+// 5-point stencil on a g x g grid: the SPD Laplacian when c == 0, and a
+// nonsymmetric convection-diffusion operator otherwise
+SparseArray stencil(int g, double c) {
+  std::vector<Triplet> entries;
+  for (int i = 0; i < g; ++i) {
+    for (int j = 0; j < g; ++j) {
+      int row = i * g + j;
+      entries.push_back({row, row, 4.0});
+      if (i > 0) {
+        entries.push_back({row, row - g, -1.0 - c});
+      }
+      if (i + 1 < g) {
+        entries.push_back({row, row + g, -1.0 + c});
+      }
+      if (j > 0) {
+        entries.push_back({row, row - 1, -1.0});
+      }
+      if (j + 1 < g) {
+        entries.push_back({row, row + 1, -1.0});
+      }
+    }
+  }
+  return SparseArray(g * g, g * g, entries);
+}
+
+Array rhs(int n) {
+  Array b(n, 1);
+  for (int i = 0; i < n; ++i) {
+    b[i][0] = std::sin(0.1 * i) + 1.0;
+  }
+  return b;
+}
+
+double residual(const SparseArray &A, const Array &x,
+                const ConstArrayView &b) {
+  Array r = mult(A, x) - b;
+  double rr = 0, bb = 0;
+  for (int i = 0; i < b.get_nrow(); ++i) {
+    rr += r[i][0] * r[i][0];
+    bb += b(i, 0) * b(i, 0);
+  }
+  return std::sqrt(rr / bb);
+}
+
+} // namespace
+
+TEST_CASE("CG solves SPD systems, faster with preconditioning",
+          "[iterative]") {
+  SparseArray A = stencil(20, 0.0);
+  int n = A.get_nrow();
+  Array b = rhs(n);
+  JacobiPreconditioner jacobi(A);
+  IncompleteCholesky ic(A);
+
+  int plain_iterations = 0;
+  for (const Preconditioner *M :
+       {static_cast<const Preconditioner *>(nullptr),
+        static_cast<const Preconditioner *>(&jacobi),
+        static_cast<const Preconditioner *>(&ic)}) {
+    Array x(n, 1);
+    x.set_zeros();
+    IterativeResult res = cg(A, b, x, {1e-10, 0, 30}, M);
+    REQUIRE(res.converged);
+    REQUIRE(res.residual <= 1e-10);
+    REQUIRE(residual(A, x, b) <= 1e-9);
+    if (M == nullptr) {
+      plain_iterations = res.iterations;
+    } else if (M == &ic) {
+      REQUIRE(res.iterations < plain_iterations / 2);
+    }
+  }
+}
+
+TEST_CASE("Incomplete Cholesky is exact for a tridiagonal matrix",
+          "[iterative]") {
+  // No fill-in is dropped, so IC(0) is the Cholesky factor
+  std::vector<Triplet> entries;
+  for (int i = 0; i < 6; ++i) {
+    entries.push_back({i, i, 4.0});
+    if (i > 0) {
+      entries.push_back({i, i - 1, -1.0});
+      entries.push_back({i - 1, i, -1.0});
+    }
+  }
+  SparseArray A(6, 6, entries);
+  Array dense = A.to_dense();
+  Cholesky chol(dense.view());
+  chol.decompose();
+  std::vector<double> full = chol.get_vals();
+  Array L = IncompleteCholesky(A).get_factor().to_dense();
+  for (int i = 0; i < 6; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      REQUIRE_THAT(L[i][j], WithinAbs(full[i * 6 + j], 1e-14));
+    }
+  }
+
+  SparseArray indefinite(2, 2, {{0, 0, 1.0}, {0, 1, 2.0}, {1, 0, 2.0},
+                                {1, 1, 1.0}});
+  REQUIRE_THROWS_AS(IncompleteCholesky(indefinite), std::runtime_error);
+}
+
+TEST_CASE("GMRES solves nonsymmetric systems", "[iterative]") {
+  SparseArray A = stencil(15, 0.4);
+  int n = A.get_nrow();
+  Array b = rhs(n);
+  JacobiPreconditioner jacobi(A);
+
+  for (int restart : {10, 50}) {
+    for (const Preconditioner *M :
+         {static_cast<const Preconditioner *>(nullptr),
+          static_cast<const Preconditioner *>(&jacobi)}) {
+      Array x(n, 1);
+      x.set_zeros();
+      IterativeResult res = gmres(A, b, x, {1e-10, 2000, restart}, M);
+      REQUIRE(res.converged);
+      REQUIRE(residual(A, x, b) <= 1e-9);
+    }
+  }
+
+  // Against a dense LU solve
+  Array dense = A.to_dense();
+  LUDecomp LU(dense.view());
+  LU.decompose();
+  Array expected = LU.solve(b);
+  Array x(n, 1);
+  x.set_zeros();
+  gmres(dense, b, x, {1e-12, 2000, 30});
+  for (int i = 0; i < n; ++i) {
+    REQUIRE_THAT(x[i][0], WithinAbs(expected[i][0], 1e-8));
+  }
+}
+
+TEST_CASE("Solvers take matrix-free operators", "[iterative]") {
+  // 1D Laplacian, applied without storing it
+  int n = 50;
+  LinearOperator laplacian(n, [n](const ConstArrayView &x, Array &y) {
+    for (int i = 0; i < n; ++i) {
+      double left = i > 0 ? x(i - 1, 0) : 0.0;
+      double right = i + 1 < n ? x(i + 1, 0) : 0.0;
+      y[i][0] = 2.0 * x(i, 0) - left - right;
+    }
+  });
+  Array b = rhs(n);
+  Array x(n, 1);
+  x.set_zeros();
+  IterativeResult res = cg(laplacian, b, x, {1e-10, 0, 30});
+  REQUIRE(res.converged);
+  REQUIRE(res.iterations <= n);
+
+  Array y(n, 1);
+  laplacian.apply(x, y);
+  for (int i = 0; i < n; ++i) {
+    REQUIRE_THAT(y[i][0], WithinAbs(b[i][0], 1e-8));
+  }
+}
+
+TEST_CASE("Iterations allocate nothing", "[iterative]") {
+  SparseArray A = stencil(10, 0.0);
+  int n = A.get_nrow();
+  Array b = rhs(n);
+  IncompleteCholesky ic(A);
+
+  // Allocations are made in setup only, so the count doesn't grow with the
+  // number of iterations
+  auto allocations = [&](int iterations, bool use_gmres) {
+    Array x(n, 1);
+    x.set_zeros();
+    std::size_t before = memory::get_counters().allocations;
+    if (use_gmres) {
+      gmres(A, b, x, {0.0, iterations, 20}, &ic);
+    } else {
+      cg(A, b, x, {0.0, iterations, 30}, &ic);
+    }
+    return memory::get_counters().allocations - before;
+  };
+  REQUIRE(allocations(2, false) == allocations(10, false));
+  REQUIRE(allocations(25, true) == allocations(65, true)); // over restarts
+}
+
+TEST_CASE("Solvers report non-convergence and bad dimensions",
+          "[iterative]") {
+  SparseArray A = stencil(10, 0.0);
+  int n = A.get_nrow();
+  Array b = rhs(n);
+  Array x(n, 1);
+  x.set_zeros();
+  IterativeResult res = cg(A, b, x, {1e-12, 3, 30});
+  REQUIRE(!res.converged);
+  REQUIRE(res.iterations == 3);
+  REQUIRE(res.residual > 1e-12);
+
+  Array zero(n, 1);
+  zero.set_zeros();
+  res = gmres(A, zero, x);
+  REQUIRE(res.converged);
+  REQUIRE(res.iterations == 0);
+
+  Array wrong(n + 1, 1);
+  REQUIRE_THROWS_AS(cg(A, wrong, x), std::invalid_argument);
+  REQUIRE_THROWS_AS(gmres(A, b, wrong), std::invalid_argument);
+  REQUIRE_THROWS_AS(LinearOperator(Array(2, 3)), std::invalid_argument);
+}
@@ -0,0 +1,166 @@
+#include "../src/array.hpp"
+#include "../src/memory.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+bool aligned(const Array &a) {
+  auto address = reinterpret_cast<std::uintptr_t>(a.span().data());
+  return address % memory::ALIGNMENT == 0;
+}
+
+} // namespace
+
+TEST_CASE("Array storage is aligned for every allocator", "[memory]") {
+  memory::Arena arena;
+  memory::Pool pool;
+  REQUIRE(aligned(Array(3, 5)));
+  {
+    memory::ArenaScope scope(arena);
+    Array a(1, 3), b(3, 7);
+    REQUIRE(aligned(a));
+    REQUIRE(aligned(b));
+    REQUIRE(arena.used() == 64 + 192);
+  }
+  REQUIRE(arena.used() == 0);
+  {
+    memory::ScopedAllocator scope(pool);
+    REQUIRE(aligned(Array(3, 5)));
+    REQUIRE(&memory::get_allocator() == &pool);
+  }
+  REQUIRE(&memory::get_allocator() == &memory::heap());
+}
+
+TEST_CASE("An arena makes a hot loop heap-free", "[memory]") {
+  Array a(16, 16), b(16, 16), c(1, 16);
+  a.set_ones();
+  b.set_ones();
+  c.set_ones();
+
+  memory::Arena arena(4096);
+  auto body = [&]() {
+    memory::ArenaScope scope(arena);
+    Array d = a * b + c;
+    Array e = d.mult(a);
+    Array f = e;
+    REQUIRE(f[15][15] == 32);
+  };
+  body();
+
+  memory::reset_counters();
+  for (int i = 0; i < 100; ++i) {
+    body();
+  }
+  memory::Counters counts = memory::get_counters();
+  REQUIRE(counts.allocations == 300);
+  REQUIRE(counts.heap_allocations == 0);
+  REQUIRE(counts.heap_deallocations == 0);
+}
+
+TEST_CASE("A pool reuses freed blocks of each size class", "[memory]") {
+  memory::Pool pool;
+  memory::ScopedAllocator scope(pool);
+  {
+    Array a(10, 10), b(3, 3);
+  }
+
+  memory::reset_counters();
+  std::size_t held = memory::get_counters().heap_bytes;
+  for (int i = 0; i < 10; ++i) {
+    Array a(9, 11), b(2, 4);
+    Array c = a;
+    c.set_ones();
+  }
+  memory::Counters counts = memory::get_counters();
+  REQUIRE(counts.allocations == 30);
+  // only the first time round: b's smaller class, and a second block of a's
+  // class for c
+  REQUIRE(counts.heap_allocations == 2);
+  REQUIRE(counts.heap_bytes == held + 1024 + 64);
+
+  pool.release();
+  REQUIRE(memory::get_counters().heap_bytes == held - 1024 - 128);
+}
+
+TEST_CASE("Arrays keep their allocator when moved", "[memory]") {
+  memory::Pool pool;
+  Array moved(1, 1);
+  {
+    memory::ScopedAllocator scope(pool);
+    Array a(4, 4);
+    a.set_ones();
+    const double *data = a.span().data();
+    Array b = std::move(a);
+    REQUIRE(b.span().data() == data);
+
+    // assigned to an Array from outside the scope, the values are copied
+    // into its (heap) storage
+    moved = std::move(b);
+    REQUIRE(moved.span().data() != data);
+  }
+  pool.release();
+  REQUIRE(moved.get_vals() == std::vector<double>(16, 1.0));
+}
+
+TEST_CASE("Arena results assigned out of the scope outlive it", "[memory]") {
+  memory::Arena arena;
+  Array a(3, 3), out(0, 0);
+  a.set_ones();
+  {
+    memory::ArenaScope scope(arena);
+    out = a.mult(a);
+  }
+  REQUIRE(arena.used() == 0);
+  {
+    memory::ArenaScope scope(arena);
+    Array overwrite(3, 3);
+    overwrite.set_ones();
+  }
+  REQUIRE(out.get_vals() == std::vector<double>(9, 3.0));
+}
+
+TEST_CASE("Temporary operands lend their storage to the result", "[memory]") {
+  Array A(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  Array B(std::vector<double>{0, 1, 1, 0}, 2, 2);
+  Array row(std::vector<double>{1, 2}, 1, 2);
+  Array AB = A.mult(B);
+  Array ref = AB * AB + row;
+
+  // one allocation for each product, none for the sum
+  memory::reset_counters();
+  Array r = A.mult(B) * A.mult(B) + row;
+  REQUIRE(memory::get_counters().allocations == 2);
+  REQUIRE(r.get_vals() == ref.get_vals());
+
+  // a moved-in operand is overwritten, and left empty
+  memory::reset_counters();
+  Array a = AB;
+  const double *data = a.span().data();
+  Array s = std::move(a) * AB + row;
+  REQUIRE(memory::get_counters().allocations == 1);
+  REQUIRE(s.span().data() == data);
+  REQUIRE(s.get_vals() == ref.get_vals());
+  REQUIRE(a.get_nrow() == 0);
+
+  // also when assigning back to the moved-from Array
+  a = AB;
+  memory::reset_counters();
+  a = std::move(a) * AB + row;
+  REQUIRE(memory::get_counters().allocations == 0);
+  REQUIRE(a.get_vals() == ref.get_vals());
+
+  // a temporary of the wrong shape, or one read through a view at other
+  // indices, can't be reused
+  memory::reset_counters();
+  Array wide = row.mult(A) + AB;
+  REQUIRE(memory::get_counters().allocations == 2);
+  Array t = AB;
+  ConstArrayView t_view = t.t();
+  memory::reset_counters();
+  Array u = std::move(t) - t_view;
+  REQUIRE(memory::get_counters().allocations == 1);
+  REQUIRE(u.get_vals() == std::vector<double>({0, -3, 3, 0}));
+}
@@ -0,0 +1,129 @@
+#include "../src/parallel.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("parallel_for runs every task once", "[parallel]") {
+  std::vector<std::atomic<int>> counts(100);
+  parallel::parallel_for(100, [&](int t) { counts[t] += 1; }, 4);
+  for (auto &c : counts) {
+    REQUIRE(c == 1);
+  }
+
+  REQUIRE_THROWS_AS(parallel::parallel_for(
+                        10,
+                        [](int t) {
+                          if (t == 7) {
+                            throw std::runtime_error("task failed");
+                          }
+                        },
+                        3),
+                    std::runtime_error);
+}
+
+TEST_CASE("parallel_for runs on a shared pool of threads", "[parallel]") {
+  // Repeated calls reuse the same workers (of a pool now of three)
+  parallel::set_num_threads(4);
+  std::set<std::thread::id> ids;
+  std::mutex mutex;
+  for (int i = 0; i < 50; ++i) {
+    parallel::parallel_for(
+        8,
+        [&](int) {
+          std::lock_guard<std::mutex> lock(mutex);
+          ids.insert(std::this_thread::get_id());
+        },
+        4);
+  }
+  REQUIRE(ids.size() <= 4);
+
+  // Calls from several threads at once, around a resize of the pool
+  std::vector<std::atomic<int>> counts(4 * 1000);
+  std::vector<std::thread> callers;
+  for (int c = 0; c < 4; ++c) {
+    callers.emplace_back([&, c] {
+      for (int i = 0; i < 10; ++i) {
+        parallel::parallel_for(
+            100, [&](int t) { counts[c * 1000 + i * 100 + t] += 1; }, 3);
+      }
+    });
+  }
+  parallel::set_num_threads(2);
+  for (std::thread &caller : callers) {
+    caller.join();
+  }
+  parallel::set_num_threads(0);
+  for (auto &c : counts) {
+    REQUIRE(c == 1);
+  }
+}
+
+TEST_CASE("Task graphs respect dependencies", "[parallel][graph]") {
+  // a diamond a -> (b, c) -> d, repeated in a chain
+  parallel::TaskGraph graph;
+  std::mutex mutex;
+  std::vector<int> order;
+  auto record = [&](int id) {
+    return [&, id]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(id);
+    };
+  };
+
+  int prev = -1;
+  for (int k = 0; k < 10; ++k) {
+    int a = graph.add(record(4 * k));
+    int b = graph.add(record(4 * k + 1));
+    int c = graph.add(record(4 * k + 2));
+    int d = graph.add(record(4 * k + 3));
+    graph.depend(a, b);
+    graph.depend(a, c);
+    graph.depend(b, d);
+    graph.depend(c, d);
+    if (prev >= 0) {
+      graph.depend(prev, a);
+    }
+    prev = d;
+  }
+  graph.run(4);
+
+  REQUIRE(order.size() == 40);
+  std::vector<int> position(40);
+  for (int i = 0; i < 40; ++i) {
+    position[order[i]] = i;
+  }
+  for (int k = 0; k < 10; ++k) {
+    REQUIRE(position[4 * k] < position[4 * k + 1]);
+    REQUIRE(position[4 * k] < position[4 * k + 2]);
+    REQUIRE(position[4 * k + 1] < position[4 * k + 3]);
+    REQUIRE(position[4 * k + 2] < position[4 * k + 3]);
+    if (k > 0) {
+      REQUIRE(position[4 * k - 1] < position[4 * k]);
+    }
+  }
+}
+
+TEST_CASE("Ready tasks run in priority order", "[parallel][graph]") {
+  parallel::TaskGraph graph;
+  std::vector<int> order;
+  for (int priority : {1, 5, 3}) {
+    graph.add([&order, priority]() { order.push_back(priority); }, priority);
+  }
+  graph.run(1);
+  REQUIRE(order == std::vector<int>{5, 3, 1});
+}
+
+TEST_CASE("Task graph failures are rethrown", "[parallel][graph]") {
+  parallel::TaskGraph graph;
+  std::atomic<int> ran{0};
+  int fail = graph.add([]() { throw std::runtime_error("task failed"); });
+  int after = graph.add([&]() { ran += 1; });
+  graph.depend(fail, after);
+  REQUIRE_THROWS_AS(graph.run(2), std::runtime_error);
+  REQUIRE(ran == 0);
+}
@@ -0,0 +1,117 @@
+#include "../src/array.hpp"
+#include "../src/decomp.hpp"
+#include "../src/profile.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The entry for op on the given shape bucket, or calls == 0 if there is none
+profile::Stats find(const std::vector<profile::Entry> &entries, profile::Op op,
+                    int max_dim) {
+  for (const profile::Entry &e : entries) {
+    if (e.op == op && e.max_dim == max_dim) {
+      return e.stats;
+    }
+  }
+  return profile::Stats{};
+}
+
+} // namespace
+
+TEST_CASE("Nothing is recorded when profiling is compiled out", "[profile]") {
+  if (profile::enabled()) {
+    return;
+  }
+  Array a(std::vector<double>{1, 2, 3, 4}, 2, 2);
+  Array b = a + a;
+  Array c = a.mult(b);
+  REQUIRE(profile::snapshot().empty());
+  REQUIRE(profile::to_json(profile::snapshot()) == "[]");
+}
+
+TEST_CASE("Operations are recorded per op and shape bucket", "[profile]") {
+  if (!profile::enabled()) {
+    return;
+  }
+  profile::reset();
+  Array a(std::vector<double>{1, 2, 3, 4, 5, 6}, 2, 3);
+  Array row(std::vector<double>{1, 2, 3}, 1, 3);
+  Array b = a + a;
+  Array c = a - row;
+  Array d = a * 2.0;
+  Array e = mult(a.t(), b);
+  Array f = (a + a) / b;
+
+  std::vector<profile::Entry> entries = profile::snapshot();
+  profile::Stats add = find(entries, profile::Op::add, 4);
+  REQUIRE(add.calls == 1);
+  REQUIRE(add.flops == 6);
+  REQUIRE(add.bytes == 8.0 * 3 * 6);
+  REQUIRE(find(entries, profile::Op::sub_bcast, 4).calls == 1);
+  REQUIRE(find(entries, profile::Op::mul_bcast, 4).calls == 1);
+  REQUIRE(find(entries, profile::Op::sub, 4).calls == 0);
+
+  // The root operator names the expression; every node counts a FLOP
+  profile::Stats div = find(entries, profile::Op::div, 4);
+  REQUIRE(div.calls == 1);
+  REQUIRE(div.flops == 12);
+
+  profile::Stats mult = find(entries, profile::Op::mult, 4);
+  REQUIRE(mult.calls == 1);
+  REQUIRE(mult.flops == 2.0 * 3 * 3 * 2);
+  REQUIRE(mult.allocations == 1);
+  REQUIRE(mult.seconds >= 0);
+
+  profile::reset();
+  REQUIRE(profile::snapshot().empty());
+}
+
+TEST_CASE("Decompositions and solves are recorded", "[profile]") {
+  if (!profile::enabled()) {
+    return;
+  }
+  profile::reset();
+  Array A(std::vector<double>{4, 1, 0, 1, 4, 1, 0, 1, 4}, 3, 3);
+  Array b(std::vector<double>{1, 2, 3}, 3, 1);
+  LUDecomp LU(A);
+  LU.decompose();
+  Array x = LU.solve(b);
+  Cholesky chol(A);
+  chol.decompose();
+  Array y = chol.solve(b);
+  Array z = chol.solve(b);
+
+  std::vector<profile::Entry> entries = profile::snapshot();
+  REQUIRE(find(entries, profile::Op::lu_decompose, 4).calls == 1);
+  REQUIRE(find(entries, profile::Op::lu_decompose, 4).flops == 18);
+  REQUIRE(find(entries, profile::Op::lu_solve, 4).calls == 1);
+  REQUIRE(find(entries, profile::Op::chol_decompose, 4).calls == 1);
+  profile::Stats solve = find(entries, profile::Op::chol_solve, 4);
+  REQUIRE(solve.calls == 2);
+  REQUIRE(solve.flops == 2 * 2.0 * 3 * 3);
+}
+
+TEST_CASE("Threads are summed, including finished ones", "[profile]") {
+  if (!profile::enabled()) {
+    return;
+  }
+  profile::reset();
+  Array a(100, 100);
+  std::thread worker([&] { Array b = a + a; });
+  worker.join();
+  Array c = a + a;
+
+  std::vector<profile::Entry> entries = profile::snapshot();
+  REQUIRE(find(entries, profile::Op::add, 128).calls == 2);
+
+  std::string text = profile::to_text(entries);
+  REQUIRE(text.find("add") != std::string::npos);
+  std::string json = profile::to_json(entries);
+  REQUIRE(json.find("\"op\": \"add\", \"max_dim\": 128, \"calls\": 2") !=
+          std::string::npos);
+  profile::reset();
+}
@@ -0,0 +1,125 @@
+#include "../src/array.hpp"
+#include "../src/simd.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+std::vector<simd::Isa> supported_isas() {
+  std::vector<simd::Isa> isas;
+  for (simd::Isa isa : {simd::Isa::scalar, simd::Isa::sse2, simd::Isa::avx2,
+                        simd::Isa::avx512}) {
+    if (simd::supported(isa)) {
+      isas.push_back(isa);
+    }
+  }
+  return isas;
+}
+
+// Every variant against the scalar one, for the kernels over S (double or
+// float)
+template <typename S> void check_binary_kernels() {
+  simd::Isa detected = simd::get_isa();
+
+  // lengths around every vector width, plus one long run
+  std::vector<std::size_t> lengths = {0,  1,  2,  3,  4,  5,  7,  8,
+                                      9,  15, 16, 17, 31, 33, 1001};
+  std::vector<S> l(1001);
+  std::vector<S> r(1001);
+  for (std::size_t i = 0; i < l.size(); ++i) {
+    l[i] = S(0.25) * i - 40;
+    r[i] = S(1.0) + (i % 13) * S(0.75);
+  }
+
+  for (simd::Op op :
+       {simd::Op::add, simd::Op::sub, simd::Op::mul, simd::Op::div}) {
+    // (l, r) strides: same shape, row-scalar, scalar-row, scalar-scalar
+    for (int ls : {1, 0}) {
+      for (int rs : {1, 0}) {
+        for (std::size_t n : lengths) {
+          std::vector<S> expected(n);
+          simd::set_isa(simd::Isa::scalar);
+          simd::binary(op, n, l.data(), ls, r.data(), rs, expected.data());
+
+          for (simd::Isa isa : supported_isas()) {
+            std::vector<S> out(n);
+            simd::set_isa(isa);
+            simd::binary(op, n, l.data(), ls, r.data(), rs, out.data());
+            REQUIRE(out == expected);
+          }
+        }
+      }
+    }
+  }
+
+  simd::set_isa(detected);
+}
+
+template <typename S> void check_fill_kernels() {
+  simd::Isa detected = simd::get_isa();
+  for (simd::Isa isa : supported_isas()) {
+    simd::set_isa(isa);
+    for (std::size_t n : {0, 1, 3, 8, 13, 16, 64, 67}) {
+      std::vector<S> out(n, -1);
+      simd::fill(n, S(2.5), out.data());
+      REQUIRE(out == std::vector<S>(n, S(2.5)));
+    }
+  }
+  simd::set_isa(detected);
+}
+
+} // namespace
+
+TEST_CASE("Scalar kernels are always available", "[simd]") {
+  REQUIRE(simd::supported(simd::Isa::scalar));
+  REQUIRE(simd::supported(simd::detected_isa()));
+}
+
+TEST_CASE("Binary kernels match the scalar path for every variant", "[simd]") {
+  check_binary_kernels<double>();
+  check_binary_kernels<float>();
+}
+
+TEST_CASE("Fill kernels match the scalar path for every variant", "[simd]") {
+  check_fill_kernels<double>();
+  check_fill_kernels<float>();
+}
+
+TEST_CASE("Array operators give the same result on every variant",
+          "[simd][array]") {
+  simd::Isa detected = simd::get_isa();
+  Array m(5, 11);
+  Array row(1, 11);
+  Array col(5, 1);
+  for (int j = 0; j < 11; ++j) {
+    row[0][j] = j + 1;
+    for (int i = 0; i < 5; ++i) {
+      m[i][j] = i * 11 + j - 20;
+    }
+  }
+  for (int i = 0; i < 5; ++i) {
+    col[i][0] = 2 * i + 1;
+  }
+
+  simd::set_isa(simd::Isa::scalar);
+  Array expected = (m + row) * col - m / row;
+
+  for (simd::Isa isa : supported_isas()) {
+    simd::set_isa(isa);
+    Array out = (m + row) * col - m / row;
+    REQUIRE(out.get_vals() == expected.get_vals());
+
+    Array ones(3, 7);
+    ones.set_ones();
+    REQUIRE(ones.get_vals() == std::vector<double>(21, 1));
+
+    // small integers (and the halves from division by 2) are exact in float
+    BasicArray<float> mf(m), rowf(row), colf(col);
+    BasicArray<float> outf = (mf + rowf) * colf - mf / 2;
+    Array expected_f = (m + row) * col - m / 2;
+    REQUIRE(Array(outf).get_vals() == expected_f.get_vals());
+  }
+  simd::set_isa(detected);
+}
@@ -0,0 +1,113 @@
+#include "../src/array.hpp"
+#include "../src/parallel.hpp"
+#include "../src/simd.hpp"
+#include "../src/sparse.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// n x n tridiagonal matrix with 2 on the diagonal and -1 off it, plus a
+// long-range entry in every 7th row so rows are uneven
+std::vector<Triplet> laplacian(int n) {
+  std::vector<Triplet> entries;
+  for (int i = 0; i < n; ++i) {
+    entries.push_back({i, i, 2.0});
+    if (i > 0) {
+      entries.push_back({i, i - 1, -1.0});
+    }
+    if (i + 1 < n) {
+      entries.push_back({i, i + 1, -1.0});
+    }
+    if (i % 7 == 0) {
+      entries.push_back({i, (i * 31) % n, 0.5});
+    }
+  }
+  return entries;
+}
+
+} // namespace
+
+TEST_CASE("Sparse arrays are built from triplets", "[sparse]") {
+  SparseArray A(3, 4, {{2, 3, 1.0}, {0, 1, 2.0}, {2, 0, 3.0}, {0, 1, 4.0}});
+  REQUIRE(A.get_nrow() == 3);
+  REQUIRE(A.get_ncol() == 4);
+  REQUIRE(A.get_nnz() == 3);
+  REQUIRE(A(0, 1) == 6.0);
+  REQUIRE(A(2, 0) == 3.0);
+  REQUIRE(A(1, 1) == 0.0);
+
+  std::vector<std::size_t> row_ptr(A.row_ptrs().begin(), A.row_ptrs().end());
+  std::vector<int> cols(A.col_indices().begin(), A.col_indices().end());
+  REQUIRE(row_ptr == std::vector<std::size_t>{0, 1, 1, 3});
+  REQUIRE(cols == std::vector<int>{1, 0, 3});
+
+  REQUIRE(A.to_dense().get_vals() ==
+          std::vector<double>{0, 6, 0, 0, 0, 0, 0, 0, 3, 0, 0, 1});
+
+  REQUIRE_THROWS_AS(SparseArray(2, 2, {{2, 0, 1.0}}), std::out_of_range);
+  REQUIRE_THROWS_AS(A(3, 0), std::out_of_range);
+}
+
+TEST_CASE("Sparse arrays round-trip through dense", "[sparse]") {
+  Array a(std::vector<double>{1, 0, 0, 1e-12, 0, 2, 3, 0, 0}, 3, 3);
+  SparseArray A(a);
+  REQUIRE(A.get_nnz() == 4);
+  REQUIRE(A.to_dense().get_vals() == a.get_vals());
+
+  SparseArray dropped(a, 1e-9);
+  REQUIRE(dropped.get_nnz() == 3);
+  REQUIRE(dropped(1, 0) == 0.0);
+
+  SparseArray empty(a.block(0, 0, 0, 3));
+  REQUIRE(empty.get_nnz() == 0);
+  REQUIRE(empty.to_dense().get_nrow() == 0);
+}
+
+TEST_CASE("Sparse products match dense ones", "[sparse]") {
+  int n = 2000;
+  SparseArray A(n, n, laplacian(n));
+  Array dense = A.to_dense();
+  Array X(n, 5);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      X[i][j] = (i * 3 + j * 7) % 17 - 8.0;
+    }
+  }
+  Array expected = dense.mult(X);
+
+  for (int threads : {1, 4}) {
+    parallel::set_num_threads(threads);
+    for (simd::Isa isa : {simd::Isa::scalar, simd::detected_isa()}) {
+      simd::set_isa(isa);
+
+      // SpMM, SpMV on a (strided) column, and SpMM through a transpose
+      Array Y = A.mult(X);
+      REQUIRE(Y.get_vals() == expected.get_vals());
+      Array y = mult(A, X.col(2));
+      for (int i = 0; i < n; ++i) {
+        REQUIRE(y[i][0] == expected[i][2]);
+      }
+      Array Xt(X.t());
+      Array Z = mult(A, Xt.t());
+      REQUIRE(Z.get_vals() == expected.get_vals());
+    }
+  }
+  simd::set_isa(simd::detected_isa());
+  parallel::set_num_threads(0);
+}
+
+TEST_CASE("Sparse products check their dimensions", "[sparse]") {
+  SparseArray A(3, 3, {{0, 0, 1.0}, {1, 1, 2.0}, {2, 2, 3.0}});
+  Array x(std::vector<double>{1, 2, 3}, 3, 1);
+  Array out(3, 1);
+  mult(out, A, x);
+  REQUIRE(out.get_vals() == std::vector<double>{1, 4, 9});
+
+  Array wrong(4, 1);
+  REQUIRE_THROWS_AS(A.mult(wrong), std::invalid_argument);
+  REQUIRE_THROWS_AS(mult(wrong, A, x), std::invalid_argument);
+  REQUIRE_THROWS_AS(mult(out, A, out), std::invalid_argument);
+}